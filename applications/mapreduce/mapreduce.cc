@@ -14,27 +14,20 @@ void out( const char* s )
   fixpoint_unsafe_io( s, strlen( s ) );
 }
 
-externref mapreduce( externref mapper,
-                     externref reducer,
-                     externref target,
-                     externref rlimitsm,
-                     externref rlimitsr,
-                     int start,
-                     int end )
+// Expects the strict encodes of the mapper inputs to be attached to ro_table_1.
+externref mapreduce( externref mapper, externref reducer, externref rlimitsm, externref rlimitsr, int start, int end )
 {
   auto nil = create_blob_rw_mem_0( 0 );
   if ( start == end or start == end - 1 ) {
     grow_rw_table_0( 3, nil );
     set_rw_table_0( 0, rlimitsm );
     set_rw_table_0( 1, mapper );
-    auto arg = create_selection_thunk( target, start );
-    set_rw_table_0( 2, create_strict_encode( arg ) );
+    set_rw_table_0( 2, get_ro_table_1( start ) );
     return create_application_thunk( create_tree_rw_table_0( 3 ) );
   } else {
     auto split = start + ( end - start ) / 2;
-    externref first
-      = create_strict_encode( mapreduce( mapper, reducer, target, rlimitsm, rlimitsr, start, split ) );
-    externref second = create_strict_encode( mapreduce( mapper, reducer, target, rlimitsm, rlimitsr, split, end ) );
+    externref first = create_strict_encode( mapreduce( mapper, reducer, rlimitsm, rlimitsr, start, split ) );
+    externref second = create_strict_encode( mapreduce( mapper, reducer, rlimitsm, rlimitsr, split, end ) );
     grow_rw_table_0( 4, nil );
     set_rw_table_0( 0, rlimitsr );
     set_rw_table_0( 1, reducer );
@@ -68,5 +61,9 @@ __attribute__( ( export_name( "_fixpoint_apply" ) ) ) externref _fixpoint_apply(
   auto rlimitsr = get_ro_table_0( 6 );
 
   auto N = get_length( target );
-  return mapreduce( mapper, reducer, target, rlimitsm, rlimitsr, 0, N );
+
+  // Select and encode every mapper input in two host calls, rather than two per leaf.
+  attach_tree_ro_table_1( create_strict_encodes( create_selection_thunks( target, 0, N ) ) );
+
+  return mapreduce( mapper, reducer, rlimitsm, rlimitsr, 0, N );
 }
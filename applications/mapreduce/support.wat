@@ -3,10 +3,13 @@
   (memory $ro_mem_0 (export "ro_mem_0") 0)
   (memory $rw_mem_0 (export "rw_mem_0") 0)
   (table $ro_table_0 (export "ro_table_0") 0 externref)
+  (table $ro_table_1 (export "ro_table_1") 0 externref)
   (table $rw_table_0 (export "rw_table_0") 6 externref)
   (table $rw_table_1 (export "rw_table_1") 0 externref)
   (func (export "get_ro_table_0") (param $index i32) (result externref)
         (table.get $ro_table_0 (local.get $index)))
+  (func (export "get_ro_table_1") (param $index i32) (result externref)
+        (table.get $ro_table_1 (local.get $index)))
   (func (export "size_ro_table_0") (result i32)
         (table.size $ro_table_0))
   (func (export "grow_rw_table_0") (param $size i32) (param $init_val externref )     (result i32)
@@ -10,12 +10,20 @@ extern externref create_blob_i32( int32_t number )
   __attribute__( ( import_module( "fixpoint" ), import_name( "create_blob_i32" ) ) );
 extern externref create_blob_i64( int64_t number )
   __attribute__( ( import_module( "fixpoint" ), import_name( "create_blob_i64" ) ) );
+extern externref create_blob_slice( externref blob, uint32_t offset, uint32_t length )
+  __attribute__( ( import_module( "fixpoint" ), import_name( "create_blob_slice" ) ) );
 extern externref create_application_thunk( externref pointer )
   __attribute__( ( import_module( "fixpoint" ), import_name( "create_application_thunk" ) ) );
 extern externref create_selection_thunk( externref pointer, uint32_t idx )
   __attribute__( ( import_module( "fixpoint" ), import_name( "create_selection_thunk" ) ) );
 extern externref create_selection_thunk_range( externref pointer, uint32_t begin_idx, uint32_t end_idx )
   __attribute__( ( import_module( "fixpoint" ), import_name( "create_selection_thunk_range" ) ) );
+extern externref create_selection_thunks( externref pointer, uint32_t begin_idx, uint32_t end_idx )
+  __attribute__( ( import_module( "fixpoint" ), import_name( "create_selection_thunks" ) ) );
+extern externref create_subtree( externref pointer, uint32_t begin_idx, uint32_t end_idx )
+  __attribute__( ( import_module( "fixpoint" ), import_name( "create_subtree" ) ) );
+extern externref create_strict_encodes( externref pointer )
+  __attribute__( ( import_module( "fixpoint" ), import_name( "create_strict_encodes" ) ) );
 extern externref create_strict_encode( externref pointer )
   __attribute__( ( import_module( "fixpoint" ), import_name( "create_strict_encode" ) ) );
 extern externref create_shallow_encode( externref pointer )
@@ -19,17 +19,35 @@ add_custom_target (flatware-check COMMAND ${CMAKE_CTEST_COMMAND} --output-on-fai
 )
 add_custom_target (all-flatware-check COMMAND ${CMAKE_CTEST_COMMAND} --output-on-failure -R "^f_" COMMENT "Testing Flatware...")
 
+add_custom_target (bench COMMAND ${CMAKE_CURRENT_SOURCE_DIR}/src/tests/bench.sh ${CMAKE_CURRENT_BINARY_DIR}/bench.json
+  WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}
+  DEPENDS fixpoint-bench
+  COMMENT "Benchmarking Fix..."
+)
+
+add_custom_target (cluster-bench COMMAND ${CMAKE_CURRENT_SOURCE_DIR}/src/tests/cluster-bench.sh ${CMAKE_CURRENT_BINARY_DIR}/cluster-bench.json
+  WORKING_DIRECTORY ${CMAKE_CURRENT_BINARY_DIR}
+  DEPENDS fixpoint-bench
+  COMMENT "Comparing schedulers..."
+)
+
 add_test(NAME u_handle COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-handle)
 add_test(NAME u_hash_table COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-hash-table)
+add_test(NAME u_handle_filter COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-handle-filter)
 add_test(NAME u_storage COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-storage)
 add_test(NAME u_evaluator COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-evaluator)
 add_test(NAME u_executor COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-executor)
 add_test(NAME u_distributed COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-distributed)
+add_test(NAME u_striped_fetch COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-striped-fetch)
 add_test(NAME u_blake3 WORKING_DIRECTORY COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-blake3)
+add_test(NAME u_eventloop COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-eventloop)
 add_test(NAME u_dependency_graph COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-dependency-graph)
+add_test(NAME u_trace_analysis COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-trace-analysis)
 add_test(NAME u_pass_scheduler COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-pass-scheduler)
 add_test(NAME u_local_scheduler COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-local-scheduler)
 add_test(NAME u_relater COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-scheduler-relate)
+add_test(NAME u_fixpointapi COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-fixpointapi)
+add_test(NAME u_relay COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-relay)
 
 add_test(NAME t_add COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-add)
 add_test(NAME t_fib COMMAND ${CMAKE_CURRENT_BINARY_DIR}/src/tests/test-fib)
@@ -6,6 +6,8 @@
 
 #include <glog/logging.h>
 
+#include "exception.hh"
+
 template<typename S>
 Owned<S>::Owned( S span, AllocationType allocation_type )
   : span_( span )
@@ -19,11 +21,13 @@ Owned<S>::Owned( std::filesystem::path path ) requires std::is_const_v<element_t
 {
   VLOG( 2 ) << "mapping " << path << " as read-only";
   size_t size = std::filesystem::file_size( path );
-  int fd = open( path.c_str(), O_RDONLY );
-  CHECK( fd >= 0 );
+  int fd = CheckSystemCall( "open " + path.string(), open( path.c_str(), O_RDONLY ) );
   void* p = mmap( NULL, size, PROT_READ, MAP_SHARED, fd, 0 );
-  CHECK( p );
+  const int mmap_errno = errno;
   close( fd );
+  if ( p == MAP_FAILED ) {
+    throw unix_error( "mmap " + path.string(), mmap_errno );
+  }
   span_ = { reinterpret_cast<pointer>( p ), size / sizeof( element_type ) };
 }
 
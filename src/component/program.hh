@@ -2,6 +2,7 @@
 
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "handle.hh"
 #include "wasm-rt.h"
@@ -23,6 +24,14 @@ struct InstanceCleanUp
   }
 };
 
+// A function defined by a linked program, at an offset from the start of its code
+struct GuestSymbol
+{
+  uint64_t offset;
+  uint64_t size;
+  std::string name;
+};
+
 class Program
 {
 private:
@@ -36,6 +45,10 @@ private:
   uint64_t cleanup_entry_;
   // size of instance
   size_t instance_context_size_;
+  // Size of the code and data section
+  size_t code_size_;
+  // Functions defined in the code section, sorted by offset
+  std::vector<GuestSymbol> symbols_;
 
   struct Context
   {
@@ -47,12 +60,16 @@ public:
            uint64_t init_entry,
            uint64_t main_entry,
            uint64_t cleanup_entry,
-           uint64_t instance_size_entry )
+           uint64_t instance_size_entry,
+           size_t code_size = 0,
+           std::vector<GuestSymbol> symbols = {} )
     : code_( code )
     , init_entry_( init_entry )
     , main_entry_( main_entry )
     , cleanup_entry_( cleanup_entry )
     , instance_context_size_( 0 )
+    , code_size_( code_size )
+    , symbols_( std::move( symbols ) )
   {
     GlobalScopeTimer<Timer::Category::Populating> record_timer;
     size_t ( *size_func )( void );
@@ -66,6 +83,10 @@ public:
 
   size_t get_instance_and_context_size() const { return instance_context_size_; }
 
+  const char* code() const { return code_.get(); }
+  size_t code_size() const { return code_size_; }
+  const std::vector<GuestSymbol>& symbols() const { return symbols_; }
+
   Handle<Object> execute( Handle<ObjectTree> encode_name ) const
   {
     void ( *init_func )( void* );
@@ -105,6 +126,8 @@ public:
     , main_entry_( other.main_entry_ )
     , cleanup_entry_( other.cleanup_entry_ )
     , instance_context_size_( other.instance_context_size_ )
+    , code_size_( other.code_size_ )
+    , symbols_( std::move( other.symbols_ ) )
   {}
 
   Program& operator=( Program&& other )
@@ -114,6 +137,8 @@ public:
     main_entry_ = other.main_entry_;
     cleanup_entry_ = other.cleanup_entry_;
     instance_context_size_ = other.instance_context_size_;
+    code_size_ = other.code_size_;
+    symbols_ = std::move( other.symbols_ );
 
     return *this;
   }
@@ -2,10 +2,13 @@
 
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
+#include <atomic>
 #include <glog/logging.h>
+#include <memory>
 
 #include "handle.hh"
 #include "overload.hh"
+#include "trace.hh"
 
 /**
  * Serves the purpose of a "blocked queue" in a conventional OS; since we know computations are deterministic, we
@@ -19,16 +22,37 @@ public:
   using Task = Handle<Relation>;
   using Result = Handle<Object>;
 
+  // Updated under the graph's lock, and read without it (e.g. by the metrics endpoint)
+  struct Stats
+  {
+    std::atomic<uint64_t> started {};
+    std::atomic<uint64_t> finished {};
+    // Tasks running, Tasks blocked, and Dependees some Task is blocked on
+    std::atomic<size_t> running {};
+    std::atomic<size_t> blocked {};
+    std::atomic<size_t> awaited {};
+  };
+
 private:
   absl::flat_hash_set<Task> running_ {};
   absl::flat_hash_map<Task, absl::flat_hash_set<Handle<Dependee>>> forward_dependencies_ {};
   absl::flat_hash_map<Handle<Dependee>, absl::flat_hash_set<Task>> backward_dependencies_ {};
+  std::shared_ptr<Stats> stats_ { std::make_shared<Stats>() };
+
+  void update_sizes()
+  {
+    stats_->running.store( running_.size(), std::memory_order_relaxed );
+    stats_->blocked.store( forward_dependencies_.size(), std::memory_order_relaxed );
+    stats_->awaited.store( backward_dependencies_.size(), std::memory_order_relaxed );
+  }
 
 public:
   DependencyGraph() {}
 
   bool contains( Task task ) const { return running_.contains( task ); }
 
+  std::shared_ptr<const Stats> stats() const { return stats_; }
+
   /**
    * Marks a Task as started.  Returns whether the Task is new.
    *
@@ -43,6 +67,9 @@ public:
     if ( !forward_dependencies_[task].empty() )
       return false;
     running_.insert( task );
+    stats_->started.fetch_add( 1, std::memory_order_relaxed );
+    update_sizes();
+    trace( Tracer::Event::Started, task );
     return true;
   }
 
@@ -58,6 +85,8 @@ public:
     forward_dependencies_[blocked].insert( runnable_or_loadable );
     backward_dependencies_[runnable_or_loadable].insert( blocked );
     running_.erase( blocked );
+    update_sizes();
+    trace( Tracer::Event::Blocked, blocked, handle::fix( runnable_or_loadable ) );
   }
 
   /**
@@ -69,19 +98,27 @@ public:
   void finish( Handle<Dependee> task_or_object, absl::flat_hash_set<Task>& unblocked )
   {
     VLOG( 2 ) << "finished " << task_or_object;
-    task_or_object.visit<void>( overload { [&]( Handle<Relation> r ) { running_.erase( r ); }, [&]( auto ) {} } );
+    task_or_object.visit<void>( overload {
+      [&]( Handle<Relation> r ) {
+        running_.erase( r );
+        stats_->finished.fetch_add( 1, std::memory_order_relaxed );
+        trace( Tracer::Event::Finished, r );
+      },
+      [&]( auto ) { trace( Tracer::Event::Loaded, handle::fix( task_or_object ) ); } } );
     if ( backward_dependencies_.contains( task_or_object ) ) {
       for ( const auto dependent : backward_dependencies_[task_or_object] ) {
         auto& target = forward_dependencies_[dependent];
         target.erase( task_or_object );
         if ( target.empty() ) {
           VLOG( 2 ) << "resuming " << dependent;
+          trace( Tracer::Event::Unblocked, dependent );
           unblocked.insert( dependent );
           forward_dependencies_.erase( dependent );
         }
       }
       backward_dependencies_.erase( task_or_object );
     }
+    update_sizes();
   }
 
   absl::flat_hash_set<Handle<Dependee>> get_forward_dependencies( Task blocked ) const
@@ -93,5 +130,9 @@ public:
     }
   }
 
-  void erase_forward_dependencies( Task blocked ) { forward_dependencies_.erase( blocked ); }
+  void erase_forward_dependencies( Task blocked )
+  {
+    forward_dependencies_.erase( blocked );
+    update_sizes();
+  }
 };
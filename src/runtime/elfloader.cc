@@ -1,9 +1,11 @@
+#include <algorithm>
 #include <cmath>
 #include <iostream>
 #include <memory>
 
 #include "elfloader.hh"
 #include "fixpointapi.hh"
+#include "sampler.hh"
 
 using namespace std;
 
@@ -50,10 +52,14 @@ const static map<string, uint64_t> library_func_map
       { "fixpoint_create_blob_i32", (uint64_t)fixpoint::create_blob_i32 },
       { "fixpoint_create_blob_i64", (uint64_t)fixpoint::create_blob_i64 },
       { "fixpoint_create_blob_string", (uint64_t)fixpoint::create_blob_string },
+      { "fixpoint_create_blob_slice", (uint64_t)fixpoint::create_blob_slice },
       { "fixpoint_create_application_thunk", (uint64_t)fixpoint::create_application_thunk },
       { "fixpoint_create_identification_thunk", (uint64_t)fixpoint::create_identification_thunk },
       { "fixpoint_create_selection_thunk", (uint64_t)fixpoint::create_selection_thunk },
       { "fixpoint_create_selection_thunk_range", (uint64_t)fixpoint::create_selection_thunk_range },
+      { "fixpoint_create_selection_thunks", (uint64_t)fixpoint::create_selection_thunks },
+      { "fixpoint_create_strict_encodes", (uint64_t)fixpoint::create_strict_encodes },
+      { "fixpoint_create_subtree", (uint64_t)fixpoint::create_subtree },
       { "fixpoint_get_length", (uint64_t)fixpoint::get_length },
       { "fixpoint_create_strict_encode", (uint64_t)fixpoint::create_strict_encode },
       { "fixpoint_create_shallow_encode", (uint64_t)fixpoint::create_shallow_encode },
@@ -148,12 +154,14 @@ Elf_Info load_program( std::span<const char> program_content )
             continue;
           }
 
+          if ( ELF64_ST_TYPE( symtb_entry.st_info ) == STT_FUNC and symtb_entry.st_size != 0 ) {
+            res.functions.push_back( &symtb_entry );
+          }
+
           string name = string( res.symstrs.data() + symtb_entry.st_name );
           if ( name == "initProgram" or name == "w2c_function_0x5Ffixpoint_apply" or name == "wasm2c_function_free"
                or name == "get_instance_size" ) {
             res.func_map[name] = { symtb_entry.st_value, symtb_entry.st_shndx };
-            if ( res.func_map.size() == 4 )
-              break;
           }
         }
       }
@@ -268,5 +276,19 @@ shared_ptr<Program> link_program( span<const char> program_content )
   auto& instance_size_location = elf_info.func_map.at( "get_instance_size" );
   uint64_t instance_size_entry
     = instance_size_location.first + elf_info.idx_to_offset.at( instance_size_location.second );
-  return make_shared<Program>( code, init_entry, main_entry, cleanup_entry, instance_size_entry );
+
+  vector<GuestSymbol> symbols;
+  for ( const auto* function : elf_info.functions ) {
+    if ( elf_info.idx_to_offset.contains( function->st_shndx ) ) {
+      symbols.push_back( { elf_info.idx_to_offset.at( function->st_shndx ) + function->st_value,
+                           function->st_size,
+                           string( elf_info.symstrs.data() + function->st_name ) } );
+    }
+  }
+  sort( symbols.begin(), symbols.end(), []( const auto& a, const auto& b ) { return a.offset < b.offset; } );
+
+  auto program = make_shared<Program>(
+    code, init_entry, main_entry, cleanup_entry, instance_size_entry, elf_info.size, std::move( symbols ) );
+  guest_symbols::register_program( program );
+  return program;
 }
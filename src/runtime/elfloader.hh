@@ -31,6 +31,8 @@ struct Elf_Info
 
   // Map from function/variable name to st_value
   std::map<std::string, std::pair<uint64_t, unsigned short>> func_map;
+  // Every defined function symbol, for attributing samples to guest code
+  std::vector<const Elf64_Sym*> functions;
 
   // Map from section idx to the offset of section in program memory
   std::map<uint64_t, uint64_t> idx_to_offset;
@@ -44,6 +46,7 @@ struct Elf_Info
     , symtb()
     , sheader()
     , func_map()
+    , functions()
     , idx_to_offset()
     , relocation_tables()
   {}
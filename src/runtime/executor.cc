@@ -9,6 +9,7 @@
 #include "overload.hh"
 #include "resource_limits.hh"
 #include "storage_exception.hh"
+#include "trace.hh"
 
 template<typename T>
 using Result = Executor::Result<T>;
@@ -83,6 +84,7 @@ void Executor::run()
 void Executor::progress( Handle<Relation> runnable )
 {
   VLOG( 2 ) << "Progressing " << runnable;
+  TraceScope<Tracer::Event::ProgressBegin, Tracer::Event::ProgressEnd> traced( runnable );
   parent_.run( runnable );
 }
 
@@ -91,6 +93,10 @@ Result<Object> Executor::apply( Handle<ObjectTree> combination )
   VLOG( 2 ) << "Apply " << combination;
 
   TreeData tree = parent_.storage_.get( combination );
+  const Handle<Fix> applied = Handle<Expression>( Handle<Object>( combination ) );
+  const Handle<Fix> procedure = tree->size() > 1 ? tree->at( 1 ) : applied;
+  TraceScope<Tracer::Event::ApplyBegin, Tracer::Event::ApplyEnd> traced( applied, procedure );
+  applications_.fetch_add( 1, memory_order_relaxed );
   auto result = runner_->apply( combination, tree );
 
   return result;
@@ -117,6 +123,21 @@ std::optional<Handle<Object>> Executor::get( Handle<Relation> name )
   return {};
 }
 
+void Executor::start( std::span<const Handle<Relation>> names )
+{
+  if ( names.empty() ) {
+    return;
+  }
+  if ( threads_.size() == 0 ) {
+    throw HandleNotFound( names.front() );
+  }
+  auto graph = parent_.graph_.write();
+  for ( const auto name : names ) {
+    if ( graph->start( name ) )
+      todo_.push( name );
+  }
+}
+
 std::optional<Handle<AnyTree>> Executor::get_handle( Handle<AnyTree> )
 {
   return {};
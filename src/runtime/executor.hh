@@ -1,7 +1,9 @@
 #pragma once
 
+#include <atomic>
 #include <limits>
 #include <memory>
+#include <span>
 #include <thread>
 #include <vector>
 
@@ -18,6 +20,7 @@ class Executor : public IRuntime
   Channel<Handle<Relation>> todo_ {};
   Relater& parent_;
   std::shared_ptr<Runner> runner_ {};
+  std::atomic<uint64_t> applications_ {};
 
 public:
   Executor( Relater& parent,
@@ -36,6 +39,12 @@ private:
 public:
   Result<Object> apply( Handle<ObjectTree> combination );
 
+  size_t queue_depth() { return todo_.size_approx(); }
+  // Like get( Handle<Relation> ) for each of names, with one pass over the dependency graph
+  void start( std::span<const Handle<Relation>> names );
+  // Procedures applied by this node's threads
+  uint64_t applications() const { return applications_.load( std::memory_order_relaxed ); }
+
   /** @defgroup Implementation of IRuntime
    * @{
    */
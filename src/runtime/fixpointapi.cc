@@ -5,6 +5,7 @@
 #include "handle.hh"
 #include "handle_post.hh"
 #include "object.hh"
+#include "overload.hh"
 #include "runtimestorage.hh"
 #include "wasm-rt.h"
 
@@ -90,6 +91,35 @@ u8x32 create_blob_string( uint32_t index, uint32_t length, wasm_rt_memory_t* mem
   return storage->create( { reinterpret_cast<char*>( memory->data ) + index, length } ).into<Fix>().content;
 }
 
+u8x32 create_blob_slice( u8x32 handle, uint32_t offset, uint32_t length )
+{
+  auto h = handle::extract<Blob>( Handle<Fix>::forge( handle ) );
+  check( h );
+
+  if ( (uint64_t)offset + length > handle::size( *h ) ) {
+    wasm_rt_trap( WASM_RT_TRAP_OOB );
+  }
+
+  return h
+    ->visit<Handle<Blob>>( overload {
+      [&]( Handle<Literal> l ) -> Handle<Blob> { return Handle<Literal>( l.view().substr( offset, length ) ); },
+      [&]( Handle<Named> n ) -> Handle<Blob> {
+        auto parent = storage->get( n );
+        auto slice = parent->span().subspan( offset, length );
+        if ( length <= Handle<Literal>::MAXIMUM_LENGTH ) {
+          return Handle<Literal>( std::string_view { slice.data(), slice.size() } );
+        }
+
+        // The slice points into the parent's bytes; the aliasing shared_ptr keeps the parent alive as long as the
+        // slice is referenced.
+        auto holder = make_shared<pair<BlobData, OwnedBlob>>( parent, OwnedBlob( slice, AllocationType::Static ) );
+        return storage->create( BlobData( holder, &holder->second ) );
+      },
+    } )
+    .into<Fix>()
+    .content;
+}
+
 void unsafe_io( int32_t index, int32_t length, wasm_rt_memory_t* mem )
 {
   if ( index + length > (int64_t)mem->size ) {
@@ -179,6 +209,76 @@ u8x32 create_selection_thunk_range( u8x32 handle, uint32_t begin_idx, uint32_t e
   return h->into<Fix>().content;
 }
 
+u8x32 create_selection_thunks( u8x32 handle, uint32_t begin_idx, uint32_t end_idx )
+{
+  auto h = handle::extract<Object>( Handle<Fix>::forge( handle ) );
+  check( h );
+
+  if ( begin_idx > end_idx ) {
+    wasm_rt_trap( WASM_RT_TRAP_OOB );
+  }
+
+  auto tree = OwnedMutTree::allocate( end_idx - begin_idx );
+  for ( uint32_t i = begin_idx; i < end_idx; i++ ) {
+    tree[i - begin_idx] = Handle<Selection>( storage->construct_tree<ObjectTree>( *h, Handle<Literal>( (uint64_t)i ) ) )
+                            .into<Thunk>()
+                            .into<Fix>();
+  }
+
+  return storage->create( make_shared<OwnedTree>( std::move( tree ) ) )
+    .visit<Handle<Fix>>( []( auto h ) { return h; } )
+    .content;
+}
+
+u8x32 create_strict_encodes( u8x32 handle )
+{
+  auto fix_handle = Handle<Fix>::forge( handle );
+  optional<Handle<AnyTree>> h
+    = handle::extract<ExpressionTree>( fix_handle )
+        .transform( []( auto h ) -> Handle<AnyTree> { return h; } )
+        .or_else( [&]() -> optional<Handle<AnyTree>> { return handle::extract<ObjectTree>( fix_handle ); } )
+        .or_else( [&]() -> optional<Handle<AnyTree>> { return handle::extract<ValueTree>( fix_handle ); } );
+
+  check( h );
+
+  auto entries = storage->get( *h );
+  auto tree = OwnedMutTree::allocate( entries->size() );
+  for ( size_t i = 0; i < entries->size(); i++ ) {
+    auto thunk = handle::extract<Thunk>( entries->span()[i] );
+    check( thunk );
+    tree[i] = thunk->into<Strict>().into<Encode>().into<Fix>();
+  }
+
+  return storage->create( make_shared<OwnedTree>( std::move( tree ) ) )
+    .visit<Handle<Fix>>( []( auto h ) { return h; } )
+    .content;
+}
+
+u8x32 create_subtree( u8x32 handle, uint32_t begin_idx, uint32_t end_idx )
+{
+  auto fix_handle = Handle<Fix>::forge( handle );
+  optional<Handle<AnyTree>> h
+    = handle::extract<ExpressionTree>( fix_handle )
+        .transform( []( auto h ) -> Handle<AnyTree> { return h; } )
+        .or_else( [&]() -> optional<Handle<AnyTree>> { return handle::extract<ObjectTree>( fix_handle ); } )
+        .or_else( [&]() -> optional<Handle<AnyTree>> { return handle::extract<ValueTree>( fix_handle ); } );
+
+  check( h );
+
+  auto parent = storage->get( *h );
+  if ( begin_idx > end_idx or end_idx > parent->size() ) {
+    wasm_rt_trap( WASM_RT_TRAP_OOB );
+  }
+
+  // As in create_blob_slice, the subtree points into the parent's entries and keeps the parent alive.
+  auto holder = make_shared<pair<TreeData, OwnedTree>>(
+    parent, OwnedTree( parent->span().subspan( begin_idx, end_idx - begin_idx ), AllocationType::Static ) );
+
+  return storage->create( TreeData( holder, &holder->second ) )
+    .visit<Handle<Fix>>( []( auto h ) { return h; } )
+    .content;
+}
+
 uint32_t get_length( u8x32 handle )
 {
   auto fix = Handle<Fix>::forge( handle );
@@ -35,6 +35,10 @@ u8x32 create_blob_i64( uint64_t content );
 // Return Handle<Blob>
 u8x32 create_blob_string( uint32_t index, uint32_t length, wasm_rt_memory_t* memory );
 
+// Return Handle<Blob> naming bytes [offset, offset + length) of the Blob, sharing its storage. Traps if handle is not
+// Handle<Blob> or if the range is out of bounds.
+u8x32 create_blob_slice( u8x32 handle, uint32_t offset, uint32_t length );
+
 // Return Handle<Application>, traps if handle is not Handle<ExpressionTree>
 u8x32 create_application_thunk( u8x32 handle );
 
@@ -45,6 +49,18 @@ u8x32 create_identification_thunk( u8x32 handle );
 u8x32 create_selection_thunk( u8x32 handle, uint32_t idx );
 u8x32 create_selection_thunk_range( u8x32 handle, uint32_t begin_idx, uint32_t end_idx );
 
+// Return Handle<ObjectTree> of Handle<Selection> for each index in [begin_idx, end_idx), traps if handle is not
+// Handle<Object> or if the range is reversed
+u8x32 create_selection_thunks( u8x32 handle, uint32_t begin_idx, uint32_t end_idx );
+
+// Return Handle<AnyTree> of the Handle<Strict> of each entry, traps if handle is not Handle<AnyTree> or if any entry
+// is not Handle<Thunk>
+u8x32 create_strict_encodes( u8x32 handle );
+
+// Return Handle<AnyTree> of entries [begin_idx, end_idx) of the Tree, sharing its storage. Traps if handle is not
+// Handle<AnyTree> or if the range is out of bounds.
+u8x32 create_subtree( u8x32 handle, uint32_t begin_idx, uint32_t end_idx );
+
 // Traps if handle is not Handle<AnyTree> or Handle<AnyTreeRef> or Handle<Blob> or Handle<BlobRef>
 uint32_t get_length( u8x32 handle );
 
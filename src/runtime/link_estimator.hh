@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <optional>
+
+/**
+ * Estimates the round-trip time and bandwidth of one connection from the traffic it already carries, and derives
+ * how much data is worth pushing eagerly instead of proposing a transfer first. Only the IO thread serving the
+ * connection records samples; the estimates can be read from any thread.
+ */
+class LinkEstimator
+{
+public:
+  using clock = std::chrono::steady_clock;
+
+  // Used until both estimates are available
+  static constexpr size_t DEFAULT_EAGER_THRESHOLD = 1 << 20;
+  static constexpr size_t MIN_EAGER_THRESHOLD = 1 << 16;
+  static constexpr size_t MAX_EAGER_THRESHOLD = 1 << 26;
+
+private:
+  // Like BBR, keep the minimum RTT seen recently, since samples include queueing behind earlier messages
+  static constexpr clock::duration RTT_WINDOW = std::chrono::seconds( 10 );
+  // Bandwidth samples shorter than this are dominated by timer and scheduling noise
+  static constexpr clock::duration MIN_BANDWIDTH_INTERVAL = std::chrono::milliseconds( 1 );
+  static constexpr double BANDWIDTH_GAIN = 0.25;
+
+  std::atomic<double> rtt_ns_ { 0 };
+  std::atomic<double> bytes_per_ns_ { 0 };
+  clock::time_point rtt_stamp_ {};
+
+  // The current backlog: bytes written since the first write of the backlog filled the socket buffer
+  std::optional<clock::time_point> backlog_start_ {};
+  size_t backlog_bytes_ {};
+
+public:
+  void rtt_sample( clock::duration rtt )
+  {
+    const auto now = clock::now();
+    const double sample = std::chrono::duration<double, std::nano>( rtt ).count();
+    if ( rtt_ns_ == 0 or sample <= rtt_ns_ or now - rtt_stamp_ > RTT_WINDOW ) {
+      rtt_ns_ = sample;
+      rtt_stamp_ = now;
+    }
+  }
+
+  // Record a write of `bytes` to the socket; `backlogged` is whether more data was still waiting afterwards.
+  void sent( size_t bytes, bool backlogged )
+  {
+    const auto now = clock::now();
+    if ( not backlog_start_.has_value() ) {
+      // The first write of a backlog only fills the socket buffer, so time the ones after it
+      if ( backlogged ) {
+        backlog_start_ = now;
+        backlog_bytes_ = 0;
+      }
+      return;
+    }
+
+    backlog_bytes_ += bytes;
+    const auto elapsed = now - *backlog_start_;
+    if ( elapsed >= MIN_BANDWIDTH_INTERVAL ) {
+      const double sample = backlog_bytes_ / std::chrono::duration<double, std::nano>( elapsed ).count();
+      const double previous = bytes_per_ns_;
+      bytes_per_ns_ = previous == 0 ? sample : previous + BANDWIDTH_GAIN * ( sample - previous );
+      backlog_start_ = now;
+      backlog_bytes_ = 0;
+    }
+
+    if ( not backlogged ) {
+      backlog_start_.reset();
+    }
+  }
+
+  // Bytes per second, the unit of IRuntime::Info::link_speed, or 0 until measured
+  double bandwidth() const { return bytes_per_ns_ * 1e9; }
+  std::chrono::nanoseconds rtt() const { return std::chrono::nanoseconds( static_cast<int64_t>( rtt_ns_ ) ); }
+
+  // The bandwidth-delay product: sending less than this eagerly takes less time than a proposal round trip
+  size_t eager_threshold() const
+  {
+    const double rtt = rtt_ns_;
+    const double bandwidth = bytes_per_ns_;
+    if ( rtt == 0 or bandwidth == 0 ) {
+      return DEFAULT_EAGER_THRESHOLD;
+    }
+    return std::clamp( static_cast<size_t>( rtt * bandwidth ), MIN_EAGER_THRESHOLD, MAX_EAGER_THRESHOLD );
+  }
+};
@@ -5,9 +5,15 @@
 #include "parser.hh"
 #include "types.hh"
 
+#include <cstring>
+#include <fcntl.h>
 #include <glog/logging.h>
 #include <memory>
 #include <span>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "exception.hh"
 
 using namespace std;
 
@@ -29,23 +35,71 @@ IncomingMessage::IncomingMessage( const Message::Opcode opcode, OwnedMutTree&& p
 OutgoingMessage::OutgoingMessage( const Message::Opcode opcode, BlobData payload )
   : Message( opcode )
   , payload_( payload )
-{}
+{
+  serialize_header( header_ );
+}
 
 OutgoingMessage::OutgoingMessage( const Message::Opcode opcode, TreeData payload )
   : Message( opcode )
   , payload_( payload )
-{}
+{
+  serialize_header( header_ );
+}
 
 OutgoingMessage::OutgoingMessage( const Message::Opcode opcode, string&& payload )
   : Message( opcode )
-  , payload_( payload )
-{}
+  , payload_( move( payload ) )
+{
+  serialize_header( header_ );
+}
 
-void OutgoingMessage::serialize_header( string& out )
+OutgoingMessage OutgoingMessage::blob_range( Handle<Named> handle, uint64_t offset, BlobData blob, size_t length )
+{
+  OutgoingMessage message( Opcode::BLOBRANGE, blob );
+  message.slice_offset_ = offset;
+  message.slice_length_ = length;
+
+  string prefix( BlobRangePayload::PREFIX_LENGTH, 0 );
+  Serializer s { prefix };
+  s.integer( handle.content );
+  s.integer( offset );
+
+  message.serialize_header( message.header_, prefix.size() );
+  message.header_.append( prefix );
+  return message;
+}
+
+OutgoingMessage OutgoingMessage::blob_fd( string_view blob )
+{
+  FileDescriptor fd { CheckSystemCall( "memfd_create",
+                                       memfd_create( "BLOBFD", MFD_CLOEXEC | MFD_ALLOW_SEALING ) ) };
+  CheckSystemCall( "ftruncate", ftruncate( fd.fd_num(), blob.size() ) );
+  if ( blob.size() ) {
+    void* data = mmap( nullptr, blob.size(), PROT_WRITE, MAP_SHARED, fd.fd_num(), 0 );
+    if ( data == MAP_FAILED ) {
+      throw unix_error( "mmap" );
+    }
+    memcpy( data, blob.data(), blob.size() );
+    munmap( data, blob.size() );
+  }
+  // The receiver maps the memfd instead of copying it, so it must not change underneath it
+  CheckSystemCall( "fcntl",
+                   fcntl( fd.fd_num(), F_ADD_SEALS, F_SEAL_WRITE | F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL ) );
+
+  string payload( sizeof( uint64_t ), 0 );
+  Serializer s { payload };
+  s.integer( static_cast<uint64_t>( blob.size() ) );
+
+  OutgoingMessage message( Opcode::BLOBFD, move( payload ) );
+  message.fd_ = move( fd );
+  return message;
+}
+
+void OutgoingMessage::serialize_header( string& out, size_t prefix_length )
 {
   out.resize( Message::HEADER_LENGTH );
   Serializer s { out };
-  s.integer( payload_length() );
+  s.integer( prefix_length + payload_length() );
   s.integer( static_cast<uint8_t>( opcode() ) );
 
   if ( s.bytes_written() != Message::HEADER_LENGTH ) {
@@ -55,20 +109,25 @@ void OutgoingMessage::serialize_header( string& out )
 
 string_view OutgoingMessage::payload()
 {
-  return std::visit( overload {
-                       []( BlobData& b ) -> string_view {
-                         return { b->data(), b->size() };
-                       },
-                       []( TreeData& t ) -> string_view {
-                         return { reinterpret_cast<const char*>( t->data() ), t->span().size_bytes() };
-                       },
-                       []( string& s ) -> string_view { return s; },
-                     },
-                     payload_ );
+  auto payload = std::visit( overload {
+                               []( BlobData& b ) -> string_view {
+                                 return { b->data(), b->size() };
+                               },
+                               []( TreeData& t ) -> string_view {
+                                 return { reinterpret_cast<const char*>( t->data() ), t->span().size_bytes() };
+                               },
+                               []( string& s ) -> string_view { return s; },
+                             },
+                             payload_ );
+  return slice_length_ ? payload.substr( slice_offset_, *slice_length_ ) : payload;
 }
 
 size_t OutgoingMessage::payload_length()
 {
+  if ( slice_length_ ) {
+    return *slice_length_;
+  }
+
   return std::visit( overload {
                        []( BlobData& b ) { return b->size(); },
                        []( TreeData& t ) { return t->span().size_bytes(); },
@@ -161,20 +220,31 @@ size_t MessageParser::parse( string_view buf )
             case Message::Opcode::REQUESTSHALLOWTREE:
             case Message::Opcode::PROPOSE_TRANSFER:
             case Message::Opcode::ACCEPT_TRANSFER:
-            case Message::Opcode::SHALLOWTREEDATA: {
+            case Message::Opcode::SHALLOWTREEDATA:
+            case Message::Opcode::REQUESTBLOBRANGE:
+            case Message::Opcode::BLOBRANGE:
+            case Message::Opcode::BROADCAST:
+            case Message::Opcode::BLOBFD:
+            case Message::Opcode::RUN_BATCH:
+            case Message::Opcode::RESULT_BATCH:
+            case Message::Opcode::RELAYED: {
               incomplete_payload_ = "";
               get<string>( incomplete_payload_ ).resize( expected_payload_length_.value() );
               break;
             }
 
             case Message::Opcode::BLOBDATA: {
-              incomplete_payload_ = OwnedMutBlob::allocate( expected_payload_length_.value() );
+              const size_t length = expected_payload_length_.value();
+              incomplete_payload_ = length >= DIRECT_PAYLOAD_THRESHOLD ? OwnedMutBlob::map( length )
+                                                                       : OwnedMutBlob::allocate( length );
               break;
             }
 
             case Message::Opcode::TREEDATA: {
-              incomplete_payload_
-                = OwnedMutTree::allocate( expected_payload_length_.value() / sizeof( Handle<Fix> ) );
+              const size_t length = expected_payload_length_.value() / sizeof( Handle<Fix> );
+              incomplete_payload_ = expected_payload_length_.value() >= DIRECT_PAYLOAD_THRESHOLD
+                                      ? OwnedMutTree::map( length )
+                                      : OwnedMutTree::allocate( length );
               break;
             }
 
@@ -205,6 +275,30 @@ size_t MessageParser::parse( string_view buf )
   return consumed_bytes;
 }
 
+span<char> MessageParser::direct_buffer()
+{
+  if ( not expected_payload_length_.has_value() or expected_payload_length_.value() < DIRECT_PAYLOAD_THRESHOLD ) {
+    return {};
+  }
+
+  return std::visit( overload {
+                       []( string& ) -> span<char> { return {}; },
+                       [&]( auto& arg ) -> span<char> {
+                         return { reinterpret_cast<char*>( arg.data() ) + completed_payload_length_,
+                                  expected_payload_length_.value() - completed_payload_length_ };
+                       },
+                     },
+                     incomplete_payload_ );
+}
+
+void MessageParser::direct_filled( size_t length )
+{
+  completed_payload_length_ += length;
+  if ( completed_payload_length_ == expected_payload_length_.value() ) {
+    complete_message();
+  }
+}
+
 template<FixType F>
 Handle<F> parse_handle( Parser& parser )
 {
@@ -228,6 +322,56 @@ void RunPayload::serialize( Serializer& serializer ) const
   serializer.integer( task.content );
 }
 
+RunBatchPayload RunBatchPayload::parse( Parser& parser )
+{
+  size_t count = 0;
+  parser.integer( count );
+  if ( parser.error() or count > parser.input().size() / sizeof( u8x32 ) ) {
+    throw runtime_error( "Failed to parse run batch." );
+  }
+
+  RunBatchPayload payload;
+  payload.tasks.reserve( count );
+  for ( size_t i = 0; i < count; i++ ) {
+    payload.tasks.push_back( parse_handle<Relation>( parser ) );
+  }
+  return payload;
+}
+
+void RunBatchPayload::serialize( Serializer& serializer ) const
+{
+  serializer.integer( tasks.size() );
+  for ( const auto& task : tasks ) {
+    serializer.integer( task.content );
+  }
+}
+
+ResultBatchPayload ResultBatchPayload::parse( Parser& parser )
+{
+  size_t count = 0;
+  parser.integer( count );
+  if ( parser.error() or count > parser.input().size() / ( 2 * sizeof( u8x32 ) ) ) {
+    throw runtime_error( "Failed to parse result batch." );
+  }
+
+  ResultBatchPayload payload;
+  payload.results.reserve( count );
+  for ( size_t i = 0; i < count; i++ ) {
+    auto task = parse_handle<Relation>( parser );
+    payload.results.emplace_back( task, parse_handle<Object>( parser ) );
+  }
+  return payload;
+}
+
+void ResultBatchPayload::serialize( Serializer& serializer ) const
+{
+  serializer.integer( results.size() );
+  for ( const auto& [task, result] : results ) {
+    serializer.integer( task.content );
+    serializer.integer( result.content );
+  }
+}
+
 RequestBlobPayload RequestBlobPayload::parse( Parser& parser )
 {
   return { .handle { parse_handle<Named>( parser ) } };
@@ -238,6 +382,45 @@ void RequestBlobPayload::serialize( Serializer& serializer ) const
   serializer.integer( handle.content );
 }
 
+RequestBlobRangePayload RequestBlobRangePayload::parse( Parser& parser )
+{
+  RequestBlobRangePayload payload { .handle { parse_handle<Named>( parser ) } };
+  parser.integer( payload.offset );
+  parser.integer( payload.length );
+  if ( parser.error() ) {
+    throw runtime_error( "Failed to parse blob range." );
+  }
+  return payload;
+}
+
+void RequestBlobRangePayload::serialize( Serializer& serializer ) const
+{
+  serializer.integer( handle.content );
+  serializer.integer( offset );
+  serializer.integer( length );
+}
+
+BlobRangePayload BlobRangePayload::parse( Parser& parser )
+{
+  BlobRangePayload payload { .handle { parse_handle<Named>( parser ) } };
+  parser.integer( payload.offset );
+  if ( parser.error() ) {
+    throw runtime_error( "Failed to parse blob range." );
+  }
+  payload.data = parser.input();
+  return payload;
+}
+
+BlobFdPayload BlobFdPayload::parse( Parser& parser )
+{
+  BlobFdPayload payload;
+  parser.integer( payload.size );
+  if ( parser.error() ) {
+    throw runtime_error( "Failed to parse blob descriptor." );
+  }
+  return payload;
+}
+
 RequestTreePayload RequestTreePayload::parse( Parser& parser )
 {
   return { .handle { parse_handle<AnyTree>( parser ) } };
@@ -287,19 +470,19 @@ InfoPayload InfoPayload::parse( Parser& parser )
     throw runtime_error( "Failed to parse link speed." );
   }
 
-  size_t data_entries {};
-  parser.integer<size_t>( data_entries );
+  uint64_t node {};
+  parser.integer( node );
   if ( parser.error() ) {
-    throw runtime_error( "Failed to parse number of entries in data." );
+    throw runtime_error( "Failed to parse node." );
   }
 
   InfoPayload payload;
   payload.parallelism = parallelism;
   payload.link_speed = link_speed;
-  payload.data.reserve( data_entries );
-
-  for ( size_t i = 0; i < data_entries; i++ ) {
-    payload.data.insert( parse_handle<AnyDataType>( parser ) );
+  payload.node = node;
+  payload.data = HandleFilter::parse( parser );
+  if ( parser.error() ) {
+    throw runtime_error( "Failed to parse data filter." );
   }
   return payload;
 }
@@ -308,10 +491,54 @@ void InfoPayload::serialize( Serializer& serializer ) const
 {
   serializer.integer( parallelism );
   serializer.integer( link_speed );
-  serializer.integer( data.size() );
-  for ( const auto& h : data ) {
-    serializer.integer( h.content );
+  serializer.integer( node );
+  data.serialize( serializer );
+}
+
+BroadcastPayload BroadcastPayload::parse( Parser& parser )
+{
+  BroadcastPayload payload { .handle = parse_handle<AnyDataType>( parser ) };
+  parser.integer( payload.origin );
+
+  size_t count = 0;
+  parser.integer( count );
+  if ( parser.error() or count > parser.input().size() / sizeof( uint64_t ) ) {
+    throw runtime_error( "Failed to parse broadcast." );
+  }
+
+  payload.forward.resize( count );
+  for ( auto& node : payload.forward ) {
+    parser.integer( node );
+  }
+  return payload;
+}
+
+void BroadcastPayload::serialize( Serializer& serializer ) const
+{
+  serializer.integer( handle.content );
+  serializer.integer( origin );
+  serializer.integer( forward.size() );
+  for ( const auto node : forward ) {
+    serializer.integer( node );
+  }
+}
+
+RelayedPayload RelayedPayload::parse( Parser& parser )
+{
+  RelayedPayload payload { .handle = parse_handle<AnyDataType>( parser ) };
+  parser.integer( payload.node );
+  parser.integer<bool>( payload.held );
+  if ( parser.error() ) {
+    throw runtime_error( "Failed to parse relayed." );
   }
+  return payload;
+}
+
+void RelayedPayload::serialize( Serializer& serializer ) const
+{
+  serializer.integer( handle.content );
+  serializer.integer( node );
+  serializer.integer<bool>( held );
 }
 
 ShallowTreeDataPayload ShallowTreeDataPayload::parse( Parser& parser )
@@ -1,10 +1,12 @@
 #pragma once
 
+#include <optional>
 #include <queue>
 #include <span>
 #include <variant>
 #include <vector>
 
+#include "file_descriptor.hh"
 #include "handle.hh"
 #include "interface.hh"
 #include "object.hh"
@@ -30,6 +32,13 @@ public:
     SHALLOWTREEDATA,
     PROPOSE_TRANSFER,
     ACCEPT_TRANSFER,
+    REQUESTBLOBRANGE,
+    BLOBRANGE,
+    BROADCAST,
+    BLOBFD,
+    RUN_BATCH,
+    RESULT_BATCH,
+    RELAYED,
     COUNT,
   };
 
@@ -46,7 +55,14 @@ public:
                                                                                        "LOADTREE",
                                                                                        "SHALLOWTREEDATA",
                                                                                        "PROPOSE_TRANSFER",
-                                                                                       "ACCEPT_TRANSFER" };
+                                                                                       "ACCEPT_TRANSFER",
+                                                                                       "REQUESTBLOBRANGE",
+                                                                                       "BLOBRANGE",
+                                                                                       "BROADCAST",
+                                                                                       "BLOBFD",
+                                                                                       "RUN_BATCH",
+                                                                                       "RESULT_BATCH",
+                                                                                       "RELAYED" };
 
   constexpr static size_t HEADER_LENGTH = sizeof( size_t ) + sizeof( Opcode );
 
@@ -87,6 +103,29 @@ struct ResultPayload
   size_t payload_length() const { return 2 * sizeof( u8x32 ); }
 };
 
+// Several RUN or RESULT messages in one, coalesced by the sender
+struct RunBatchPayload
+{
+  std::vector<Handle<Relation>> tasks {};
+
+  static RunBatchPayload parse( Parser& parser );
+  void serialize( Serializer& serializer ) const;
+
+  constexpr static Message::Opcode OPCODE = Message::Opcode::RUN_BATCH;
+  size_t payload_length() const { return sizeof( size_t ) + tasks.size() * sizeof( u8x32 ); }
+};
+
+struct ResultBatchPayload
+{
+  std::vector<std::pair<Handle<Relation>, Handle<Object>>> results {};
+
+  static ResultBatchPayload parse( Parser& parser );
+  void serialize( Serializer& serializer ) const;
+
+  constexpr static Message::Opcode OPCODE = Message::Opcode::RESULT_BATCH;
+  size_t payload_length() const { return sizeof( size_t ) + results.size() * 2 * sizeof( u8x32 ); }
+};
+
 struct RequestBlobPayload
 {
   Handle<Named> handle;
@@ -98,6 +137,43 @@ struct RequestBlobPayload
   size_t payload_length() const { return sizeof( u8x32 ); }
 };
 
+struct RequestBlobRangePayload
+{
+  Handle<Named> handle;
+  uint64_t offset {};
+  uint64_t length {};
+
+  static RequestBlobRangePayload parse( Parser& parser );
+  void serialize( Serializer& serializer ) const;
+
+  constexpr static Message::Opcode OPCODE = Message::Opcode::REQUESTBLOBRANGE;
+  size_t payload_length() const { return sizeof( u8x32 ) + 2 * sizeof( uint64_t ); }
+};
+
+// Sent with OutgoingMessage::blob_range, straight from the blob; this only parses a received range in place.
+struct BlobRangePayload
+{
+  Handle<Named> handle;
+  uint64_t offset {};
+  std::string_view data {};
+
+  static BlobRangePayload parse( Parser& parser );
+
+  constexpr static Message::Opcode OPCODE = Message::Opcode::BLOBRANGE;
+  constexpr static size_t PREFIX_LENGTH = sizeof( u8x32 ) + sizeof( uint64_t );
+};
+
+// Sent with OutgoingMessage::blob_fd to a peer on the same host. The blob itself travels as a sealed memfd
+// attached to the message, and only its size is in the payload.
+struct BlobFdPayload
+{
+  uint64_t size {};
+
+  static BlobFdPayload parse( Parser& parser );
+
+  constexpr static Message::Opcode OPCODE = Message::Opcode::BLOBFD;
+};
+
 struct RequestTreePayload
 {
   Handle<AnyTree> handle {};
@@ -124,7 +200,10 @@ struct InfoPayload
 {
   uint32_t parallelism {};
   double link_speed {};
-  std::unordered_set<Handle<AnyDataType>> data {};
+  // Identifies the sender among the nodes of a cluster, whichever address it is reached by
+  uint64_t node {};
+  // Summary of the data held by the sender
+  HandleFilter data {};
 
   static InfoPayload parse( Parser& parser );
   void serialize( Serializer& serializer ) const;
@@ -132,7 +211,7 @@ struct InfoPayload
   constexpr static Message::Opcode OPCODE = Message::Opcode::INFO;
   size_t payload_length() const
   {
-    return sizeof( uint32_t ) + sizeof( double ) + sizeof( size_t ) + data.size() * sizeof( u8x32 );
+    return sizeof( uint32_t ) + sizeof( double ) + sizeof( uint64_t ) + data.serialized_length();
   }
 };
 
@@ -188,6 +267,38 @@ struct TransferPayload
   }
 };
 
+// Data the receiver has just been sent, to be passed on to the listed nodes. Each node reached, or failed to be
+// reached, is reported back to the origin with a RelayedPayload.
+struct BroadcastPayload
+{
+  Handle<AnyDataType> handle {};
+  uint64_t origin {};
+  std::vector<uint64_t> forward {};
+
+  static BroadcastPayload parse( Parser& parser );
+  void serialize( Serializer& serializer ) const;
+
+  constexpr static Message::Opcode OPCODE = Message::Opcode::BROADCAST;
+  size_t payload_length() const
+  {
+    return sizeof( u8x32 ) + 2 * sizeof( uint64_t ) + forward.size() * sizeof( uint64_t );
+  }
+};
+
+// Whether a node now holds data relayed to it, or could not be sent it and has to be sent it directly
+struct RelayedPayload
+{
+  Handle<AnyDataType> handle {};
+  uint64_t node {};
+  bool held {};
+
+  static RelayedPayload parse( Parser& parser );
+  void serialize( Serializer& serializer ) const;
+
+  constexpr static Message::Opcode OPCODE = Message::Opcode::RELAYED;
+  size_t payload_length() const { return sizeof( u8x32 ) + sizeof( uint64_t ) + sizeof( bool ); }
+};
+
 using ProposeTransferPayload = TransferPayload<Message::Opcode::PROPOSE_TRANSFER>;
 using AcceptTransferPayload = TransferPayload<Message::Opcode::ACCEPT_TRANSFER>;
 
@@ -200,13 +311,16 @@ using MessagePayload = std::variant<RunPayload,
                                     ProposeTransferPayload,
                                     AcceptTransferPayload,
                                     RequestBlobPayload,
+                                    RequestBlobRangePayload,
                                     RequestTreePayload,
                                     RequestShallowTreePayload,
                                     BlobDataPayload,
                                     TreeDataPayload,
                                     LoadBlobPayload,
                                     LoadTreePayload,
-                                    ShallowTreeDataPayload>;
+                                    ShallowTreeDataPayload,
+                                    BroadcastPayload,
+                                    RelayedPayload>;
 
 class IncomingMessage : public Message
 {
@@ -237,6 +351,13 @@ public:
 class OutgoingMessage : public Message
 {
   std::variant<BlobData, TreeData, std::string> payload_ {};
+  // The header, followed by any fixed fields that precede a payload sent in place
+  std::string header_ {};
+  // Part of the payload to send, if not all of it
+  size_t slice_offset_ {};
+  std::optional<size_t> slice_length_ {};
+  // A descriptor to pass along with the message, over a Unix-domain socket
+  std::optional<FileDescriptor> fd_ {};
 
 public:
   OutgoingMessage( const Message::Opcode opcode, BlobData payload );
@@ -244,9 +365,19 @@ public:
   OutgoingMessage( const Message::Opcode opcode, std::string&& payload );
 
   static OutgoingMessage to_message( MessagePayload&& payload );
+  // A BLOBRANGE message carrying `length` bytes of blob from `offset`, without copying them
+  static OutgoingMessage blob_range( Handle<Named> handle, uint64_t offset, BlobData blob, size_t length );
+  // A BLOBFD message passing a copy of blob in a sealed memfd
+  static OutgoingMessage blob_fd( std::string_view blob );
+
   std::string_view payload();
-  void serialize_header( std::string& out );
+  void serialize_header( std::string& out, size_t prefix_length = 0 );
   size_t payload_length();
+
+  // The serialized header, which is sent immediately before payload()
+  std::string_view header() const { return header_; }
+  size_t length() { return header_.size() + payload_length(); }
+  const std::optional<FileDescriptor>& fd() const { return fd_; }
 };
 
 class MessageParser
@@ -265,8 +396,17 @@ private:
   void complete_message();
 
 public:
+  // BLOBDATA and TREEDATA payloads at least this large are received into page-aligned mappings
+  static constexpr size_t DIRECT_PAYLOAD_THRESHOLD = 1 << 16;
+
   size_t parse( std::string_view buf );
 
+  // Return the unfilled part of a large BLOBDATA or TREEDATA payload being received, so that the next bytes can be
+  // read into it directly; otherwise an empty span.
+  std::span<char> direct_buffer();
+  // Record that the first `length` bytes of direct_buffer() have been filled
+  void direct_filled( size_t length );
+
   bool empty() { return completed_messages_.empty(); }
   IncomingMessage& front() { return completed_messages_.front(); }
   void pop() { completed_messages_.pop(); }
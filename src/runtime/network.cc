@@ -1,11 +1,18 @@
 #include <atomic>
+#include <cstddef>
 #include <cstdint>
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <limits>
 #include <memory>
 #include <mutex>
+#include <random>
 #include <shared_mutex>
 #include <stdatomic.h>
 #include <stdexcept>
 #include <string>
+#include <sys/mman.h>
+#include <sys/un.h>
 #include <unordered_map>
 #include <utility>
 #include <variant>
@@ -13,45 +20,104 @@
 #include <glog/logging.h>
 
 #include "eventloop.hh"
+#include "exception.hh"
 #include "handle.hh"
 #include "handle_post.hh"
 #include "handle_util.hh"
 #include "message.hh"
 #include "network.hh"
 #include "object.hh"
+#include "trace.hh"
 #include "types.hh"
 
 using namespace std;
 using Opcode = Message::Opcode;
 
-void Remote::load_tx_message()
+void Remote::write_to_socket()
 {
-  if ( not current_msg_unsent_header_.empty() or not current_msg_unsent_payload_.empty() or tx_messages_.empty() )
-    throw runtime_error( "Unable to load" );
+  flush_batches();
+
+  // Gather the unsent headers and payloads of the queued messages in place
+  tx_buffers_.clear();
+  size_t skip = tx_sent_;
+  for ( size_t i = 0; i < min( tx_messages_.size(), MAX_GATHER ); i++ ) {
+    // A descriptor rides on the first byte of a send, so a message carrying one has to start it
+    if ( i > 0 and tx_messages_[i].fd() ) {
+      break;
+    }
+    for ( auto part : { tx_messages_[i].header(), tx_messages_[i].payload() } ) {
+      if ( skip >= part.size() ) {
+        skip -= part.size();
+        continue;
+      }
+      part.remove_prefix( skip );
+      skip = 0;
+      tx_buffers_.push_back( part );
+    }
+  }
+
+  if ( tx_rate_ ) {
+    size_t budget = tx_budget();
+    for ( size_t i = 0; i < tx_buffers_.size(); i++ ) {
+      if ( tx_buffers_[i].size() >= budget ) {
+        tx_buffers_[i] = tx_buffers_[i].substr( 0, budget );
+        tx_buffers_.resize( i + 1 );
+        break;
+      }
+      budget -= tx_buffers_[i].size();
+    }
+  }
+
+  const auto& fd = tx_messages_.front().fd();
+  const size_t written
+    = fd and tx_sent_ == 0 ? socket_.send_with_fd( tx_buffers_, *fd ) : socket_.write( tx_buffers_ );
+  tx_sent_ += written;
+  if ( tx_rate_ ) {
+    tx_tokens_ -= written;
+  }
 
-  tx_messages_.front().serialize_header( current_msg_header_ );
-  current_msg_unsent_header_ = current_msg_header_;
-  current_msg_unsent_payload_ = tx_messages_.front().payload();
+  while ( not tx_messages_.empty() and tx_sent_ >= tx_messages_.front().length() ) {
+    tx_sent_ -= tx_messages_.front().length();
+    tx_traffic_.log( tx_messages_.front().opcode(), tx_messages_.front().length() );
+    tx_messages_.pop_front();
+  }
+
+  link_.sent( written, not tx_messages_.empty() );
 }
 
-void Remote::write_to_rb()
+size_t Remote::tx_budget()
 {
-  if ( not current_msg_unsent_header_.empty() ) {
-    current_msg_unsent_header_.remove_prefix( tx_data_.push_from_const_str( current_msg_unsent_header_ ) );
-  } else if ( not current_msg_unsent_payload_.empty() ) {
-    current_msg_unsent_payload_.remove_prefix( tx_data_.push_from_const_str( current_msg_unsent_payload_ ) );
-  } else {
-    tx_messages_.pop();
+  if ( not tx_rate_ ) {
+    return numeric_limits<size_t>::max();
+  }
 
-    if ( not tx_messages_.empty() ) {
-      load_tx_message();
-    }
+  // Bursts of up to 10 ms at the limit, and never less than one ring buffer
+  const auto now = LinkEstimator::clock::now();
+  const double burst = max<double>( tx_rate_ / 100, STORAGE_SIZE );
+  const double elapsed = chrono::duration<double>( now - tx_refilled_ ).count();
+  tx_tokens_ = min( burst, tx_tokens_ + elapsed * tx_rate_ );
+  tx_refilled_ = now;
+  return tx_tokens_;
+}
+
+size_t Remote::receive( span<char> buffer )
+{
+  if ( not local_ ) {
+    return socket_.read( buffer );
+  }
+
+  vector<FileDescriptor> fds;
+  const size_t length = socket_.recv_with_fds( buffer, fds );
+  for ( auto& fd : fds ) {
+    rx_fds_.push_back( move( fd ) );
   }
+  return length;
 }
 
 void Remote::read_from_rb()
 {
   rx_data_.pop( rx_messages_.parse( rx_data_.readable_region() ) );
+  events_.interest_changed( socket_ );
 }
 
 void Remote::send_blob( BlobData blob )
@@ -75,18 +141,64 @@ void Remote::send_tree( Handle<AnyTree> handle, TreeData )
 
 void Remote::push_message( OutgoingMessage&& msg )
 {
+  if ( local_ and not tx_rate_ and msg.opcode() == Opcode::BLOBDATA
+       and msg.payload_length() >= FD_PAYLOAD_THRESHOLD ) {
+    msg = OutgoingMessage::blob_fd( msg.payload() );
+  }
+
   VLOG( 1 ) << "push_message " << Message::OPCODE_NAMES[static_cast<uint8_t>( msg.opcode() )];
-  tx_messages_.push( move( msg ) );
+  tx_messages_.push_back( move( msg ) );
+  events_.interest_changed( socket_ );
+}
 
-  if ( current_msg_unsent_header_.empty() and current_msg_unsent_payload_.empty() ) {
-    load_tx_message();
+void Remote::push_message( RunPayload run )
+{
+  trace( Tracer::Event::SentRun, run.task );
+  tx_runs_.tasks.push_back( run.task );
+  if ( tx_runs_.tasks.size() >= MAX_BATCH ) {
+    flush_batches();
   }
+  events_.interest_changed( socket_ );
+}
+
+void Remote::push_message( ResultPayload result )
+{
+  trace( Tracer::Event::SentResult, result.task );
+  tx_results_.results.emplace_back( result.task, result.result );
+  if ( tx_results_.results.size() >= MAX_BATCH ) {
+    flush_batches();
+  }
+  events_.interest_changed( socket_ );
+}
+
+void Remote::flush_batches()
+{
+  if ( tx_runs_.tasks.size() == 1 ) {
+    push_message( OutgoingMessage::to_message( RunPayload { .task = tx_runs_.tasks.front() } ) );
+  } else if ( not tx_runs_.tasks.empty() ) {
+    push_message( { Opcode::RUN_BATCH, serialize( tx_runs_ ) } );
+  }
+  tx_runs_.tasks.clear();
+
+  if ( tx_results_.results.size() == 1 ) {
+    const auto& [task, result] = tx_results_.results.front();
+    push_message( OutgoingMessage::to_message( ResultPayload { .task = task, .result = result } ) );
+  } else if ( not tx_results_.results.empty() ) {
+    push_message( { Opcode::RESULT_BATCH, serialize( tx_results_ ) } );
+  }
+  tx_results_.results.clear();
+}
+
+void Remote::enqueue( MessagePayload&& payload )
+{
+  msg_q_.enqueue( make_pair( index_, move( payload ) ) );
+  events_.notify();
 }
 
 optional<BlobData> Remote::get( Handle<Named> name )
 {
   RequestBlobPayload payload { .handle = name };
-  msg_q_.enqueue( make_pair( index_, move( payload ) ) );
+  enqueue( move( payload ) );
 
   return {};
 }
@@ -94,7 +206,7 @@ optional<BlobData> Remote::get( Handle<Named> name )
 optional<TreeData> Remote::get( Handle<AnyTree> name )
 {
   RequestTreePayload payload { .handle = name };
-  msg_q_.enqueue( make_pair( index_, move( payload ) ) );
+  enqueue( move( payload ) );
 
   return {};
 }
@@ -102,7 +214,7 @@ optional<TreeData> Remote::get( Handle<AnyTree> name )
 optional<TreeData> Remote::get_shallow( Handle<AnyTree> name )
 {
   RequestShallowTreePayload payload { .handle = name };
-  msg_q_.enqueue( make_pair( index_, move( payload ) ) );
+  enqueue( move( payload ) );
 
   return {};
 }
@@ -117,16 +229,16 @@ optional<Handle<Object>> Remote::get( Handle<Relation> name )
         []( Handle<Relation> ) {},
         [&]( Handle<Named> x ) {
           if ( !contains( x ) ) {
-            msg_q_.enqueue( make_pair( index_, make_pair( x, parent_.value().get().get( x ).value() ) ) );
+            enqueue( make_pair( x, parent_.value().get().get( x ).value() ) );
           } else if ( !loaded( x ) ) {
-            msg_q_.enqueue( make_pair( index_, LoadBlobPayload( x ) ) );
+            enqueue( LoadBlobPayload( x ) );
           }
         },
         [&]( auto x ) {
           if ( !contains( x ) ) {
-            msg_q_.enqueue( make_pair( index_, make_pair( x, parent_.value().get().get( x ).value() ) ) );
+            enqueue( make_pair( x, parent_.value().get().get( x ).value() ) );
           } else if ( !loaded( x ) ) {
-            msg_q_.enqueue( make_pair( index_, LoadTreePayload( x ) ) );
+            enqueue( LoadTreePayload( x ) );
           }
         },
       } );
@@ -134,7 +246,7 @@ optional<Handle<Object>> Remote::get( Handle<Relation> name )
   }
 
   RunPayload payload { .task = name };
-  msg_q_.enqueue( make_pair( index_, move( payload ) ) );
+  enqueue( move( payload ) );
 
   return {};
 }
@@ -142,9 +254,9 @@ optional<Handle<Object>> Remote::get( Handle<Relation> name )
 void Remote::put( Handle<Named> name, BlobData data )
 {
   if ( !contains( name ) ) {
-    msg_q_.enqueue( make_pair( index_, make_pair( name, data ) ) );
+    enqueue( make_pair( name, data ) );
   } else if ( !loaded( name ) ) {
-    msg_q_.enqueue( make_pair( index_, LoadBlobPayload( name ) ) );
+    enqueue( LoadBlobPayload( name ) );
   }
 }
 
@@ -157,29 +269,29 @@ void Remote::put( Handle<AnyTree> name, TreeData )
         []( Handle<Relation> ) {},
         [&]( Handle<Named> x ) {
           if ( !contains( x ) ) {
-            msg_q_.enqueue( make_pair( index_, make_pair( x, parent_.value().get().get( x ).value() ) ) );
+            enqueue( make_pair( x, parent_.value().get().get( x ).value() ) );
           } else if ( !loaded( x ) ) {
-            msg_q_.enqueue( make_pair( index_, LoadBlobPayload( x ) ) );
+            enqueue( LoadBlobPayload( x ) );
           }
         },
         [&]( auto x ) {
           if ( !contains( x ) ) {
-            msg_q_.enqueue( make_pair( index_, make_pair( x, parent_.value().get().get( x ).value() ) ) );
+            enqueue( make_pair( x, parent_.value().get().get( x ).value() ) );
           } else if ( !loaded( x ) ) {
-            msg_q_.enqueue( make_pair( index_, LoadTreePayload( x ) ) );
+            enqueue( LoadTreePayload( x ) );
           }
         },
       } );
     } );
   } else if ( !loaded( name ) ) {
-    msg_q_.enqueue( make_pair( index_, LoadTreePayload( name ) ) );
+    enqueue( LoadTreePayload( name ) );
   }
 }
 
 void Remote::put_shallow( Handle<AnyTree> name, TreeData data )
 {
   if ( !loaded( name ) ) {
-    msg_q_.enqueue( make_pair( index_, ShallowTreeDataPayload( name, data ) ) );
+    enqueue( ShallowTreeDataPayload( name, data ) );
   }
 }
 
@@ -195,16 +307,16 @@ void Remote::put( Handle<Relation> name, Handle<Object> data )
           []( Handle<Relation> ) {},
           [&]( Handle<Named> x ) {
             if ( !contains( x ) ) {
-              msg_q_.enqueue( make_pair( index_, make_pair( x, parent_.value().get().get( x ).value() ) ) );
+              enqueue( make_pair( x, parent_.value().get().get( x ).value() ) );
             } else if ( !loaded( x ) ) {
-              msg_q_.enqueue( make_pair( index_, LoadBlobPayload( x ) ) );
+              enqueue( LoadBlobPayload( x ) );
             }
           },
           [&]( auto x ) {
             if ( !contains( x ) ) {
-              msg_q_.enqueue( make_pair( index_, make_pair( x, parent_.value().get().get( x ).value() ) ) );
+              enqueue( make_pair( x, parent_.value().get().get( x ).value() ) );
             } else if ( !loaded( x ) ) {
-              msg_q_.enqueue( make_pair( index_, LoadTreePayload( x ) ) );
+              enqueue( LoadTreePayload( x ) );
             }
           },
         } );
@@ -212,7 +324,7 @@ void Remote::put( Handle<Relation> name, Handle<Object> data )
 
       VLOG( 2 ) << "Putting result to remote " << name << " " << data;
       ResultPayload payload { .task = name, .result = data };
-      msg_q_.enqueue( make_pair( index_, move( payload ) ) );
+      enqueue( move( payload ) );
     }
     reply_to_.erase( name );
   }
@@ -228,16 +340,16 @@ void Remote::put_force( Handle<Relation> name, Handle<Object> data )
         []( Handle<Relation> ) {},
         [&]( Handle<Named> x ) {
           if ( !contains( x ) ) {
-            msg_q_.enqueue( make_pair( index_, make_pair( x, parent_.value().get().get( x ).value() ) ) );
+            enqueue( make_pair( x, parent_.value().get().get( x ).value() ) );
           } else if ( !loaded( x ) ) {
-            msg_q_.enqueue( make_pair( index_, LoadBlobPayload( x ) ) );
+            enqueue( LoadBlobPayload( x ) );
           }
         },
         [&]( auto x ) {
           if ( !contains( x ) ) {
-            msg_q_.enqueue( make_pair( index_, make_pair( x, parent_.value().get().get( x ).value() ) ) );
+            enqueue( make_pair( x, parent_.value().get().get( x ).value() ) );
           } else if ( !loaded( x ) ) {
-            msg_q_.enqueue( make_pair( index_, LoadTreePayload( x ) ) );
+            enqueue( LoadTreePayload( x ) );
           }
         },
       } );
@@ -245,14 +357,18 @@ void Remote::put_force( Handle<Relation> name, Handle<Object> data )
 
     VLOG( 2 ) << "Putting result to remote " << name << " " << data;
     ResultPayload payload { .task = name, .result = data };
-    msg_q_.enqueue( make_pair( index_, move( payload ) ) );
+    enqueue( move( payload ) );
   }
   reply_to_.erase( name );
 }
 
 bool Remote::contains( Handle<Named> handle )
 {
-  return blobs_view_.contains( handle );
+  if ( blobs_view_.contains( handle ) ) {
+    return true;
+  }
+  auto filter = remote_data_.load( memory_order_acquire );
+  return filter and filter->may_contain( handle );
 }
 
 bool Remote::loaded( Handle<Named> handle )
@@ -271,7 +387,11 @@ void Remote::add_to_view( Handle<Named> handle )
 
 bool Remote::contains( Handle<AnyTree> handle )
 {
-  return trees_view_.contains( handle );
+  if ( trees_view_.contains( handle ) ) {
+    return true;
+  }
+  auto filter = remote_data_.load( memory_order_acquire );
+  return filter and filter->may_contain( handle );
 }
 
 bool Remote::loaded( Handle<AnyTree> handle )
@@ -293,6 +413,7 @@ void Remote::add_to_view( Handle<AnyTree> handle )
   trees_view_.get_ref( handle ).store( true, memory_order_release );
 }
 
+// Only the exact view: pruning a dependency on a false positive would leave nothing to recover it, unlike data
 bool Remote::contains( Handle<Relation> handle )
 {
   return relations_view_.contains( handle );
@@ -341,20 +462,64 @@ bool Remote::contains( __attribute__( ( unused ) ) const std::string_view label
   return false;
 }
 
+bool Remote::relay( Handle<AnyDataType> handle, const vector<shared_ptr<IRuntime>>& peers )
+{
+  if ( node_.load( memory_order_acquire ) == 0 ) {
+    return false;
+  }
+
+  vector<shared_ptr<Remote>> remotes;
+  BroadcastPayload payload { .handle = handle, .origin = NetworkWorker::node_id() };
+  for ( const auto& peer : peers ) {
+    auto remote = dynamic_pointer_cast<Remote>( peer );
+    if ( not remote or remote->node_.load( memory_order_acquire ) == 0 ) {
+      return false;
+    }
+    remotes.push_back( remote );
+    payload.forward.push_back( remote->node_.load( memory_order_acquire ) );
+  }
+
+  // The peers will be sent the data by whoever forwards it to them, over another connection, so their RUNs are
+  // held back until they report holding it
+  for ( const auto& remote : remotes ) {
+    std::visit( overload {
+                  [&]( Handle<Named> n ) { remote->add_to_view( n ); },
+                  [&]( Handle<AnyTree> t ) { remote->add_to_view( t ); },
+                  []( Handle<Literal> ) {},
+                  []( Handle<Relation> ) {},
+                },
+                handle.get() );
+    unique_lock lock( remote->mutex_ );
+    remote->relays_pending_.insert( handle );
+  }
+
+  enqueue( move( payload ) );
+  return true;
+}
+
 std::optional<IRuntime::Info> Remote::get_info()
 {
   shared_lock lock( mutex_ );
-  return info_;
+  auto info = info_;
+  // Prefer what this side measured over the link speed the remote reported
+  if ( info.has_value() and link_.bandwidth() > 0 ) {
+    info->link_speed = link_.bandwidth();
+  }
+  return info;
 }
 
 Remote::Remote( EventLoop& events,
                 EventCategories categories,
-                TCPSocket socket,
+                Socket socket,
                 size_t index,
                 MessageQueue& msg_q,
+                NetworkWorker& worker,
                 optional<reference_wrapper<MultiWorkerRuntime>> parent )
   : socket_( move( socket ) )
+  , local_( socket_.domain() == AF_UNIX )
+  , events_( events )
   , msg_q_( msg_q )
+  , worker_( worker )
   , parent_( parent )
   , index_( index )
 {
@@ -362,7 +527,15 @@ Remote::Remote( EventLoop& events,
     categories.rx_read_data,
     socket_,
     Direction::In,
-    [&] { rx_data_.push_from_fd( socket_ ); },
+    [&] {
+      // Once everything buffered has been parsed, read the rest of a large payload straight into its final buffer
+      auto direct = rx_messages_.direct_buffer();
+      if ( not direct.empty() and not rx_data_.can_read() ) {
+        rx_messages_.direct_filled( receive( direct ) );
+      } else {
+        rx_data_.push( receive( rx_data_.writable_region() ) );
+      }
+    },
     [&] { return rx_data_.can_write(); },
     [&] { this->clean_up(); } ) );
 
@@ -370,17 +543,13 @@ Remote::Remote( EventLoop& events,
     categories.tx_write_data,
     socket_,
     Direction::Out,
-    [&] { tx_data_.pop_to_fd( socket_ ); },
-    [&] { return tx_data_.can_read(); },
+    [&] { write_to_socket(); },
+    [&] { return tx_pending() and tx_budget() > 0; },
     [&] { this->clean_up(); } ) );
 
+  // The rules below change the interest of the socket's rules only through read_from_rb and push_message
   install_rule( events.add_rule(
-    categories.rx_parse_msg, [&] { read_from_rb(); }, [&] { return rx_data_.can_read(); } ) );
-
-  install_rule( events.add_rule(
-    categories.tx_serialize_msg,
-    [&] { write_to_rb(); },
-    [&] { return not tx_messages_.empty() and tx_data_.can_write(); } ) );
+    categories.rx_parse_msg, [&] { read_from_rb(); }, [&] { return rx_data_.can_read(); }, Rearm::Explicit ) );
 
   install_rule( events.add_rule(
     categories.rx_process_msg,
@@ -389,13 +558,20 @@ Remote::Remote( EventLoop& events,
       rx_messages_.pop();
       process_incoming_message( move( message ) );
     },
-    [&] { return not rx_messages_.empty(); } ) );
+    [&] { return not rx_messages_.empty(); },
+    Rearm::Explicit ) );
 
+  info_requested_ = LinkEstimator::clock::now();
   push_message( { Opcode::REQUESTINFO, string( "" ) } );
 }
 
 void Remote::process_incoming_message( IncomingMessage&& msg )
 {
+  const size_t payload_length = std::visit( overload { []( const string& s ) { return s.size(); },
+                                                       []( const auto& data ) { return data.span().size_bytes(); } },
+                                            msg.payload() );
+  rx_traffic_.log( msg.opcode(), Message::HEADER_LENGTH + payload_length );
+
   if ( !parent_.has_value() )
     return;
 
@@ -407,6 +583,7 @@ void Remote::process_incoming_message( IncomingMessage&& msg )
     case Opcode::RUN: {
       auto payload = parse<RunPayload>( std::get<string>( msg.payload() ) );
       auto task = payload.task;
+      trace( Tracer::Event::ReceivedRun, task );
       {
         unique_lock lock( mutex_ );
         reply_to_.insert( task );
@@ -421,45 +598,61 @@ void Remote::process_incoming_message( IncomingMessage&& msg )
 
     case Opcode::RESULT: {
       auto payload = parse<ResultPayload>( std::get<string>( msg.payload() ) );
+      trace( Tracer::Event::ReceivedResult, payload.task );
       pending_result_.erase( payload.task );
       parent.put( payload.task, payload.result );
       break;
     }
 
+    case Opcode::RUN_BATCH: {
+      auto payload = parse<RunBatchPayload>( std::get<string>( msg.payload() ) );
+      {
+        unique_lock lock( mutex_ );
+        reply_to_.insert( payload.tasks.begin(), payload.tasks.end() );
+      }
+
+      for ( const auto task : payload.tasks ) {
+        trace( Tracer::Event::ReceivedRun, task );
+      }
+      const auto results = parent.get_relations( payload.tasks );
+      for ( size_t i = 0; i < results.size(); i++ ) {
+        if ( results[i].has_value() ) {
+          this->put( payload.tasks[i], results[i].value() );
+        }
+      }
+      break;
+    }
+
+    case Opcode::RESULT_BATCH: {
+      auto payload = parse<ResultBatchPayload>( std::get<string>( msg.payload() ) );
+      for ( const auto& [task, _] : payload.results ) {
+        trace( Tracer::Event::ReceivedResult, task );
+        pending_result_.erase( task );
+      }
+      parent.put_results( payload.results );
+      break;
+    }
+
     case Opcode::REQUESTINFO: {
       auto parent_info = parent.get_info().value_or( IRuntime::Info { .parallelism = 0, .link_speed = 0 } );
-      InfoPayload payload {
-        .parallelism = parent_info.parallelism, .link_speed = parent_info.link_speed, .data = parent.data() };
+      InfoPayload payload { .parallelism = parent_info.parallelism,
+                            .link_speed = parent_info.link_speed,
+                            .node = NetworkWorker::node_id(),
+                            .data = parent.data_filter() };
       push_message( OutgoingMessage::to_message( move( payload ) ) );
       break;
     }
 
     case Opcode::INFO: {
       auto payload = parse<InfoPayload>( std::get<string>( msg.payload() ) );
+      link_.rtt_sample( LinkEstimator::clock::now() - info_requested_ );
+      remote_data_.store( make_shared<const HandleFilter>( move( payload.data ) ), memory_order_release );
+      node_.store( payload.node, memory_order_release );
       {
         unique_lock lock( mutex_ );
         info_ = { .parallelism = payload.parallelism, .link_speed = payload.link_speed };
         info_cv_.notify_all();
       }
-
-      for ( auto handle : payload.data ) {
-        handle.visit<void>( overload {
-          [&]( Handle<Named> h ) {
-            blobs_view_.insert_no_value( h );
-            blobs_view_.get_ref( h ).store( false, memory_order_release );
-          },
-          [&]( Handle<AnyTree> t ) {
-            trees_view_.insert_no_value( t );
-            trees_view_.get_ref( t ).store( false, memory_order_release );
-          },
-          []( Handle<Literal> ) {},
-          [&]( Handle<Relation> r ) {
-            relations_view_.insert_no_value( r );
-            relations_view_.get_ref( r ).store( false, memory_order_release );
-          },
-        } );
-      }
-
       break;
     }
 
@@ -493,20 +686,126 @@ void Remote::process_incoming_message( IncomingMessage&& msg )
       break;
     }
 
+    case Opcode::REQUESTBLOBRANGE: {
+      auto payload = parse<RequestBlobRangePayload>( std::get<string>( msg.payload() ) );
+      if ( parent.contains( payload.handle ) ) {
+        auto blob = parent.get( payload.handle ).value();
+        const uint64_t offset = min<uint64_t>( payload.offset, blob->size() );
+        push_message(
+          OutgoingMessage::blob_range( payload.handle, offset, blob, min( payload.length, blob->size() - offset ) ) );
+      } else {
+        // An empty range tells the requester to get the blob elsewhere
+        push_message( OutgoingMessage::blob_range(
+          payload.handle, payload.offset, make_shared<OwnedBlob>( OwnedMutBlob::allocate( 0 ) ), 0 ) );
+      }
+      break;
+    }
+
     case Opcode::BLOBDATA: {
       parent.create( msg.get_blob() );
       break;
     }
 
+    case Opcode::BLOBFD: {
+      auto payload = parse<BlobFdPayload>( std::get<string>( msg.payload() ) );
+      if ( rx_fds_.empty() ) {
+        throw runtime_error( "BLOBFD without a file descriptor" );
+      }
+      auto fd = move( rx_fds_.front() );
+      rx_fds_.pop_front();
+
+      // Map the sender's memfd in place; its seals guarantee it cannot change or shrink underneath the mapping
+      constexpr int seals = F_SEAL_WRITE | F_SEAL_SHRINK;
+      if ( ( CheckSystemCall( "fcntl", fcntl( fd.fd_num(), F_GET_SEALS ) ) & seals ) != seals
+           or static_cast<uint64_t>( fd.size() ) != payload.size ) {
+        throw runtime_error( "BLOBFD with an unsealed or mis-sized file descriptor" );
+      }
+
+      if ( payload.size == 0 ) {
+        parent.create( make_shared<OwnedBlob>( OwnedMutBlob::allocate( 0 ) ) );
+        break;
+      }
+
+      void* data = mmap( nullptr, payload.size, PROT_READ, MAP_SHARED, fd.fd_num(), 0 );
+      if ( data == MAP_FAILED ) {
+        throw unix_error( "mmap" );
+      }
+      const BlobSpan mapped { static_cast<const char*>( data ), payload.size };
+      parent.create( make_shared<OwnedBlob>( mapped, AllocationType::Mapped ) );
+      break;
+    }
+
+    case Opcode::BROADCAST: {
+      auto payload = parse<BroadcastPayload>( std::get<string>( msg.payload() ) );
+      // The data came ahead of this message on the same connection
+      auto held = std::visit( overload {
+                                [&]( Handle<Named> n ) {
+                                  add_to_view( n );
+                                  return parent.contains( n );
+                                },
+                                [&]( Handle<AnyTree> t ) {
+                                  add_to_view( t );
+                                  return parent.contains( t );
+                                },
+                                []( Handle<Literal> ) { return true; },
+                                []( Handle<Relation> ) { return false; },
+                              },
+                              payload.handle.get() );
+
+      if ( held ) {
+        worker_.send_to_node(
+          payload.origin,
+          RelayedPayload { .handle = payload.handle, .node = NetworkWorker::node_id(), .held = true } );
+        worker_.forward( payload.handle, payload.origin, payload.forward );
+      } else {
+        LOG( WARNING ) << "Cannot forward " << payload.handle << " to " << payload.forward.size() << " nodes";
+        payload.forward.push_back( NetworkWorker::node_id() );
+        for ( const auto node : payload.forward ) {
+          worker_.send_to_node( payload.origin, RelayedPayload { .handle = payload.handle, .node = node } );
+        }
+      }
+      break;
+    }
+
+    // Pass it on to the connection to the node it is about, which the data was relayed to. A node the data was
+    // sent to directly reports too, and the origin, not waiting on it, hands the report back; it ends here.
+    case Opcode::RELAYED: {
+      auto payload = parse<RelayedPayload>( std::get<string>( msg.payload() ) );
+      if ( payload.node != NetworkWorker::node_id() ) {
+        worker_.send_to_node( payload.node, payload );
+      }
+      break;
+    }
+
+    case Opcode::BLOBRANGE: {
+      auto payload = parse<BlobRangePayload>( std::get<string>( msg.payload() ) );
+      std::visit( overload {
+                    []( std::monostate ) {},
+                    [&]( const StripedFetches::Complete& complete ) { parent.create( complete.blob ); },
+                    [&]( const StripedFetches::Fallback& fallback ) {
+                      if ( auto origin = fallback.origin.lock() ) {
+                        origin->get( payload.handle );
+                      }
+                    },
+                  },
+                  worker_.fetches_.receive( payload.handle, payload.offset, payload.data ) );
+      break;
+    }
+
     case Opcode::TREEDATA: {
       parent.create( msg.get_tree() );
       break;
     }
 
+    // The remote only sends these instead of the data when it believes we hold it, which a false positive of our
+    // data filter can make it believe wrongly; in that case, ask it for the data.
     case Opcode::LOADBLOB: {
       auto payload = parse<LoadBlobPayload>( std::get<string>( msg.payload() ) );
       if ( parent.contains( payload.handle.unwrap<Named>() ) ) {
         parent.get( payload.handle.unwrap<Named>() );
+      } else {
+        push_message(
+          OutgoingMessage::to_message( RequestBlobPayload { .handle = payload.handle.unwrap<Named>() } ) );
       }
       break;
     }
@@ -515,6 +814,8 @@ void Remote::process_incoming_message( IncomingMessage&& msg )
       auto payload = parse<LoadTreePayload>( std::get<string>( msg.payload() ) );
       if ( parent.contains( payload.handle ) ) {
         parent.get( payload.handle );
+      } else {
+        push_message( OutgoingMessage::to_message( RequestTreePayload { .handle = payload.handle } ) );
       }
       break;
     }
@@ -578,6 +879,11 @@ void Remote::process_incoming_message( IncomingMessage&& msg )
         throw std::runtime_error( "Mismatch propose and accept" );
       }
 
+      if ( not proposals_sent_.empty() ) {
+        link_.rtt_sample( LinkEstimator::clock::now() - proposals_sent_.front() );
+        proposals_sent_.pop();
+      }
+
       VLOG( 1 ) << "Sending " << handles.size() << " objects for " << todo;
       for ( const auto& h : handles ) {
         VLOG( 2 ) << "Sending " << handle::fix( h );
@@ -614,10 +920,10 @@ void Remote::process_incoming_message( IncomingMessage&& msg )
       proposed_proposals_.pop();
 
       if ( result ) {
-        push_message( OutgoingMessage::to_message( ResultPayload { .task = todo, .result = *result } ) );
+        push_message( ResultPayload { .task = todo, .result = *result } );
         add_to_view( todo );
       } else {
-        push_message( OutgoingMessage::to_message( RunPayload { .task = todo } ) );
+        push_message( RunPayload { .task = todo } );
       }
 
       while ( !proposed_proposals_.empty() ) {
@@ -626,11 +932,10 @@ void Remote::process_incoming_message( IncomingMessage&& msg )
           auto pending_todo = proposed_proposals_.front().first.first;
           auto pending_result = proposed_proposals_.front().first.second;
           if ( pending_result ) {
-            push_message(
-              OutgoingMessage::to_message( ResultPayload { .task = pending_todo, .result = *pending_result } ) );
+            push_message( ResultPayload { .task = pending_todo, .result = *pending_result } );
             add_to_view( pending_todo );
           } else {
-            push_message( OutgoingMessage::to_message( RunPayload { .task = pending_todo } ) );
+            push_message( RunPayload { .task = pending_todo } );
           }
 
           proposed_proposals_.pop();
@@ -659,6 +964,13 @@ Remote::~Remote()
 {
   socket_.close();
 
+  // Fetches waiting on a stripe from this connection will not complete
+  for ( auto& [name, fallback] : worker_.fetches_.abandon( index_ ) ) {
+    if ( auto origin = fallback.origin.lock() ) {
+      origin->get( name );
+    }
+  }
+
   // Cancel rules
   for ( auto& handle : installed_rules_ ) {
     handle.cancel();
@@ -703,14 +1015,24 @@ void NetworkWorker::process_outgoing_message( size_t remote_idx, MessagePayload&
           }
         },
         [&]( RunPayload r ) {
+          {
+            unique_lock lock( connection.mutex_ );
+            if ( not connection.relays_pending_.empty() ) {
+              connection.held_runs_.push_back( r.task );
+              connection.pending_result_.insert( r.task );
+              return;
+            }
+          }
+
           if ( connection.incomplete_proposal_->empty() && connection.proposed_proposals_.empty() ) {
             VLOG( 2 ) << "No proposal sending run directly";
-            connection.push_message( OutgoingMessage::to_message( r ) );
+            connection.push_message( r );
           } else if ( connection.incomplete_proposal_->empty() ) {
             // Payload should be sent after last proposed_proposals_ is sent
             connection.proposed_proposals_.push( { pair<Handle<Relation>, optional<Handle<Object>>> { r.task, {} },
                                                    make_unique<Remote::DataProposal>() } );
-          } else if ( connection.proposal_size_ < 1048576 && connection.proposed_proposals_.empty() ) {
+          } else if ( connection.proposal_size_ < connection.link_.eager_threshold()
+                      && connection.proposed_proposals_.empty() ) {
             VLOG( 2 ) << "Proposal too small, sending directly " << remote_idx;
             for ( const auto& [name, data] : *connection.incomplete_proposal_ ) {
               auto h = name;
@@ -727,7 +1049,7 @@ void NetworkWorker::process_outgoing_message( size_t remote_idx, MessagePayload&
                 []( Handle<Relation> ) {},
               } );
             }
-            connection.push_message( OutgoingMessage::to_message( r ) );
+            connection.push_message( r );
             connection.incomplete_proposal_ = make_unique<Remote::DataProposal>();
             connection.proposal_size_ = 0;
           } else {
@@ -737,6 +1059,7 @@ void NetworkWorker::process_outgoing_message( size_t remote_idx, MessagePayload&
               payload.handles.push_back( name );
             }
             connection.push_message( OutgoingMessage::to_message( move( payload ) ) );
+            connection.proposals_sent_.push( LinkEstimator::clock::now() );
             connection.proposed_proposals_.push( { pair<Handle<Relation>, optional<Handle<Object>>> { r.task, {} },
                                                    std::move( connection.incomplete_proposal_ ) } );
             connection.incomplete_proposal_ = make_unique<Remote::DataProposal>();
@@ -748,14 +1071,15 @@ void NetworkWorker::process_outgoing_message( size_t remote_idx, MessagePayload&
         [&]( ResultPayload r ) {
           if ( connection.incomplete_proposal_->empty() && connection.proposed_proposals_.empty() ) {
             VLOG( 2 ) << "No proposal sending result directly";
-            connection.push_message( OutgoingMessage::to_message( r ) );
+            connection.push_message( r );
             connection.add_to_view( r.task );
           } else if ( connection.incomplete_proposal_->empty() ) {
             // Paylod should be send after last proposed_proposals_ is sent
             connection.proposed_proposals_.push(
               { pair<Handle<Relation>, optional<Handle<Object>>> { r.task, r.result },
                 make_unique<Remote::DataProposal>() } );
-          } else if ( connection.proposal_size_ < 1048576 && connection.proposed_proposals_.empty() ) {
+          } else if ( connection.proposal_size_ < connection.link_.eager_threshold()
+                      && connection.proposed_proposals_.empty() ) {
             // Proposal too small, sending directly
             for ( const auto& [name, data] : *connection.incomplete_proposal_ ) {
               auto h = name;
@@ -772,7 +1096,7 @@ void NetworkWorker::process_outgoing_message( size_t remote_idx, MessagePayload&
                 []( Handle<Relation> ) {},
               } );
             }
-            connection.push_message( OutgoingMessage::to_message( r ) );
+            connection.push_message( r );
             connection.add_to_view( r.task );
             connection.incomplete_proposal_ = make_unique<Remote::DataProposal>();
             connection.proposal_size_ = 0;
@@ -785,6 +1109,7 @@ void NetworkWorker::process_outgoing_message( size_t remote_idx, MessagePayload&
               payload.handles.push_back( name );
             }
             connection.push_message( OutgoingMessage::to_message( move( payload ) ) );
+            connection.proposals_sent_.push( LinkEstimator::clock::now() );
             connection.proposed_proposals_.push(
               { pair<Handle<Relation>, optional<Handle<Object>>> { r.task, r.result },
                 std::move( connection.incomplete_proposal_ ) } );
@@ -792,6 +1117,86 @@ void NetworkWorker::process_outgoing_message( size_t remote_idx, MessagePayload&
             connection.proposal_size_ = 0;
           }
         },
+        [&]( RequestBlobPayload&& payload ) {
+          // Large blobs held by several peers are fetched in stripes, one from each
+          if ( payload.handle.size() >= StripedFetches::THRESHOLD ) {
+            auto connections = connections_.read();
+            vector<size_t> replicas;
+            for ( const auto& [id, remote] : connections.get() ) {
+              if ( not remote->dead() and remote->contains( payload.handle ) ) {
+                replicas.push_back( id );
+              }
+            }
+
+            if ( auto stripes = fetches_.start( payload.handle, connections->at( remote_idx ), replicas ) ) {
+              for ( const auto& stripe : *stripes ) {
+                connections->at( stripe.replica )
+                  ->enqueue( RequestBlobRangePayload {
+                    .handle = payload.handle, .offset = stripe.offset, .length = stripe.length } );
+              }
+              return;
+            }
+          }
+          connection.push_message( OutgoingMessage::to_message( move( payload ) ) );
+        },
+        [&]( BroadcastPayload&& payload ) {
+          // Send the data itself first, unless the remote is known to have it. Its data filter alone is not enough:
+          // on a false positive the remote would have nothing to forward.
+          if ( parent_.has_value() ) {
+            auto& parent = parent_->get();
+            std::visit( overload {
+                          [&]( Handle<Named> n ) {
+                            if ( !connection.loaded( n ) ) {
+                              connection.send_blob( parent.get( n ).value() );
+                              connection.add_to_view( n );
+                            }
+                          },
+                          [&]( Handle<AnyTree> t ) {
+                            if ( !connection.loaded( t ) ) {
+                              connection.send_tree( t, parent.get( t ).value() );
+                            }
+                          },
+                          []( Handle<Literal> ) {},
+                          []( Handle<Relation> ) {},
+                        },
+                        payload.handle.get() );
+          }
+          connection.push_message( OutgoingMessage::to_message( move( payload ) ) );
+        },
+        [&]( RelayedPayload&& payload ) {
+          vector<Handle<Relation>> released;
+          {
+            unique_lock lock( connection.mutex_ );
+            // Unless this node relayed the data to the remote and waits on it, the report is for the remote
+            if ( not connection.relays_pending_.erase( payload.handle ) ) {
+              lock.unlock();
+              connection.push_message( OutgoingMessage::to_message( move( payload ) ) );
+              return;
+            }
+            if ( connection.relays_pending_.empty() ) {
+              released.swap( connection.held_runs_ );
+            }
+          }
+
+          // The relay did not reach the remote, so send it the data ourselves ahead of its RUNs
+          if ( not payload.held and parent_.has_value() ) {
+            auto& parent = parent_->get();
+            std::visit( overload {
+                          [&]( Handle<Named> n ) {
+                            connection.send_blob( parent.get( n ).value() );
+                            connection.add_to_view( n );
+                          },
+                          [&]( Handle<AnyTree> t ) { connection.send_tree( t, parent.get( t ).value() ); },
+                          []( Handle<Literal> ) {},
+                          []( Handle<Relation> ) {},
+                        },
+                        payload.handle.get() );
+          }
+
+          for ( const auto task : released ) {
+            connection.enqueue( RunPayload { .task = task } );
+          }
+        },
         [&]( LoadBlobPayload&& payload ) {
           auto named = payload.handle.unwrap<Named>();
           if ( connection.contains( named ) && !connection.loaded( named ) ) {
@@ -806,96 +1211,269 @@ void NetworkWorker::process_outgoing_message( size_t remote_idx, MessagePayload&
           }
         },
         [&]( auto&& payload ) { connection.push_message( OutgoingMessage::to_message( move( payload ) ) ); } },
-      payload );
+      move( payload ) );
   }
 }
 
-void NetworkWorker::run_loop()
+void NetworkWorker::add_connection( IOThread& io, NewConnection&& connection, bool incoming )
 {
-  categories_ = {
-    .server_new_socket = events_.add_category( "server - new socket" ),
-    .server_new_connection = events_.add_category( "server - new connection" ),
-    .client_new_connection = events_.add_category( "client - new connection" ),
-    .rx_read_data = events_.add_category( "rx - read" ),
-    .rx_parse_msg = events_.add_category( "rx - parse message" ),
-    .rx_process_msg = events_.add_category( "rx - process message" ),
-    .tx_serialize_msg = events_.add_category( "tx - serialize message" ),
-    .tx_write_data = events_.add_category( "tx - write" ),
-    .forward_msg = events_.add_category( "networkworker - forward msg to remote" ),
-  };
-  // When we have a new server socket, add it to the event loop
-  events_.add_rule(
-    categories_.server_new_socket,
-    [&] {
-      server_sockets_.push_back( *listening_sockets_.pop() );
-      TCPSocket& server_socket = server_sockets_.back();
-
-      VLOG( 1 ) << "Listening on " << server_socket.local_address();
-      // When someone connects to the socket, accept it and add the new connection to the event loop
-      events_.add_rule( categories_.server_new_connection, server_socket, Direction::In, [&] {
-        connections_.write()->emplace(
-          next_connection_id_,
-          make_unique<Remote>(
-            events_, categories_, server_socket.accept(), next_connection_id_, msg_q_, parent_ ) );
-
-        {
-          addresses_.write()->emplace( connections_.read()->at( next_connection_id_ )->peer_address().to_string(),
-                                       next_connection_id_ );
-        }
+  const size_t id = next_connection_id_++;
+  auto& address = connection.address;
+  if ( address.empty() ) {
+    // Peers on a local socket have no address of their own
+    address = connection.socket->domain() == AF_UNIX ? "local:" + to_string( id )
+                                                     : connection.socket->peer_address().to_string();
+  }
 
-        VLOG( 1 ) << "New connection from "
-                  << connections_.read()->at( next_connection_id_ )->peer_address().to_string();
+  auto remote
+    = make_shared<Remote>( io.events, io.categories, move( *connection.socket ), id, io.msg_q, *this, parent_ );
 
-        if ( parent_.has_value() ) {
-          parent_.value().get().add_worker( connections_.read()->at( next_connection_id_ ) );
-        }
+  connections_.write()->emplace( id, remote );
+  addresses_.write()->emplace( address, id );
 
-        next_connection_id_++;
-      } );
-    },
-    [&] { return listening_sockets_.size_approx() > 0; } );
+  VLOG( 1 ) << ( incoming ? "New connection from " : "New connection to " ) << address
+            << ( remote->local_ ? " (local)" : "" );
 
-  // When we've made a new outgoing connection, add it to the event loop
-  events_.add_rule(
-    categories_.client_new_connection,
-    [&] {
-      TCPSocket client_socket = *connecting_sockets_.pop();
-      connections_.write()->emplace(
-        next_connection_id_,
-        make_unique<Remote>(
-          events_, categories_, std::move( client_socket ), next_connection_id_, msg_q_, parent_ ) );
+  if ( parent_.has_value() ) {
+    parent_.value().get().add_worker( remote );
+  }
+}
 
-      addresses_.write()->emplace( connections_.read()->at( next_connection_id_ )->peer_address().to_string(),
-                                   next_connection_id_ );
+vector<pair<string, shared_ptr<Remote>>> NetworkWorker::peers()
+{
+  vector<pair<string, shared_ptr<Remote>>> peers;
+  const auto addresses = addresses_.read().get();
+  const auto connections = connections_.read();
+  for ( const auto& [address, id] : addresses ) {
+    if ( const auto remote = connections->find( id ); remote != connections->end() ) {
+      peers.emplace_back( address, remote->second );
+    }
+  }
+  return peers;
+}
 
-      VLOG( 1 ) << "New connection to "
-                << connections_.read()->at( next_connection_id_ )->peer_address().to_string();
+vector<vector<EventLoop::CategoryTotal>> NetworkWorker::event_loop_timers() const
+{
+  vector<vector<EventLoop::CategoryTotal>> timers;
+  for ( const auto& io : io_threads_ ) {
+    timers.push_back( io->events.cumulative_timers() );
+  }
+  return timers;
+}
 
-      if ( parent_.has_value() ) {
-        parent_.value().get().add_worker( connections_.read()->at( next_connection_id_ ) );
+Address NetworkWorker::local_socket_address( uint16_t port )
+{
+  // An abstract name, which needs no file and goes away with the listening socket
+  sockaddr_un address {};
+  address.sun_family = AF_UNIX;
+  const string name = "fixpoint-" + to_string( port );
+  name.copy( address.sun_path + 1, sizeof( address.sun_path ) - 1 );
+  return { reinterpret_cast<const sockaddr*>( &address ), offsetof( sockaddr_un, sun_path ) + 1 + name.size() };
+}
+
+bool NetworkWorker::is_local( const Address& address )
+{
+  const sockaddr* raw = address;
+  if ( raw->sa_family != AF_INET ) {
+    return false;
+  }
+  if ( ( address.ipv4_numeric() >> 24 ) == 127 ) {
+    return true;
+  }
+
+  const auto ip = reinterpret_cast<const sockaddr_in*>( raw )->sin_addr.s_addr;
+  ifaddrs* interfaces = nullptr;
+  CheckSystemCall( "getifaddrs", getifaddrs( &interfaces ) );
+  bool found = false;
+  for ( auto* i = interfaces; i and not found; i = i->ifa_next ) {
+    found = i->ifa_addr and i->ifa_addr->sa_family == AF_INET
+            and reinterpret_cast<const sockaddr_in*>( i->ifa_addr )->sin_addr.s_addr == ip;
+  }
+  freeifaddrs( interfaces );
+  return found;
+}
+
+void NetworkWorker::start_local_server( uint16_t port )
+{
+  try {
+    LocalStreamSocket socket;
+    socket.bind( local_socket_address( port ) );
+    socket.listen();
+    socket.set_blocking( false );
+    listening_local_sockets_.move_push( move( socket ) );
+  } catch ( const unix_error& e ) {
+    LOG( WARNING ) << "Peers on this host will connect over TCP: " << e.what();
+  }
+}
+
+optional<LocalStreamSocket> NetworkWorker::connect_local( const Address& address )
+{
+  if ( not is_local( address ) ) {
+    return {};
+  }
+
+  try {
+    LocalStreamSocket socket;
+    socket.connect( local_socket_address( address.port() ) );
+    VLOG( 1 ) << "Connecting to " << address.to_string() << " over a local socket";
+    return socket;
+  } catch ( const unix_error& ) {
+    // Not a Fix server, or one that only listens on TCP
+    return {};
+  }
+}
+
+uint64_t NetworkWorker::node_id()
+{
+  static const uint64_t id = [] {
+    random_device device;
+    uint64_t id = 0;
+    while ( id == 0 ) {
+      id = ( uint64_t( device() ) << 32 ) | device();
+    }
+    return id;
+  }();
+  return id;
+}
+
+void NetworkWorker::forward( Handle<AnyDataType> handle, uint64_t origin, span<const uint64_t> nodes )
+{
+  auto connections = connections_.read();
+  absl::flat_hash_map<uint64_t, shared_ptr<Remote>> by_node;
+  for ( const auto& [_, remote] : connections.get() ) {
+    if ( not remote->dead() ) {
+      by_node.emplace( remote->node_.load( memory_order_acquire ), remote );
+    }
+  }
+
+  vector<shared_ptr<Remote>> targets;
+  for ( const auto node : nodes ) {
+    if ( auto it = by_node.find( node ); it != by_node.end() ) {
+      targets.push_back( it->second );
+    } else {
+      LOG( WARNING ) << "Not connected to node " << node << ", it will not be sent " << handle;
+      if ( auto it = by_node.find( origin ); it != by_node.end() ) {
+        it->second->enqueue( RelayedPayload { .handle = handle, .node = node } );
       }
+    }
+  }
 
-      next_connection_id_++;
-    },
-    [&] { return connecting_sockets_.size_approx() > 0; } );
+  span<const shared_ptr<Remote>> rest = targets;
+  while ( not rest.empty() ) {
+    // The first target takes on the first half of the rest
+    const size_t half = ( rest.size() + 1 ) / 2;
+    BroadcastPayload payload { .handle = handle, .origin = origin };
+    for ( const auto& remote : rest.subspan( 1, half - 1 ) ) {
+      payload.forward.push_back( remote->node_.load( memory_order_acquire ) );
+    }
+    rest.front()->enqueue( move( payload ) );
+    rest = rest.subspan( half );
+  }
+}
+
+void NetworkWorker::send_to_node( uint64_t node, const MessagePayload& payload )
+{
+  auto connections = connections_.read();
+  bool sent = false;
+  for ( const auto& [_, remote] : connections.get() ) {
+    if ( not remote->dead() and remote->node_.load( memory_order_acquire ) == node ) {
+      remote->enqueue( MessagePayload( payload ) );
+      sent = true;
+    }
+  }
+
+  if ( not sent ) {
+    LOG( WARNING ) << "Not connected to node " << node;
+  }
+}
+
+void NetworkWorker::run_loop( IOThread& io )
+{
+  auto& events = io.events;
+  io.categories = {
+    .server_new_socket = events.add_category( "server - new socket" ),
+    .server_new_connection = events.add_category( "server - new connection" ),
+    .client_new_connection = events.add_category( "client - new connection" ),
+    .rx_read_data = events.add_category( "rx - read" ),
+    .rx_parse_msg = events.add_category( "rx - parse message" ),
+    .rx_process_msg = events.add_category( "rx - process message" ),
+    .tx_write_data = events.add_category( "tx - write" ),
+    .forward_msg = events.add_category( "networkworker - forward msg to remote" ),
+  };
 
-  // Forward msg_q_ to Remotes
-  events_.add_rule(
-    categories_.forward_msg,
+  if ( &io == io_threads_.front().get() ) {
+    // When someone connects to a server socket, accept it and hand it to an IO thread
+    auto serve = [&]( auto& server_socket ) {
+      events.add_rule( io.categories.server_new_connection, server_socket, Direction::In, [&] {
+        auto& target = next_io_thread();
+        target.accepted_sockets.move_push( { server_socket.accept(), "" } );
+        target.events.notify();
+      } );
+    };
+
+    // When we have a new server socket, add it to the event loop
+    events.add_rule(
+      io.categories.server_new_socket,
+      [&, serve] {
+        server_sockets_.push_back( *listening_sockets_.pop() );
+        VLOG( 1 ) << "Listening on " << server_sockets_.back().local_address();
+        serve( server_sockets_.back() );
+      },
+      [&] { return listening_sockets_.size_approx() > 0; },
+      Rearm::Explicit );
+
+    events.add_rule(
+      io.categories.server_new_socket,
+      [&, serve] {
+        local_server_sockets_.push_back( *listening_local_sockets_.pop() );
+        VLOG( 1 ) << "Listening on a local socket";
+        serve( local_server_sockets_.back() );
+      },
+      [&] { return listening_local_sockets_.size_approx() > 0; },
+      Rearm::Explicit );
+  }
+
+  // When we've been handed a new connection, add it to the event loop. New fd rules are evaluated anyway, and the
+  // Remotes' push_message re-arms their sockets, so these rules need not re-evaluate every fd rule.
+  events.add_rule(
+    io.categories.server_new_connection,
+    [&] { add_connection( io, *io.accepted_sockets.pop(), true ); },
+    [&] { return io.accepted_sockets.size_approx() > 0; },
+    Rearm::Explicit );
+
+  events.add_rule(
+    io.categories.client_new_connection,
+    [&] { add_connection( io, *io.connecting_sockets.pop(), false ); },
+    [&] { return io.connecting_sockets.size_approx() > 0; },
+    Rearm::Explicit );
+
+  // Forward msg_q to Remotes
+  events.add_rule(
+    io.categories.forward_msg,
     [&] {
       std::pair<uint32_t, MessagePayload> entry;
-      while ( msg_q_.try_dequeue( entry ) ) {
+      while ( io.msg_q.try_dequeue( entry ) ) {
         process_outgoing_message( entry.first, move( entry.second ) );
       }
     },
-    [&] { return msg_q_.size_approx() > 0; } );
+    [&] { return io.msg_q.size_approx() > 0; },
+    Rearm::Explicit );
 
-  // TODO: kick
+  // Producers on other threads notify the event loop, so it can block until there is work
   while ( not should_exit_ ) {
-    std::erase_if( connections_.write().get(), []( const auto& item ) {
+    std::erase_if( connections_.write().get(), [&]( const auto& item ) {
       auto const& [_, value] = item;
-      return value->dead();
+      return &value->events_ == &events and value->dead();
     } );
-    events_.wait_next_event( 1 );
+    // A connection waiting on its rate limit is not woken when its token bucket refills, so poll for it
+    if ( Remote::rate_limited() ) {
+      const auto connections = connections_.read();
+      for ( const auto& [_, remote] : connections.get() ) {
+        if ( &remote->events_ == &events and remote->tx_pending() ) {
+          events.interest_changed( remote->socket_ );
+        }
+      }
+    }
+    events.wait_next_event( Remote::rate_limited() ? 1 : -1 );
   }
 }
@@ -2,13 +2,18 @@
 
 #include <absl/container/flat_hash_map.h>
 #include <absl/container/flat_hash_set.h>
+#include <array>
+#include <atomic>
 #include <concurrentqueue/concurrentqueue.h>
 #include <condition_variable>
+#include <deque>
 #include <functional>
+#include <list>
 #include <glog/logging.h>
 #include <memory>
 #include <mutex>
 #include <shared_mutex>
+#include <span>
 #include <thread>
 #include <unordered_map>
 #include <utility>
@@ -17,11 +22,13 @@
 #include "eventloop.hh"
 #include "handle.hh"
 #include "interface.hh"
+#include "link_estimator.hh"
 #include "message.hh"
 #include "mutex.hh"
 #include "ring_buffer.hh"
 #include "runtimestorage.hh"
 #include "socket.hh"
+#include "striped_fetch.hh"
 
 using MessageQueue = moodycamel::ConcurrentQueue<std::pair<uint32_t, MessagePayload>>;
 
@@ -33,7 +40,6 @@ struct EventCategories
   size_t rx_read_data;
   size_t rx_parse_msg;
   size_t rx_process_msg;
-  size_t tx_serialize_msg;
   size_t tx_write_data;
   size_t forward_msg;
 };
@@ -43,30 +49,72 @@ class NetworkWorker;
 class Remote : public IRuntime
 {
   friend class NetworkWorker;
+
+public:
+  // Messages and bytes (header and payload) passed in one direction, by opcode. Counted by the IO thread and read
+  // from any thread.
+  struct Traffic
+  {
+    static constexpr size_t OPCODES = static_cast<size_t>( Message::Opcode::COUNT );
+    std::array<std::atomic<uint64_t>, OPCODES> messages {};
+    std::array<std::atomic<uint64_t>, OPCODES> bytes {};
+
+    void log( Message::Opcode opcode, size_t length )
+    {
+      messages[static_cast<size_t>( opcode )].fetch_add( 1, std::memory_order_relaxed );
+      bytes[static_cast<size_t>( opcode )].fetch_add( length, std::memory_order_relaxed );
+    }
+  };
+
+private:
   static constexpr size_t STORAGE_SIZE = 65536;
+  // Blobs at least this large are passed to a peer on the same host as a memfd rather than through the socket
+  static constexpr size_t FD_PAYLOAD_THRESHOLD = MessageParser::DIRECT_PAYLOAD_THRESHOLD;
 
-  TCPSocket socket_;
+  // A TCP socket, or a Unix-domain one to a peer on the same host
+  Socket socket_;
+  bool local_;
 
+  EventLoop& events_;
   MessageQueue& msg_q_;
+  NetworkWorker& worker_;
   std::optional<std::reference_wrapper<MultiWorkerRuntime>> parent_;
   size_t index_;
 
+  // Maximum number of queued messages gathered into one writev
+  static constexpr size_t MAX_GATHER = 64;
+
   RingBuffer rx_data_ { STORAGE_SIZE };
-  RingBuffer tx_data_ { STORAGE_SIZE };
 
   MessageParser rx_messages_ {};
-  std::queue<OutgoingMessage> tx_messages_ {};
-
-  std::string current_msg_header_ {};
-  std::string_view current_msg_unsent_header_ {};
-  std::string_view current_msg_unsent_payload_ {};
+  // Descriptors received over a local socket, in the order of the BLOBFD messages they belong to
+  std::deque<FileDescriptor> rx_fds_ {};
+  // Messages are sent straight from their payloads, which they keep alive until they have been written out.
+  std::deque<OutgoingMessage> tx_messages_ {};
+  // Bytes of the front message (header and payload) already written
+  size_t tx_sent_ {};
+  std::vector<std::string_view> tx_buffers_ {};
+  // RUN and RESULT messages held back to be sent together. Nothing has to follow them, so they are sent after
+  // anything else pushed since, once the network thread has drained its queue and gets to write.
+  static constexpr size_t MAX_BATCH = 4096;
+  RunBatchPayload tx_runs_ {};
+  ResultBatchPayload tx_results_ {};
+
+  Traffic tx_traffic_ {};
+  Traffic rx_traffic_ {};
 
   std::vector<EventLoop::RuleHandle> installed_rules_ {};
 
   std::shared_mutex mutex_ {};
   std::condition_variable_any info_cv_ {};
   std::optional<Info> info_ {};
+  // The node id the remote reported in INFO, or 0 until then
+  std::atomic<uint64_t> node_ { 0 };
   absl::flat_hash_set<Handle<Relation>> reply_to_ {};
+  // Data relayed to the remote through its peers that it has not yet reported holding, and the RUNs held back
+  // until it has, since they travel over this connection rather than the data's
+  absl::flat_hash_set<Handle<AnyDataType>> relays_pending_ {};
+  std::vector<Handle<Relation>> held_runs_ {};
 
   bool dead_ { false };
 
@@ -76,16 +124,32 @@ class Remote : public IRuntime
   std::queue<std::pair<std::pair<Handle<Relation>, std::optional<Handle<Object>>>, std::unique_ptr<DataProposal>>>
     proposed_proposals_ {};
 
+  // The rate the sending side is paced to when limit_rate() is in effect, and its token bucket
+  inline static std::atomic<uint64_t> rate_limit_ { 0 };
+  const uint64_t tx_rate_ { rate_limit_.load() };
+  double tx_tokens_ {};
+  LinkEstimator::clock::time_point tx_refilled_ { LinkEstimator::clock::now() };
+
+  LinkEstimator link_ {};
+  LinkEstimator::clock::time_point info_requested_ {};
+  // When each PROPOSE_TRANSFER still waiting for its ACCEPT_TRANSFER was queued
+  std::queue<LinkEstimator::clock::time_point> proposals_sent_ {};
+
   FixTable<Named, std::atomic<bool>, AbslHash> blobs_view_ { 100000 };
   FixTable<AnyTree, std::atomic<bool>, AbslHash, handle::any_tree_equal> trees_view_ { 1000000 };
   FixTable<Relation, std::atomic<bool>, AbslHash> relations_view_ { 100000 };
+  // What the remote reported holding when it joined. The views above are exact and are checked first; a positive
+  // from the filter alone counts as contained but not loaded, and a false positive only costs the remote a request
+  // for the data. Relations are only looked up in their view.
+  std::atomic<std::shared_ptr<const HandleFilter>> remote_data_ {};
 
 public:
   Remote( EventLoop& events,
           EventCategories categories,
-          TCPSocket socket,
+          Socket socket,
           size_t index,
           MessageQueue& msg_q,
+          NetworkWorker& worker,
           std::optional<std::reference_wrapper<MultiWorkerRuntime>> parent );
 
   std::optional<BlobData> get( Handle<Named> name ) override;
@@ -108,7 +172,11 @@ public:
   bool contains( const std::string_view label ) override;
   std::optional<Info> get_info() override;
 
+  bool relay( Handle<AnyDataType> handle, const std::vector<std::shared_ptr<IRuntime>>& peers ) override;
+
   void push_message( OutgoingMessage&& msg );
+  void push_message( RunPayload run );
+  void push_message( ResultPayload result );
 
   Address local_address() { return socket_.local_address(); }
   Address peer_address() { return socket_.peer_address(); }
@@ -117,6 +185,15 @@ public:
 
   bool dead() const { return dead_; }
 
+  // Paces every connection made afterwards to send at most this many bytes per second, as a token-bucket filter
+  // on each link would, so a cluster on loopback behaves like one on a slower network. Blobs to a peer on the same
+  // host then go through the socket too. 0 (the default) lifts the limit.
+  static void limit_rate( uint64_t bytes_per_second ) { rate_limit_ = bytes_per_second; }
+  static bool rate_limited() { return rate_limit_ > 0; }
+
+  const Traffic& sent() const { return tx_traffic_; }
+  const Traffic& received() const { return rx_traffic_; }
+
   bool erase_reply_to( Handle<Relation> handle )
   {
     std::unique_lock lock( mutex_ );
@@ -125,10 +202,20 @@ public:
   ~Remote();
 
 private:
-  void load_tx_message();
-  void write_to_rb();
+  void flush_batches();
+  bool tx_pending() const
+  {
+    return not tx_messages_.empty() or not tx_runs_.tasks.empty() or not tx_results_.results.empty();
+  }
+  void write_to_socket();
+  // Bytes the token bucket lets through now
+  size_t tx_budget();
+  // Read from the socket, collecting any descriptors that come with the data
+  size_t receive( std::span<char> buffer );
   void read_from_rb();
   void install_rule( EventLoop::RuleHandle rule ) { installed_rules_.push_back( rule ); }
+  // Hand a message to the network thread and wake it up
+  void enqueue( MessagePayload&& payload );
   void process_incoming_message( IncomingMessage&& msg );
 
   void send_blob( BlobData blob );
@@ -147,42 +234,101 @@ private:
 
 class NetworkWorker
 {
+  friend class Remote;
+
 private:
-  EventCategories categories_ {};
+  // An event loop and the thread running it. Each connection is served entirely by the IO thread it was handed
+  // to, so its Remote, its rules and its message queue are never touched by another IO thread.
+  // A connected socket on its way to an IO thread, with the address it is known by (empty if accepted)
+  struct NewConnection
+  {
+    std::optional<Socket> socket {};
+    std::string address {};
+  };
 
-  EventLoop events_ {};
-  std::thread network_thread_ {};
+  struct IOThread
+  {
+    EventLoop events {};
+    EventCategories categories {};
+    MessageQueue msg_q {};
+    Channel<NewConnection> accepted_sockets {};
+    Channel<NewConnection> connecting_sockets {};
+    std::thread thread {};
+  };
+
+  std::vector<std::unique_ptr<IOThread>> io_threads_ {};
+  std::atomic<size_t> next_io_thread_ { 0 };
   std::atomic<bool> should_exit_ = false;
 
+  // Listening sockets are served by the first IO thread, which deals accepted connections out round-robin
   Channel<TCPSocket> listening_sockets_ {};
-  Channel<TCPSocket> connecting_sockets_ {};
+  std::list<TCPSocket> server_sockets_ {};
+  // Peers on the same host connect to this instead of the TCP port, see local_socket_address()
+  Channel<LocalStreamSocket> listening_local_sockets_ {};
+  std::list<LocalStreamSocket> local_server_sockets_ {};
 
-  std::size_t next_connection_id_ { 0 };
-  SharedMutex<std::unordered_map<std::string, size_t>> addresses_ {};
-  std::vector<TCPSocket> server_sockets_ {};
+  std::atomic<std::size_t> next_connection_id_ { 0 };
+  // Shared by every connection, since the stripes of one fetch are served by several of them
+  StripedFetches fetches_ {};
 
-  MessageQueue msg_q_ {};
+  // Identifies this process to its peers, see InfoPayload::node
+  static uint64_t node_id();
+  SharedMutex<std::unordered_map<std::string, size_t>> addresses_ {};
 
   std::optional<std::reference_wrapper<MultiWorkerRuntime>> parent_;
 
-  void run_loop();
+  void run_loop( IOThread& io );
+  void add_connection( IOThread& io, NewConnection&& connection, bool incoming );
   void process_outgoing_message( size_t remote_id, MessagePayload&& message );
+  // Pass data this node holds on to the given nodes along a binomial tree: the first takes half of them on, and
+  // this node carries on with the rest, so N nodes are reached in O(log N) rounds. The origin is told of any node
+  // that cannot be reached.
+  void forward( Handle<AnyDataType> handle, uint64_t origin, std::span<const uint64_t> nodes );
+  // Queue the payload on every live connection to the given node
+  void send_to_node( uint64_t node, const MessagePayload& payload );
+
+  IOThread& next_io_thread() { return *io_threads_[next_io_thread_++ % io_threads_.size()]; }
+
+  // The abstract Unix-domain socket a server listening on a TCP port also listens on
+  static Address local_socket_address( uint16_t port );
+  // Whether address is one of this host's own
+  static bool is_local( const Address& address );
+  void start_local_server( uint16_t port );
+  // Connect to a server on this host over its Unix-domain socket, if it has one
+  std::optional<LocalStreamSocket> connect_local( const Address& address );
 
 public:
   SharedMutex<std::unordered_map<size_t, std::shared_ptr<Remote>>> connections_ {};
 
-  NetworkWorker( std::optional<std::reference_wrapper<MultiWorkerRuntime>> parent = {} )
+  NetworkWorker( std::optional<std::reference_wrapper<MultiWorkerRuntime>> parent = {}, size_t io_threads = 1 )
     : parent_( parent )
-  {}
+  {
+    for ( size_t i = 0; i < std::max<size_t>( io_threads, 1 ); i++ ) {
+      io_threads_.push_back( std::make_unique<IOThread>() );
+    }
+  }
 
-  void start() { network_thread_ = std::thread( std::bind( &NetworkWorker::run_loop, this ) ); }
+  void start()
+  {
+    for ( auto& io : io_threads_ ) {
+      io->thread = std::thread( [this, &io = *io] { run_loop( io ); } );
+    }
+  }
 
-  void join() { network_thread_.join(); }
+  void join()
+  {
+    for ( auto& io : io_threads_ ) {
+      io->thread.join();
+    }
+  }
 
   void stop()
   {
     should_exit_ = true;
-    network_thread_.join();
+    for ( auto& io : io_threads_ ) {
+      io->events.notify();
+    }
+    join();
   }
 
   ~NetworkWorker() {}
@@ -196,17 +342,30 @@ public:
     socket.set_blocking( false );
     Address listen_address = socket.local_address();
     listening_sockets_.move_push( std::move( socket ) );
+    start_local_server( listen_address.port() );
+    io_threads_.front()->events.notify();
     return listen_address;
   }
 
   void connect( const Address& address )
   {
-    TCPSocket socket;
-    VLOG( 1 ) << "Connecting to " << address.to_string();
-    socket.connect( address );
-    connecting_sockets_.move_push( std::move( socket ) );
+    auto& io = next_io_thread();
+    if ( auto local = connect_local( address ) ) {
+      io.connecting_sockets.move_push( { std::move( *local ), address.to_string() } );
+    } else {
+      TCPSocket socket;
+      VLOG( 1 ) << "Connecting to " << address.to_string();
+      socket.connect( address );
+      io.connecting_sockets.move_push( { std::move( socket ), address.to_string() } );
+    }
+    io.events.notify();
   }
 
+  // Each connection, with the address it is known by
+  std::vector<std::pair<std::string, std::shared_ptr<Remote>>> peers();
+  // The cumulative rule timers of each IO thread's event loop
+  std::vector<std::vector<EventLoop::CategoryTotal>> event_loop_timers() const;
+
   std::shared_ptr<IRuntime> get_remote( const Address& address )
   {
     auto address_str = address.to_string();
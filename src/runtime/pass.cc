@@ -17,6 +17,19 @@ bool is_local( shared_ptr<IRuntime> rt )
   return rt->get_info()->link_speed == numeric_limits<double>::max();
 }
 
+// Estimated seconds to move `bytes` over the link to rt
+double transfer_time( shared_ptr<IRuntime> rt, size_t bytes )
+{
+  const auto link_speed = rt->get_info()->link_speed;
+  if ( bytes == 0 or link_speed == numeric_limits<double>::max() ) {
+    return 0;
+  }
+  if ( link_speed <= 0 ) {
+    return numeric_limits<double>::infinity();
+  }
+  return bytes / link_speed;
+}
+
 Pass::Pass( reference_wrapper<Relater> relater )
   : relater_( relater )
   , local_( relater.get().get_local() )
@@ -384,7 +397,9 @@ void MinAbsentMaxParallelism::relation_post( Handle<Relation> job,
 
   if ( !chosen_remote.has_value() ) {
     absl::flat_hash_map<shared_ptr<IRuntime>, size_t> present;
+    size_t total_size = 0;
     for ( auto d : dependencies ) {
+      total_size += base_.get().get_output_size( d );
       if ( !chosen_remotes_.contains( d ) ) {
         const auto& contains = base_.get().get_contains( d );
         for ( const auto& s : contains ) {
@@ -396,35 +411,55 @@ void MinAbsentMaxParallelism::relation_post( Handle<Relation> job,
     }
 
     const auto& present_input = base_.get().get_present_size( job );
+    if ( !present_input.empty() ) {
+      total_size += handle::byte_size( job::get_root( job ) );
+    }
     for ( const auto& [r, s] : present_input ) {
       present[r] += s;
     }
 
-    optional<size_t> max_present_size;
+    // The time to bring each candidate the input it lacks from the runtimes holding it. A remote receives all of it
+    // over its own link; the local runtime fetches from each holder over that holder's link, in parallel.
+    const auto transfer_cost = [&]( const shared_ptr<IRuntime>& r ) {
+      const auto absent = total_size - min( total_size, present.at( r ) );
+      double cost = 0;
+      for ( const auto& [other, s] : present ) {
+        if ( other == r ) {
+          continue;
+        }
+        if ( is_local( r ) ) {
+          cost = max( cost, transfer_time( other, min( s, absent ) ) );
+        } else {
+          cost += transfer_time( r, min( s, absent ) );
+        }
+      }
+      return cost;
+    };
+
+    optional<size_t> chosen_present_size;
     optional<size_t> local_present_size;
+    optional<double> min_cost;
     size_t max_parallelism = 0;
     for ( const auto& [r, s] : present ) {
       if ( is_local( r ) ) {
         local_present_size = s;
       }
 
-      if ( !max_present_size.has_value() ) {
-        max_present_size = s;
+      const auto cost = transfer_cost( r );
+      if ( !min_cost.has_value() or cost < min_cost.value() ) {
+        min_cost = cost;
+        chosen_present_size = s;
         chosen_remote = r;
         max_parallelism = r->get_info()->parallelism;
-      } else {
-        if ( s > max_present_size.value() ) {
-          max_present_size = s;
+      } else if ( cost == min_cost.value() ) {
+        auto parallelism = r->get_info()->parallelism;
+        if ( parallelism > max_parallelism ) {
+          chosen_present_size = s;
+          max_parallelism = parallelism;
+          chosen_remote = r;
+        } else if ( parallelism == max_parallelism && is_local( r ) ) {
+          chosen_present_size = s;
           chosen_remote = r;
-          max_parallelism = r->get_info()->parallelism;
-        } else if ( s == max_present_size.value() ) {
-          auto parallelism = r->get_info()->parallelism;
-          if ( parallelism > max_parallelism ) {
-            max_parallelism = parallelism;
-            chosen_remote = r;
-          } else if ( parallelism == max_parallelism && is_local( r ) ) {
-            chosen_remote = r;
-          }
         }
       }
     }
@@ -434,8 +469,11 @@ void MinAbsentMaxParallelism::relation_post( Handle<Relation> job,
     if ( is_local( chosen_remote.value() ) ) {
       chosen_remotes_.insert_or_assign( job, { chosen_remote.value(), local_present_size.value() } );
     } else {
-      chosen_remotes_.insert_or_assign(
-        job, { chosen_remote.value(), max_present_size.value() - local_present_size.value_or( 0 ) } );
+      // A faster link can make a remote holding less than this node the better choice
+      const auto local_size = local_present_size.value_or( 0 );
+      const auto chosen_size = chosen_present_size.value();
+      const auto score = chosen_size > local_size ? chosen_size - local_size : 0;
+      chosen_remotes_.insert_or_assign( job, { chosen_remote.value(), score } );
     }
   } else {
     VLOG( 2 ) << "MinAbsent::post " << job << " " << chosen_remote.value();
@@ -704,6 +742,37 @@ void SendToRemotePass::send_remote_jobs( Handle<Dependee> root )
     }
   }
 
+  // Rather than sending a copy of common data to each remote from here, relay it through them
+  absl::flat_hash_map<Handle<Dependee>, vector<shared_ptr<IRuntime>>> needed_by;
+  for ( const auto& [rt, data] : remote_data_ ) {
+    for ( auto d : data ) {
+      if ( handle::byte_size( d ) >= RELAY_MIN_SIZE ) {
+        d.visit<void>( overload {
+          []( Handle<Relation> ) {},
+          []( Handle<ObjectTreeRef> ) {},
+          []( Handle<ValueTreeRef> ) {},
+          [&]( auto ) { needed_by[d].push_back( rt ); },
+        } );
+      }
+    }
+  }
+
+  for ( const auto& [dependee, targets] : needed_by ) {
+    if ( targets.size() >= RELAY_MIN_REMOTES and targets.size() * 2 > remote_data_.size() ) {
+      auto d = dependee;
+      VLOG( 1 ) << "Relaying " << d << " to " << targets.size() << " remotes";
+      d.visit<void>( overload {
+        []( Handle<Relation> ) {},
+        []( Handle<ObjectTreeRef> ) {},
+        []( Handle<ValueTreeRef> ) {},
+        [&]( auto x ) { relater_.get().replicate( x, targets ); },
+      } );
+      for ( const auto& rt : targets ) {
+        remote_data_.at( rt ).erase( d );
+      }
+    }
+  }
+
   for ( const auto& [rt, data] : remote_data_ ) {
     for ( auto d : data ) {
       d.visit<void>( overload {
@@ -190,6 +190,10 @@ public:
 
 class SendToRemotePass : public PrunedSelectionPass
 {
+  // Data at least this large that at least this many remotes, and most of them, need is relayed through them
+  static constexpr size_t RELAY_MIN_SIZE = 1 << 20;
+  static constexpr size_t RELAY_MIN_REMOTES = 3;
+
   std::unordered_map<std::shared_ptr<IRuntime>, absl::flat_hash_set<Handle<Dependee>>> remote_jobs_ {};
   std::unordered_map<std::shared_ptr<IRuntime>, absl::flat_hash_set<Handle<Dependee>>> remote_data_ {};
   void send_job_dependencies( std::shared_ptr<IRuntime>, Handle<Dependee> );
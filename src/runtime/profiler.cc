@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <format>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <glog/logging.h>
+
+#include "handle_post.hh"
+#include "profiler.hh"
+#include "resource_limits.hh"
+#include "timer.hh"
+#include "wasm-rt.h"
+
+using namespace std;
+
+namespace {
+class HardwareCounters
+{
+  int instructions_;
+  int llc_misses_;
+
+  static int open_counter( uint64_t config )
+  {
+    perf_event_attr attr {};
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof( attr );
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 );
+  }
+
+  static uint64_t read_counter( int fd )
+  {
+    uint64_t value = 0;
+    if ( fd < 0 or ::read( fd, &value, sizeof( value ) ) != sizeof( value ) ) {
+      return 0;
+    }
+    return value;
+  }
+
+public:
+  HardwareCounters()
+    : instructions_( open_counter( PERF_COUNT_HW_INSTRUCTIONS ) )
+    , llc_misses_( open_counter( PERF_COUNT_HW_CACHE_MISSES ) )
+  {
+    if ( instructions_ < 0 or llc_misses_ < 0 ) {
+      PLOG_FIRST_N( WARNING, 1 ) << "perf_event_open failed, hardware counters will not be profiled";
+    }
+  }
+
+  uint64_t instructions() const { return read_counter( instructions_ ); }
+  uint64_t llc_misses() const { return read_counter( llc_misses_ ); }
+
+  ~HardwareCounters()
+  {
+    if ( instructions_ >= 0 ) {
+      close( instructions_ );
+    }
+    if ( llc_misses_ >= 0 ) {
+      close( llc_misses_ );
+    }
+  }
+
+  HardwareCounters( const HardwareCounters& ) = delete;
+  HardwareCounters& operator=( const HardwareCounters& ) = delete;
+};
+
+HardwareCounters& thread_counters()
+{
+  static thread_local HardwareCounters counters;
+  return counters;
+}
+}
+
+void ProcedureProfiler::Record::merge( const Record& other )
+{
+  count += other.count;
+  total_ticks += other.total_ticks;
+  max_ticks = std::max( max_ticks, other.max_ticks );
+  peak_pages = std::max( peak_pages, other.peak_pages );
+  instructions += other.instructions;
+  llc_misses += other.llc_misses;
+}
+
+void ProcedureProfiler::enable( bool hardware_counters )
+{
+  hardware_counters_ = hardware_counters;
+  enabled_ = true;
+}
+
+ProcedureProfiler::ThreadRecords& ProcedureProfiler::local()
+{
+  static thread_local shared_ptr<ThreadRecords> records;
+  if ( !records ) {
+    records = make_shared<ThreadRecords>();
+    unique_lock lock( threads_mutex_ );
+    threads_.push_back( records );
+  }
+  return *records;
+}
+
+void ProcedureProfiler::log( Handle<Fix> procedure, const Sample& sample )
+{
+  auto& thread = local();
+  unique_lock lock( thread.mutex );
+  auto& record = thread.records[procedure];
+  record.count++;
+  record.total_ticks += sample.ticks;
+  record.max_ticks = std::max( record.max_ticks, sample.ticks );
+  record.peak_pages = std::max( record.peak_pages, sample.pages );
+  record.instructions += sample.instructions;
+  record.llc_misses += sample.llc_misses;
+}
+
+vector<pair<Handle<Fix>, ProcedureProfiler::Record>> ProcedureProfiler::records() const
+{
+  absl::flat_hash_map<Handle<Fix>, Record> merged;
+  {
+    unique_lock lock( threads_mutex_ );
+    for ( const auto& thread : threads_ ) {
+      unique_lock thread_lock( thread->mutex );
+      for ( const auto& [procedure, record] : thread->records ) {
+        merged[procedure].merge( record );
+      }
+    }
+  }
+
+  vector<pair<Handle<Fix>, Record>> result( merged.begin(), merged.end() );
+  std::sort( result.begin(), result.end(), []( const auto& lhs, const auto& rhs ) {
+    return lhs.second.total_ticks > rhs.second.total_ticks;
+  } );
+  return result;
+}
+
+void ProcedureProfiler::summary( ostream& out ) const
+{
+  out << "Procedure profile\n-----------------\n\n";
+  out << std::format(
+    "{:>10} {:>16} {:>14} {:>14} {:>10}", "count", "total ticks", "mean ticks", "max ticks", "peak pages" );
+  if ( hardware_counters() ) {
+    out << std::format( " {:>16} {:>12}", "instructions", "LLC misses" );
+  }
+  out << "   procedure\n";
+
+  for ( const auto& [procedure, record] : records() ) {
+    out << std::format( "{:>10} {:>16} {:>14} {:>14} {:>10}",
+                        record.count,
+                        record.total_ticks,
+                        record.total_ticks / record.count,
+                        record.max_ticks,
+                        record.peak_pages );
+    if ( hardware_counters() ) {
+      out << std::format( " {:>16} {:>12}", record.instructions, record.llc_misses );
+    }
+    out << "   " << procedure << "\n";
+  }
+}
+
+void ProcedureProfiler::reset_summary()
+{
+  unique_lock lock( threads_mutex_ );
+  for ( const auto& thread : threads_ ) {
+    unique_lock thread_lock( thread->mutex );
+    thread->records.clear();
+  }
+}
+
+ProcedureScopeProfiler::ProcedureScopeProfiler( Handle<Fix> procedure )
+  : procedure_( procedure )
+  , active_( global_profiler().enabled() )
+{
+  if ( not active_ ) {
+    return;
+  }
+
+  if ( global_profiler().hardware_counters() ) {
+    start_instructions_ = thread_counters().instructions();
+    start_llc_misses_ = thread_counters().llc_misses();
+  }
+  start_bytes_ = resource_limits::available_bytes;
+  start_ticks_ = Timer::read_tsc();
+}
+
+ProcedureScopeProfiler::~ProcedureScopeProfiler()
+{
+  if ( not active_ ) {
+    return;
+  }
+
+  const uint64_t ticks = Timer::read_tsc() - start_ticks_;
+  // Linear memory and tables are charged against the resource limits as they grow and never refunded, so the
+  // difference is the peak footprint of this invocation.
+  const uint64_t bytes = start_bytes_ - std::min( start_bytes_, resource_limits::available_bytes );
+
+  ProcedureProfiler::Sample sample { ticks, ( bytes + WASM_RT_PAGE_SIZE - 1 ) / WASM_RT_PAGE_SIZE, 0, 0 };
+  if ( global_profiler().hardware_counters() ) {
+    sample.instructions = thread_counters().instructions() - start_instructions_;
+    sample.llc_misses = thread_counters().llc_misses() - start_llc_misses_;
+  }
+
+  global_profiler().log( procedure_, sample );
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <absl/container/flat_hash_map.h>
+
+#include "handle.hh"
+#include "summarize.hh"
+
+/**
+ * Opt-in per-procedure execution profile. Each thread keeps its own table of records keyed by
+ * fixpoint::current_procedure; the tables are merged when a summary is requested.
+ */
+class ProcedureProfiler : public Summarizable
+{
+public:
+  struct Record
+  {
+    uint64_t count = 0;
+    uint64_t total_ticks = 0;
+    uint64_t max_ticks = 0;
+    uint64_t peak_pages = 0;
+    uint64_t instructions = 0;
+    uint64_t llc_misses = 0;
+
+    void merge( const Record& other );
+  };
+
+  struct Sample
+  {
+    uint64_t ticks;
+    uint64_t pages;
+    uint64_t instructions;
+    uint64_t llc_misses;
+  };
+
+private:
+  struct ThreadRecords
+  {
+    std::mutex mutex {};
+    absl::flat_hash_map<Handle<Fix>, Record> records {};
+  };
+
+  std::atomic<bool> enabled_ { false };
+  std::atomic<bool> hardware_counters_ { false };
+
+  mutable std::mutex threads_mutex_ {};
+  std::vector<std::shared_ptr<ThreadRecords>> threads_ {};
+
+  ThreadRecords& local();
+
+public:
+  // Start recording. With hardware_counters, also read instructions and LLC misses through perf_event_open on
+  // each executing thread; if the kernel refuses, those columns stay zero.
+  void enable( bool hardware_counters = false );
+
+  bool enabled() const { return enabled_.load( std::memory_order_relaxed ); }
+  bool hardware_counters() const { return hardware_counters_.load( std::memory_order_relaxed ); }
+
+  void log( Handle<Fix> procedure, const Sample& sample );
+
+  // Merge the records of every thread, sorted by total ticks.
+  std::vector<std::pair<Handle<Fix>, Record>> records() const;
+
+  void summary( std::ostream& out ) const override;
+  void reset_summary() override;
+};
+
+inline ProcedureProfiler& global_profiler()
+{
+  static ProcedureProfiler the_global_profiler;
+  return the_global_profiler;
+}
+
+/**
+ * Records one invocation of a procedure in the global profiler, if it is enabled.
+ */
+class ProcedureScopeProfiler
+{
+  Handle<Fix> procedure_;
+  bool active_;
+  uint64_t start_ticks_ {};
+  uint64_t start_bytes_ {};
+  uint64_t start_instructions_ {};
+  uint64_t start_llc_misses_ {};
+
+public:
+  ProcedureScopeProfiler( Handle<Fix> procedure );
+  ~ProcedureScopeProfiler();
+
+  ProcedureScopeProfiler( const ProcedureScopeProfiler& ) = delete;
+  ProcedureScopeProfiler& operator=( const ProcedureScopeProfiler& ) = delete;
+};
@@ -59,11 +59,54 @@ Relater::Relater( size_t threads, optional<shared_ptr<Runner>> runner, optional<
   local_ = make_shared<Executor>( *this, threads, runner );
 }
 
+size_t Relater::queue_depth() const
+{
+  return static_pointer_cast<Executor>( local_ )->queue_depth();
+}
+
+uint64_t Relater::applications() const
+{
+  return static_pointer_cast<Executor>( local_ )->applications();
+}
+
 void Relater::add_worker( shared_ptr<IRuntime> rmt )
 {
   remotes_.write()->push_back( rmt );
 }
 
+void Relater::replicate( Handle<AnyDataType> handle, const vector<shared_ptr<IRuntime>>& targets )
+{
+  if ( targets.empty() ) {
+    return;
+  }
+
+  const vector<shared_ptr<IRuntime>> peers( targets.begin() + 1, targets.end() );
+  if ( not peers.empty() and targets.front()->relay( handle, peers ) ) {
+    return;
+  }
+
+  for ( const auto& target : targets ) {
+    std::visit( overload {
+                  [&]( Handle<Named> n ) { target->put( n, get( n ).value() ); },
+                  [&]( Handle<AnyTree> t ) { target->put( t, get( t ).value() ); },
+                  []( Handle<Literal> ) {},
+                  []( Handle<Relation> ) {},
+                },
+                handle.get() );
+  }
+}
+
+void Relater::replicate( Handle<AnyDataType> handle )
+{
+  vector<shared_ptr<IRuntime>> targets;
+  for ( const auto& remote : remotes_.read().get() ) {
+    if ( auto locked = remote.lock() ) {
+      targets.push_back( locked );
+    }
+  }
+  replicate( handle, targets );
+}
+
 Handle<Value> Relater::execute( Handle<Relation> r )
 {
   if ( contains( r ) ) {
@@ -87,6 +130,13 @@ Handle<Value> Relater::execute( Handle<Relation> r )
   }
 }
 
+void Relater::notify_result( Handle<Relation> name, Handle<Object> data )
+{
+  if ( const auto callback = on_result_.load( std::memory_order_acquire ) ) {
+    ( *callback )( name, data );
+  }
+}
+
 bool Relater::finish_top_level( Handle<Relation> name, Handle<Object> value )
 {
   if ( !top_level_done_.load( std::memory_order_acquire ) and name == top_level ) {
@@ -150,6 +200,28 @@ optional<Handle<Object>> Relater::get( Handle<Relation> name )
   return {};
 }
 
+vector<optional<Handle<Object>>> Relater::get_relations( span<const Handle<Relation>> names )
+{
+  vector<optional<Handle<Object>>> results;
+  results.reserve( names.size() );
+  vector<Handle<Relation>> unknown;
+  for ( const auto name : names ) {
+    if ( storage_.contains( name ) ) {
+      results.push_back( storage_.get( name ) );
+    } else if ( repository_.contains( name ) ) {
+      get_from_repository( name );
+      results.push_back( storage_.get( name ) );
+    } else {
+      results.push_back( {} );
+      unknown.push_back( name );
+    }
+  }
+
+  // One pass over the graph for the whole batch
+  static_pointer_cast<Executor>( local_ )->start( unknown );
+  return results;
+}
+
 optional<Handle<AnyTree>> Relater::get_handle( Handle<AnyTree> name )
 {
   if ( storage_.contains( name ) || storage_.contains_shallow( name ) ) {
@@ -221,6 +293,7 @@ void Relater::put( Handle<Relation> name, Handle<Object> data )
 {
   if ( !storage_.contains( name ) ) {
     storage_.create( data, name );
+    notify_result( name, data );
 
     if ( finish_top_level( name, data ) ) {
       return;
@@ -243,6 +316,40 @@ void Relater::put( Handle<Relation> name, Handle<Object> data )
   }
 }
 
+void Relater::put_results( span<const pair<Handle<Relation>, Handle<Object>>> results )
+{
+  vector<pair<Handle<Relation>, Handle<Object>>> finished;
+  for ( const auto& [name, data] : results ) {
+    if ( !storage_.contains( name ) ) {
+      storage_.create( data, name );
+      notify_result( name, data );
+      if ( !finish_top_level( name, data ) ) {
+        finished.emplace_back( name, data );
+      }
+    }
+  }
+
+  // One pass over the graph for the whole batch
+  absl::flat_hash_set<Handle<Relation>> unblocked;
+  {
+    auto graph = graph_.write();
+    for ( const auto& [name, _] : finished ) {
+      graph->finish( name, unblocked );
+    }
+  }
+  for ( auto x : unblocked ) {
+    local_->get( x );
+  }
+  for ( auto& remote : remotes_.read().get() ) {
+    auto locked = remote.lock();
+    if ( locked ) {
+      for ( const auto& [name, data] : finished ) {
+        locked->put( name, data );
+      }
+    }
+  }
+}
+
 bool Relater::contains( Handle<Named> handle )
 {
   return storage_.contains( handle ) || repository_.contains( handle );
@@ -1,5 +1,9 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
+#include <memory>
+
 #include "dependency_graph.hh"
 #include "handle.hh"
 #include "repository.hh"
@@ -28,12 +32,18 @@ private:
   bool finish_top_level( Handle<Relation>, Handle<Object> );
 
   SharedMutex<DependencyGraph> graph_ {};
+  std::shared_ptr<const DependencyGraph::Stats> graph_stats_ { graph_.read()->stats() };
   RuntimeStorage storage_ {};
   Repository repository_ {};
   std::shared_ptr<Scheduler> scheduler_ {};
 
   SharedMutex<std::vector<std::weak_ptr<IRuntime>>> remotes_ {};
   std::shared_ptr<IRuntime> local_ {};
+  using ResultCallback = std::function<void( Handle<Relation>, Handle<Object> )>;
+  // Swapped atomically, since the threads calling it may be running while it is replaced
+  std::atomic<std::shared_ptr<const ResultCallback>> on_result_ {};
+
+  void notify_result( Handle<Relation> name, Handle<Object> data );
 
   template<FixType T>
   void get_from_repository( Handle<T> handle );
@@ -45,6 +55,18 @@ public:
 
   virtual void add_worker( std::shared_ptr<IRuntime> ) override;
   Handle<Value> execute( Handle<Relation> x );
+  // Called with each Relation as its result becomes known, on whichever thread learns it. A thread may still be
+  // in the previous callback after it is replaced, so whatever the callback uses must outlive its replacement.
+  void on_result( ResultCallback callback )
+  {
+    on_result_.store( callback ? std::make_shared<const ResultCallback>( std::move( callback ) ) : nullptr,
+                      std::memory_order_release );
+  }
+
+  // Send data to each of targets, relaying it through them if they support it
+  void replicate( Handle<AnyDataType> handle, const std::vector<std::shared_ptr<IRuntime>>& targets );
+  // Send data to every remote
+  void replicate( Handle<AnyDataType> handle );
 
   virtual std::optional<BlobData> get( Handle<Named> name ) override;
   virtual std::optional<TreeData> get( Handle<AnyTree> name ) override;
@@ -55,6 +77,9 @@ public:
   virtual void put( Handle<AnyTree> name, TreeData data ) override;
   virtual void put_shallow( Handle<AnyTree> name, TreeData data ) override;
   virtual void put( Handle<Relation> name, Handle<Object> data ) override;
+  virtual void put_results( std::span<const std::pair<Handle<Relation>, Handle<Object>>> results ) override;
+  virtual std::vector<std::optional<Handle<Object>>> get_relations(
+    std::span<const Handle<Relation>> names ) override;
   virtual bool contains( Handle<Named> handle ) override;
   virtual bool contains( Handle<AnyTree> handle ) override;
   virtual bool contains_shallow( Handle<AnyTree> handle ) override;
@@ -70,7 +95,8 @@ public:
   {
     // Info to be exposed to other nodes
     auto info = local_->get_info();
-    info->link_speed = 7.5;
+    // Advertised until the peer measures the link itself: 7.5 GB/s
+    info->link_speed = 7.5e9;
     return info;
   }
 
@@ -160,8 +186,15 @@ public:
   }
 
   RuntimeStorage& get_storage() { return storage_; }
+  // Readable without taking the graph lock
+  const DependencyGraph::Stats& graph_stats() const { return *graph_stats_; }
+  // Relations waiting for an executor thread
+  size_t queue_depth() const;
+  // Procedures applied on this node, rather than sent to a peer
+  uint64_t applications() const;
   Repository& get_repository() { return repository_; }
   virtual std::unordered_set<Handle<AnyDataType>> data() const override { return repository_.data(); }
+  virtual HandleFilter data_filter() const override { return repository_.data_filter(); }
   virtual absl::flat_hash_set<Handle<Dependee>> get_forward_dependencies( Handle<Relation> blocked ) override
   {
     return graph_.read()->get_forward_dependencies( blocked );
@@ -6,6 +6,7 @@
 #include "mutex.hh"
 #include "object.hh"
 #include "overload.hh"
+#include "profiler.hh"
 #include "program.hh"
 #include "resource_limits.hh"
 #include "runtimestorage.hh"
@@ -148,6 +149,7 @@ public:
           .value_or( 0 );
 
     VLOG( 1 ) << handle << " requested " << resource_limits::available_bytes << " bytes";
+    ProcedureScopeProfiler profile( fixpoint::current_procedure );
     auto result = program.value()->execute( handle );
     VLOG( 2 ) << handle << " -> " << result;
     return result;
@@ -1,6 +1,7 @@
 #include "runtimes.hh"
 #include "handle.hh"
 #include "overload.hh"
+#include "prometheus.hh"
 #include "types.hh"
 #include <thread>
 #include <unordered_set>
@@ -64,12 +65,116 @@ void Server::join()
   network_worker_->join();
 }
 
+void Server::write_metrics( ostream& out )
+{
+  using Type = PrometheusWriter::Type;
+  PrometheusWriter metrics( out );
+
+  metrics.write( "fixpoint_executor_queue_depth",
+                 Type::Gauge,
+                 "Relations waiting for an executor thread.",
+                 relater_.queue_depth() );
+
+  metrics.write( "fixpoint_applications_total",
+                 Type::Counter,
+                 "Procedures applied on this node.",
+                 relater_.applications() );
+
+  const auto& graph = relater_.graph_stats();
+  metrics.write( "fixpoint_tasks_started_total",
+                 Type::Counter,
+                 "Relations started by the dependency graph.",
+                 graph.started.load( memory_order_relaxed ) );
+  metrics.write( "fixpoint_tasks_finished_total",
+                 Type::Counter,
+                 "Relations finished in the dependency graph.",
+                 graph.finished.load( memory_order_relaxed ) );
+  metrics.write( "fixpoint_dependency_graph_running",
+                 Type::Gauge,
+                 "Relations running in the dependency graph.",
+                 graph.running.load( memory_order_relaxed ) );
+  metrics.write( "fixpoint_dependency_graph_blocked",
+                 Type::Gauge,
+                 "Relations blocked in the dependency graph.",
+                 graph.blocked.load( memory_order_relaxed ) );
+  metrics.write( "fixpoint_dependency_graph_awaited",
+                 Type::Gauge,
+                 "Relations and data that blocked relations wait on.",
+                 graph.awaited.load( memory_order_relaxed ) );
+
+  auto& storage = relater_.get_storage();
+  const auto occupancy = storage.occupancy();
+  for ( const auto& table : occupancy ) {
+    metrics.write( "fixpoint_storage_entries",
+                   Type::Gauge,
+                   "Entries in each runtime storage table.",
+                   table.size,
+                   { { "table", table.table } } );
+  }
+  for ( const auto& table : occupancy ) {
+    metrics.write( "fixpoint_storage_capacity",
+                   Type::Gauge,
+                   "Slots in each runtime storage table.",
+                   table.capacity,
+                   { { "table", table.table } } );
+  }
+  metrics.write( "fixpoint_storage_resident_bytes",
+                 Type::Gauge,
+                 "Bytes of Blob and Tree data held in runtime storage.",
+                 storage.resident_bytes() );
+
+  // Opcodes never exchanged with a peer are left out
+  const auto peers = network_worker_->peers();
+  const auto write_traffic = [&]( const char* metric, const char* help, auto Remote::Traffic::*counts ) {
+    for ( const auto& [address, remote] : peers ) {
+      for ( const auto& [direction, traffic] :
+            { pair { "sent", &remote->sent() }, pair { "received", &remote->received() } } ) {
+        for ( size_t i = 0; i < Remote::Traffic::OPCODES; i++ ) {
+          const uint64_t value = ( traffic->*counts )[i].load( memory_order_relaxed );
+          if ( value ) {
+            const string_view opcode = Message::OPCODE_NAMES[i];
+            metrics.write( metric,
+                           Type::Counter,
+                           help,
+                           value,
+                           { { "peer", address }, { "direction", direction }, { "opcode", opcode } } );
+          }
+        }
+      }
+    }
+  };
+  write_traffic( "fixpoint_peer_messages_total", "Messages exchanged with each peer.", &Remote::Traffic::messages );
+  write_traffic(
+    "fixpoint_peer_bytes_total", "Bytes (header and payload) exchanged with each peer.", &Remote::Traffic::bytes );
+
+  const auto timers = network_worker_->event_loop_timers();
+  const auto write_timers = [&]( const char* metric, const char* help, uint64_t Timer::Record::*field ) {
+    for ( size_t thread = 0; thread < timers.size(); thread++ ) {
+      const string thread_label = to_string( thread );
+      for ( const auto& category : timers[thread] ) {
+        metrics.write( metric,
+                       Type::Counter,
+                       help,
+                       category.timer.*field,
+                       { { "thread", thread_label }, { "category", category.name } } );
+      }
+    }
+  };
+  write_timers( "fixpoint_event_loop_runs_total",
+                "Rule callbacks run by each network thread, by category.",
+                &Timer::Record::count );
+  write_timers( "fixpoint_event_loop_ticks_total",
+                "TSC ticks spent in each network thread's rule callbacks, by category.",
+                &Timer::Record::total_ticks );
+}
+
 shared_ptr<Server> Server::init( const Address& address,
                                  shared_ptr<Scheduler> scheduler,
-                                 vector<Address> peer_servers )
+                                 vector<Address> peer_servers,
+                                 size_t network_threads )
 {
   auto runtime = std::make_shared<Server>( scheduler );
-  runtime->network_worker_.emplace( runtime->relater_ );
+  runtime->network_worker_.emplace( runtime->relater_, network_threads );
   runtime->network_worker_->start();
   runtime->network_worker_->start_server( address );
 
@@ -6,6 +6,7 @@
 #include "repository.hh"
 
 #include <memory>
+#include <ostream>
 
 class FrontendRT
 {
@@ -23,7 +24,7 @@ public:
   ReadOnlyRT() {}
   static std::shared_ptr<ReadOnlyRT> init();
   virtual Handle<Value> execute( Handle<Relation> x ) override;
-  IRuntime& get_rt() { return relater_; }
+  Relater& get_rt() { return relater_; }
 };
 
 class ReadWriteRT : public ReadOnlyRT
@@ -52,7 +53,8 @@ public:
   static std::shared_ptr<Client> init( const Address& address );
   virtual Handle<Value> execute( Handle<Relation> x ) override;
 
-  IRuntime& get_rt() { return relater_; }
+  Relater& get_rt() { return relater_; }
+  NetworkWorker& get_network() { return *network_worker_; }
   std::shared_ptr<IRuntime>& get_server() { return server_; }
 };
 
@@ -69,7 +71,12 @@ public:
 
   static std::shared_ptr<Server> init( const Address& address,
                                        std::shared_ptr<Scheduler> scheduler,
-                                       const std::vector<Address> peer_servers = {} );
+                                       const std::vector<Address> peer_servers = {},
+                                       size_t network_threads = 1 );
   void join();
+  Relater& get_rt() { return relater_; }
+  NetworkWorker& get_network() { return *network_worker_; }
+  // Runtime telemetry in the Prometheus text format; takes no lock on the dependency graph
+  void write_metrics( std::ostream& out );
   ~Server();
 };
@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <csignal>
+#include <cstdio>
+#include <format>
+#include <map>
+#include <mutex>
+#include <sys/time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#include <absl/container/flat_hash_map.h>
+#include <glog/logging.h>
+
+#include "sampler.hh"
+
+using namespace std;
+
+namespace guest_symbols {
+namespace {
+mutex registry_mutex;
+// Linked programs by the start address of their code. Programs are held weakly, so that entries whose code has
+// been freed are skipped.
+map<uintptr_t, weak_ptr<Program>> registry;
+FILE* perf_map = nullptr;
+
+void write_perf_map( const Program& program )
+{
+  for ( const auto& symbol : program.symbols() ) {
+    fprintf( perf_map,
+             "%lx %lx %s\n",
+             reinterpret_cast<uintptr_t>( program.code() ) + symbol.offset,
+             symbol.size,
+             symbol.name.c_str() );
+  }
+  fflush( perf_map );
+}
+}
+
+void register_program( const shared_ptr<Program>& program )
+{
+  unique_lock lock( registry_mutex );
+  registry[reinterpret_cast<uintptr_t>( program->code() )] = program;
+  if ( perf_map ) {
+    write_perf_map( *program );
+  }
+}
+
+void enable_perf_map()
+{
+  unique_lock lock( registry_mutex );
+  if ( perf_map ) {
+    return;
+  }
+
+  auto path = std::format( "/tmp/perf-{}.map", getpid() );
+  perf_map = fopen( path.c_str(), "a" );
+  if ( !perf_map ) {
+    PLOG( WARNING ) << "could not open " << path;
+    return;
+  }
+
+  for ( const auto& [_, weak] : registry ) {
+    if ( auto program = weak.lock() ) {
+      write_perf_map( *program );
+    }
+  }
+}
+
+optional<string> symbolize( uintptr_t pc )
+{
+  shared_ptr<Program> program;
+  {
+    unique_lock lock( registry_mutex );
+    auto it = registry.upper_bound( pc );
+    if ( it == registry.begin() ) {
+      return {};
+    }
+    program = prev( it )->second.lock();
+  }
+
+  if ( !program or pc >= reinterpret_cast<uintptr_t>( program->code() ) + program->code_size() ) {
+    return {};
+  }
+
+  const uint64_t offset = pc - reinterpret_cast<uintptr_t>( program->code() );
+  const auto& symbols = program->symbols();
+  auto it = upper_bound(
+    symbols.begin(), symbols.end(), offset, []( uint64_t x, const GuestSymbol& s ) { return x < s.offset; } );
+  if ( it == symbols.begin() or offset >= prev( it )->offset + prev( it )->size ) {
+    return "[guest]";
+  }
+  return prev( it )->name;
+}
+}
+
+Sampler::Sampler()
+  : samples_( make_unique<atomic<uintptr_t>[]>( capacity ) )
+{}
+
+void Sampler::record( int, siginfo_t*, void* context )
+{
+  auto& sampler = global_sampler();
+  const size_t index = sampler.next_.fetch_add( 1, memory_order_relaxed );
+  if ( index < capacity ) {
+    const auto* uc = static_cast<const ucontext_t*>( context );
+    sampler.samples_[index].store( uc->uc_mcontext.gregs[REG_RIP], memory_order_relaxed );
+  }
+}
+
+void Sampler::start( unsigned frequency )
+{
+  struct sigaction sa {};
+  sa.sa_sigaction = record;
+  sa.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset( &sa.sa_mask );
+  if ( sigaction( SIGPROF, &sa, nullptr ) != 0 ) {
+    PLOG( ERROR ) << "sigaction";
+    return;
+  }
+
+  const long interval = 1000000 / std::max( frequency, 1u );
+  itimerval timer { { 0, interval }, { 0, interval } };
+  if ( setitimer( ITIMER_PROF, &timer, nullptr ) != 0 ) {
+    PLOG( ERROR ) << "setitimer";
+    return;
+  }
+  running_ = true;
+}
+
+void Sampler::stop()
+{
+  if ( not running_ ) {
+    return;
+  }
+  itimerval timer {};
+  setitimer( ITIMER_PROF, &timer, nullptr );
+  signal( SIGPROF, SIG_IGN );
+  running_ = false;
+}
+
+void Sampler::summary( ostream& out ) const
+{
+  const size_t total = std::min( next_.load(), capacity );
+
+  absl::flat_hash_map<string, size_t> counts;
+  for ( size_t i = 0; i < total; i++ ) {
+    counts[guest_symbols::symbolize( samples_[i].load( memory_order_relaxed ) ).value_or( "[host]" )]++;
+  }
+
+  vector<pair<string, size_t>> sorted( counts.begin(), counts.end() );
+  std::sort( sorted.begin(), sorted.end(), []( const auto& a, const auto& b ) { return a.second > b.second; } );
+
+  out << "Guest samples\n-------------\n\n";
+  out << "Total samples: " << total;
+  if ( next_.load() > capacity ) {
+    out << " (" << next_.load() - capacity << " dropped)";
+  }
+  out << "\n";
+
+  for ( const auto& [name, count] : sorted ) {
+    out << std::format( "{:>10} {:>6.1f}%   {}\n", count, 100.0 * count / total, name );
+  }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <csignal>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "program.hh"
+#include "summarize.hh"
+
+/**
+ * Symbols of linked guest programs, so that addresses inside their code buffers can be attributed to wasm2c
+ * functions by the built-in sampler and by perf.
+ */
+namespace guest_symbols {
+// Called by link_program for every linked program
+void register_program( const std::shared_ptr<Program>& program );
+
+// Append the functions of every program, linked so far and from now on, to /tmp/perf-<pid>.map.
+void enable_perf_map();
+
+// Name of the guest function containing pc, if pc is inside the code of a linked program
+std::optional<std::string> symbolize( uintptr_t pc );
+}
+
+/**
+ * Samples the program counter on SIGPROF (ITIMER_PROF, i.e. proportionally to CPU time across all threads) and
+ * reports the guest functions that were executing. The signal handler only appends to a preallocated buffer; samples
+ * are symbolized when the summary is requested.
+ */
+class Sampler : public Summarizable
+{
+public:
+  constexpr static size_t capacity = 1 << 20;
+
+private:
+  std::unique_ptr<std::atomic<uintptr_t>[]> samples_;
+  std::atomic<size_t> next_ { 0 };
+  bool running_ { false };
+
+  static void record( int, siginfo_t*, void* context );
+
+public:
+  Sampler();
+
+  void start( unsigned frequency = 1000 );
+  void stop();
+
+  void summary( std::ostream& out ) const override;
+  void reset_summary() override { next_ = 0; }
+
+  Sampler( const Sampler& ) = delete;
+  Sampler& operator=( const Sampler& ) = delete;
+};
+
+inline Sampler& global_sampler()
+{
+  static Sampler the_global_sampler;
+  return the_global_sampler;
+}
@@ -486,6 +486,7 @@ LocalScheduler::Result<Value> LocalScheduler::evalStrict( Handle<Object> express
     return {};
   }
 
+  relater_->get().put( goal, result.value() );
   return result;
 }
 
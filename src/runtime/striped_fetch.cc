@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cstring>
+
+#include <glog/logging.h>
+
+#include "blake3.hh"
+#include "striped_fetch.hh"
+
+using namespace std;
+
+optional<vector<StripedFetches::Stripe>> StripedFetches::start( Handle<Named> name,
+                                                                weak_ptr<IRuntime> origin,
+                                                                const vector<size_t>& replicas )
+{
+  auto state = state_.write();
+  if ( state->abandoned.erase( name ) ) {
+    return {};
+  }
+  if ( state->in_flight.contains( name ) ) {
+    return vector<Stripe> {};
+  }
+
+  const size_t size = name.size();
+  const size_t count = min( replicas.size(), size / MIN_STRIPE );
+  if ( size < THRESHOLD or count < 2 ) {
+    return {};
+  }
+
+  // Page-aligned stripes, the last one taking the remainder
+  const size_t length = ( ( size + count - 1 ) / count + 4095 ) & ~size_t( 4095 );
+  vector<Stripe> stripes;
+  for ( size_t i = 0; i < count and i * length < size; i++ ) {
+    stripes.push_back( { .offset = i * length, .length = min( length, size - i * length ), .replica = replicas[i] } );
+  }
+
+  auto fetch = make_shared<Fetch>( size, move( origin ) );
+  fetch->outstanding = stripes;
+  state->in_flight.emplace( name, move( fetch ) );
+
+  VLOG( 1 ) << "Fetching " << name << " in " << stripes.size() << " stripes";
+  return stripes;
+}
+
+StripedFetches::Fallback StripedFetches::forget( Handle<Named> name, const Fetch& fetch )
+{
+  auto state = state_.write();
+  state->in_flight.erase( name );
+  state->abandoned.insert( name );
+  return { fetch.origin };
+}
+
+StripedFetches::Outcome StripedFetches::receive( Handle<Named> name, uint64_t offset, string_view data )
+{
+  shared_ptr<Fetch> fetch;
+  {
+    auto state = state_.read();
+    auto it = state->in_flight.find( name );
+    if ( it == state->in_flight.end() ) {
+      // A late stripe of an abandoned fetch
+      return {};
+    }
+    fetch = it->second;
+  }
+
+  auto matches = [&]( const Stripe& s ) { return s.offset == offset; };
+
+  {
+    unique_lock lock( fetch->mutex );
+    if ( fetch->failed ) {
+      return {};
+    }
+
+    auto it = ranges::find_if( fetch->outstanding, matches );
+    if ( it == fetch->outstanding.end() or it->length != data.size() ) {
+      LOG( WARNING ) << "Abandoning striped fetch of " << name << ": "
+                     << ( data.empty() ? "replica does not hold it" : "unexpected range" );
+      fetch->failed = true;
+      lock.unlock();
+      return forget( name, *fetch );
+    }
+  }
+
+  // Stripes are disjoint, so they are copied in without holding the lock
+  memcpy( fetch->data.data() + offset, data.data(), data.size() );
+
+  {
+    unique_lock lock( fetch->mutex );
+    auto it = ranges::find_if( fetch->outstanding, matches );
+    if ( fetch->failed or it == fetch->outstanding.end() ) {
+      return {};
+    }
+    fetch->outstanding.erase( it );
+    if ( not fetch->outstanding.empty() ) {
+      return {};
+    }
+  }
+
+  const auto hash = blake3::encode( as_bytes( fetch->data.span() ) );
+  if ( Handle<Named>( hash, name.size() ) != Handle<Named>( name.hash(), name.size() ) ) {
+    LOG( WARNING ) << "Abandoning striped fetch of " << name << ": data does not match its name";
+    return forget( name, *fetch );
+  }
+
+  state_.write()->in_flight.erase( name );
+  return Complete { make_shared<OwnedBlob>( move( fetch->data ) ) };
+}
+
+vector<pair<Handle<Named>, StripedFetches::Fallback>> StripedFetches::abandon( size_t replica )
+{
+  vector<pair<Handle<Named>, shared_ptr<Fetch>>> waiting;
+  {
+    auto state = state_.read();
+    for ( const auto& [name, fetch] : state->in_flight ) {
+      unique_lock lock( fetch->mutex );
+      if ( not fetch->failed
+           and ranges::any_of( fetch->outstanding, [&]( const Stripe& s ) { return s.replica == replica; } ) ) {
+        fetch->failed = true;
+        waiting.emplace_back( name, fetch );
+      }
+    }
+  }
+
+  vector<pair<Handle<Named>, Fallback>> fallbacks;
+  for ( const auto& [name, fetch] : waiting ) {
+    fallbacks.emplace_back( name, forget( name, *fetch ) );
+  }
+  return fallbacks;
+}
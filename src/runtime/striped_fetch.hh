@@ -0,0 +1,98 @@
+#pragma once
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/container/flat_hash_set.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "handle.hh"
+#include "interface.hh"
+#include "mutex.hh"
+#include "object.hh"
+#include "runtimestorage.hh"
+
+/**
+ * Large blobs held by several peers are fetched as ranges, one stripe per replica, and reassembled here. Stripes
+ * may arrive on different IO threads; each writes its own part of the buffer, and whoever completes the last
+ * stripe verifies the hash. If a replica turns out not to hold the blob, a stripe comes back malformed or the
+ * result does not hash to the requested name, the fetch is abandoned and the caller falls back to requesting the
+ * whole blob from the peer it was originally asked of.
+ *
+ * Trees are left out on purpose. A tree is answered with everything it reaches (TREEDATA and BLOBDATA messages
+ * from one peer, see Remote::send_tree), not as one object that could be split into ranges, and its own entries
+ * are 32-byte handles, rarely anywhere near THRESHOLD.
+ */
+class StripedFetches
+{
+public:
+  // Blobs smaller than this are always fetched whole
+  static constexpr size_t THRESHOLD = 1 << 22;
+  static constexpr size_t MIN_STRIPE = 1 << 20;
+
+  struct Stripe
+  {
+    uint64_t offset;
+    uint64_t length;
+    size_t replica;
+  };
+
+  // The fetch completed and the blob hashed to its name
+  struct Complete
+  {
+    BlobData blob;
+  };
+
+  // The fetch was abandoned; ask origin for the whole blob
+  struct Fallback
+  {
+    std::weak_ptr<IRuntime> origin;
+  };
+
+  using Outcome = std::variant<std::monostate, Complete, Fallback>;
+
+private:
+  struct Fetch
+  {
+    OwnedMutBlob data;
+    std::weak_ptr<IRuntime> origin;
+
+    std::mutex mutex {};
+    std::vector<Stripe> outstanding {};
+    bool failed {};
+
+    Fetch( size_t size, std::weak_ptr<IRuntime> origin )
+      : data( OwnedMutBlob::map( size ) )
+      , origin( std::move( origin ) )
+    {}
+  };
+
+  struct State
+  {
+    absl::flat_hash_map<Handle<Named>, std::shared_ptr<Fetch>, AbslHash> in_flight {};
+    // Abandoned fetches, whose next request has to go to the origin whole
+    absl::flat_hash_set<Handle<Named>, AbslHash> abandoned {};
+  };
+
+  SharedMutex<State> state_ {};
+
+  Fallback forget( Handle<Named> name, const Fetch& fetch );
+
+public:
+  // Plan a striped fetch of name across replicas (identified by the caller). Returns nothing if the blob should be
+  // requested whole: it is too small, there are fewer than two replicas, or its last striped fetch was abandoned.
+  // Returns no stripes if a fetch of it is already in flight.
+  std::optional<std::vector<Stripe>> start( Handle<Named> name,
+                                            std::weak_ptr<IRuntime> origin,
+                                            const std::vector<size_t>& replicas );
+
+  // Record a range received from a replica. An empty range means the replica does not hold the blob.
+  Outcome receive( Handle<Named> name, uint64_t offset, std::string_view data );
+
+  // Abandon the fetches still waiting on a replica that went away
+  std::vector<std::pair<Handle<Named>, Fallback>> abandon( size_t replica );
+};
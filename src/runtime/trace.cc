@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <format>
+#include <sstream>
+
+#include "trace.hh"
+
+using namespace std;
+
+namespace {
+string escape( const string& s )
+{
+  // Literal handles print their raw contents
+  string escaped;
+  for ( const unsigned char c : s ) {
+    if ( c < 0x20 or c >= 0x7f ) {
+      escaped += std::format( "\\u{:04x}", c );
+      continue;
+    }
+    if ( c == '"' or c == '\\' ) {
+      escaped.push_back( '\\' );
+    }
+    escaped.push_back( c );
+  }
+  return escaped;
+}
+
+// Chrome pairs the async events of a relation by this id; `fix analyze` also uses it to join events
+uint64_t async_id( Handle<Fix> handle )
+{
+  const auto words = (u64x4)handle.content;
+  return words[0] ^ words[1] ^ words[2] ^ words[3];
+}
+}
+
+void Tracer::enable()
+{
+  // The trace starts the first time it is enabled; later calls resume it
+  if ( start_tsc_ == 0 ) {
+    start_time_ = chrono::steady_clock::now();
+    start_tsc_ = Timer::read_tsc();
+  }
+  enabled_.store( true, memory_order_relaxed );
+}
+
+Tracer::Ring& Tracer::local()
+{
+  static thread_local shared_ptr<Ring> ring;
+  if ( !ring ) {
+    ring = make_shared<Ring>();
+    unique_lock lock( threads_mutex_ );
+    ring->thread = threads_.size();
+    threads_.push_back( ring );
+  }
+  return *ring;
+}
+
+void Tracer::record( Event event, Handle<Fix> handle, Handle<Fix> other )
+{
+  auto& ring = local();
+  const size_t next = ring.next.load( memory_order_relaxed );
+  ring.entries[next % capacity] = { Timer::read_tsc(), handle, other, event };
+  ring.next.store( next + 1, memory_order_release );
+}
+
+void Tracer::write_json( ostream& out ) const
+{
+  // Convert ticks to microseconds with the rate measured since enable()
+  const double elapsed_us
+    = chrono::duration<double, micro>( chrono::steady_clock::now() - start_time_ ).count();
+  const uint64_t elapsed_ticks = Timer::read_tsc() - start_tsc_;
+  const double us_per_tick = elapsed_ticks ? elapsed_us / elapsed_ticks : 0;
+
+  vector<shared_ptr<Ring>> threads;
+  {
+    unique_lock lock( threads_mutex_ );
+    threads = threads_;
+  }
+
+  out << "{\"traceEvents\":[\n";
+  bool first = true;
+  for ( const auto& ring : threads ) {
+    const size_t end = ring->next.load( memory_order_acquire );
+    const size_t begin = end - min( end, capacity );
+    for ( size_t i = begin; i < end; i++ ) {
+      const Entry entry = ring->entries[i % capacity];
+      if ( entry.tsc < start_tsc_ ) {
+        continue;
+      }
+
+      ostringstream handle;
+      handle << entry.handle;
+
+      const char* phase = "i";
+      string extra;
+      switch ( entry.event ) {
+        case Event::Started:
+          phase = "b";
+          break;
+        case Event::Finished:
+          phase = "e";
+          break;
+        case Event::Blocked:
+        case Event::Unblocked:
+          phase = "n";
+          break;
+        case Event::ProgressBegin:
+        case Event::ApplyBegin:
+          phase = "B";
+          break;
+        case Event::ProgressEnd:
+        case Event::ApplyEnd:
+          phase = "E";
+          break;
+        default:
+          extra = ",\"s\":\"t\"";
+          break;
+      }
+
+      // Started, Blocked, Unblocked and Finished form one async track per relation
+      const bool async = *phase == 'b' or *phase == 'e' or *phase == 'n';
+      out << ( first ? "" : ",\n" );
+      first = false;
+      out << std::format( "{{\"name\":\"{}\",\"cat\":\"{}\",\"ph\":\"{}\",\"ts\":{:.3f},\"pid\":0,\"tid\":{}{}",
+                          async and *phase != 'n' ? "relation" : EVENT_NAMES[static_cast<size_t>( entry.event )],
+                          async ? "relation" : "task",
+                          phase,
+                          ( entry.tsc - start_tsc_ ) * us_per_tick,
+                          ring->thread,
+                          extra );
+      out << std::format( ",\"id\":\"{:#x}\"", async_id( entry.handle ) );
+      out << ",\"args\":{\"handle\":\"" << escape( handle.str() ) << "\"";
+      if ( entry.event == Event::Blocked ) {
+        out << std::format( ",\"on\":\"{:#x}\"", async_id( entry.other ) );
+      } else if ( entry.event == Event::ApplyBegin ) {
+        ostringstream procedure;
+        procedure << entry.other;
+        out << ",\"procedure\":\"" << escape( procedure.str() ) << "\"";
+      }
+      out << "}}";
+    }
+  }
+  out << "\n]}\n";
+}
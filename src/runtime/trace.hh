@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "handle.hh"
+#include "timer.hh"
+
+/**
+ * Opt-in timeline of what happens to each relation: when the dependency graph starts, blocks, unblocks and
+ * finishes it, when an executor thread progresses it and applies a procedure for it, and when its RUN and RESULT
+ * messages cross the network. Blocked events also name what the relation waits on, and Loaded marks data arriving,
+ * so the trace carries the executed graph for `fix analyze`. Each thread appends to its own ring of the most recent
+ * events without taking a lock; the rings are merged and written out as Chrome trace-event JSON, which
+ * chrome://tracing and the Perfetto UI both load.
+ */
+class Tracer
+{
+public:
+  enum class Event : uint8_t
+  {
+    Started,
+    Blocked,
+    Unblocked,
+    Finished,
+    Loaded,
+    ProgressBegin,
+    ProgressEnd,
+    ApplyBegin,
+    ApplyEnd,
+    SentRun,
+    ReceivedRun,
+    SentResult,
+    ReceivedResult,
+    count
+  };
+
+  static constexpr std::array<const char*, static_cast<size_t>( Event::count )> EVENT_NAMES { "started",
+                                                                                          "blocked",
+                                                                                          "unblocked",
+                                                                                          "finished",
+                                                                                          "loaded",
+                                                                                          "progress",
+                                                                                          "progress",
+                                                                                          "apply",
+                                                                                          "apply",
+                                                                                          "sent run",
+                                                                                          "received run",
+                                                                                          "sent result",
+                                                                                          "received result" };
+
+  // Events kept per thread; older ones are overwritten
+  static constexpr size_t capacity = 1 << 16;
+
+  struct Entry
+  {
+    uint64_t tsc {};
+    Handle<Fix> handle {};
+    // What a Blocked relation waits on, or the procedure of an Apply
+    Handle<Fix> other {};
+    Event event { Event::count };
+  };
+
+private:
+  // Written only by its own thread. The entries below `next` are published by the release store to it.
+  struct Ring
+  {
+    std::unique_ptr<Entry[]> entries { std::make_unique<Entry[]>( capacity ) };
+    std::atomic<size_t> next { 0 };
+    size_t thread {};
+  };
+
+  std::atomic<bool> enabled_ { false };
+  uint64_t start_tsc_ {};
+  std::chrono::steady_clock::time_point start_time_ {};
+
+  mutable std::mutex threads_mutex_ {};
+  std::vector<std::shared_ptr<Ring>> threads_ {};
+
+  Ring& local();
+
+public:
+  void enable();
+  // Stop recording, e.g. before writing the trace out; enable() resumes it
+  void disable() { enabled_.store( false, std::memory_order_relaxed ); }
+  bool enabled() const { return enabled_.load( std::memory_order_relaxed ); }
+
+  void record( Event event, Handle<Fix> handle, Handle<Fix> other = {} );
+
+  // Write the events of every thread as Chrome trace-event JSON. Threads still recording may overwrite their oldest
+  // events while this runs, so the trace should be written after disable() or once the work is done.
+  void write_json( std::ostream& out ) const;
+};
+
+inline Tracer& global_tracer()
+{
+  static Tracer the_global_tracer;
+  return the_global_tracer;
+}
+
+inline void trace( Tracer::Event event, Handle<Fix> handle, Handle<Fix> other = {} )
+{
+  if ( global_tracer().enabled() ) {
+    global_tracer().record( event, handle, other );
+  }
+}
+
+/**
+ * Records a pair of begin and end events around a scope.
+ */
+template<Tracer::Event Begin, Tracer::Event End>
+class TraceScope
+{
+  Handle<Fix> handle_;
+  Handle<Fix> other_;
+
+public:
+  TraceScope( Handle<Fix> handle, Handle<Fix> other = {} )
+    : handle_( handle )
+    , other_( other )
+  {
+    trace( Begin, handle_, other_ );
+  }
+
+  ~TraceScope() { trace( End, handle_, other_ ); }
+
+  TraceScope( const TraceScope& ) = delete;
+  TraceScope& operator=( const TraceScope& ) = delete;
+};
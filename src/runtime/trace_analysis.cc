@@ -0,0 +1,306 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <format>
+#include <map>
+#include <unordered_set>
+
+#include "trace_analysis.hh"
+
+using namespace std;
+
+namespace {
+// The trace has one event per line with its keys in a fixed order, so fields are found by name rather than by
+// parsing the JSON in full. Escapes in strings are kept as written.
+optional<string> string_field( const string& line, string_view key )
+{
+  const string pattern = std::format( "\"{}\":\"", key );
+  size_t pos = line.find( pattern );
+  if ( pos == string::npos ) {
+    return {};
+  }
+
+  string value;
+  for ( pos += pattern.size(); pos < line.size() and line[pos] != '"'; pos++ ) {
+    if ( line[pos] == '\\' and pos + 1 < line.size() ) {
+      value.push_back( line[pos++] );
+    }
+    value.push_back( line[pos] );
+  }
+  return value;
+}
+
+optional<double> number_field( const string& line, string_view key )
+{
+  const string pattern = std::format( "\"{}\":", key );
+  const size_t pos = line.find( pattern );
+  if ( pos == string::npos ) {
+    return {};
+  }
+  return strtod( line.c_str() + pos + pattern.size(), nullptr );
+}
+
+optional<uint64_t> id_field( const string& line, string_view key )
+{
+  return string_field( line, key ).transform( []( const string& id ) { return stoull( id, nullptr, 16 ); } );
+}
+
+vector<pair<string, double>> largest( const map<string, double>& totals, size_t count )
+{
+  vector<pair<string, double>> sorted( totals.begin(), totals.end() );
+  sort( sorted.begin(), sorted.end(), []( const auto& a, const auto& b ) { return a.second > b.second; } );
+  sorted.resize( min( sorted.size(), count ) );
+  return sorted;
+}
+}
+
+double TraceAnalysis::Interval::overlap( double from, double to ) const
+{
+  return max( 0.0, min( end, to ) - max( begin, from ) );
+}
+
+TraceAnalysis::TraceAnalysis( istream& trace )
+{
+  unordered_map<size_t, vector<Open>> open;
+  string line;
+  while ( getline( trace, line ) ) {
+    add_event( line, open );
+  }
+  find_critical_path();
+}
+
+void TraceAnalysis::add_event( const string& line, unordered_map<size_t, vector<Open>>& open )
+{
+  const auto name = string_field( line, "name" );
+  const auto phase = string_field( line, "ph" );
+  const auto ts = number_field( line, "ts" );
+  const auto tid = number_field( line, "tid" );
+  const auto id = id_field( line, "id" );
+  if ( !name or !phase or !ts or !tid or !id ) {
+    return;
+  }
+
+  const size_t thread = *tid;
+  threads_ = max( threads_, thread + 1 );
+  end_ = max( end_, *ts );
+
+  auto& node = nodes_[*id];
+  if ( node.handle.empty() ) {
+    node.handle = string_field( line, "handle" ).value_or( "" );
+  }
+
+  if ( *phase == "b" ) {
+    // A relation starts again after each time it is unblocked
+    node.start = min( node.start.value_or( *ts ), *ts );
+  } else if ( *phase == "e" ) {
+    node.finish = *ts;
+  } else if ( *name == "blocked" ) {
+    if ( const auto on = id_field( line, "on" ) ) {
+      if ( find( node.dependencies.begin(), node.dependencies.end(), *on ) == node.dependencies.end() ) {
+        node.dependencies.push_back( *on );
+      }
+      auto& dependency = nodes_[*on];
+      dependency.requested = min( dependency.requested.value_or( *ts ), *ts );
+    }
+  } else if ( *name == "loaded" ) {
+    node.data = true;
+    node.finish = *ts;
+  } else if ( *name == "sent run" ) {
+    node.sent = min( node.sent.value_or( *ts ), *ts );
+  } else if ( *name == "received result" ) {
+    node.received = *ts;
+  } else if ( *phase == "B" ) {
+    open[thread].push_back( { *id, *name == "apply", string_field( line, "procedure" ).value_or( "" ), *ts } );
+  } else if ( *phase == "E" ) {
+    // Slices nest on each thread; an end whose begin was overwritten in the ring is dropped
+    auto& stack = open[thread];
+    if ( stack.empty() or stack.back().node != *id ) {
+      return;
+    }
+    const Open slice = stack.back();
+    stack.pop_back();
+    const Interval interval { slice.begin, *ts };
+
+    if ( !slice.apply ) {
+      node.progress.push_back( interval );
+      progress_.push_back( interval );
+      return;
+    }
+
+    // An apply is charged to the relation being progressed around it
+    const auto enclosing
+      = find_if( stack.rbegin(), stack.rend(), []( const Open& outer ) { return !outer.apply; } );
+    if ( enclosing != stack.rend() ) {
+      nodes_[enclosing->node].applies.push_back( { interval, slice.procedure } );
+    }
+  }
+}
+
+void TraceAnalysis::find_critical_path()
+{
+  optional<uint64_t> last;
+  for ( const auto& [id, node] : nodes_ ) {
+    if ( !node.data and node.finish and ( !last or *node.finish > *nodes_.at( *last ).finish ) ) {
+      last = id;
+    }
+  }
+
+  unordered_set<uint64_t> visited;
+  for ( optional<uint64_t> current = last; current and visited.insert( *current ).second; ) {
+    const Node& node = nodes_.at( *current );
+
+    // The dependency that finished last is the one that let this node finish
+    optional<uint64_t> previous;
+    for ( const auto dependency : node.dependencies ) {
+      const auto& candidate = nodes_.at( dependency );
+      if ( candidate.finish and *candidate.finish <= *node.finish
+           and ( !previous or *candidate.finish > *nodes_.at( *previous ).finish ) ) {
+        previous = dependency;
+      }
+    }
+
+    const double end = *node.finish;
+    const auto first_seen = node.start.or_else( [&] { return node.requested; } );
+    const double begin = previous ? *nodes_.at( *previous ).finish : min( end, first_seen.value_or( end ) );
+
+    Segment segment { *current, { begin, end } };
+    const double duration = end - begin;
+    if ( node.data ) {
+      segment.transfer = duration;
+    } else {
+      for ( const auto& slice : node.progress ) {
+        segment.executed += slice.overlap( begin, end );
+      }
+      if ( node.sent and node.received ) {
+        segment.transfer = Interval { *node.sent, *node.received }.overlap( begin, end );
+      }
+      segment.executed = min( segment.executed, duration - segment.transfer );
+      segment.queued = duration - segment.transfer - segment.executed;
+    }
+    critical_path_.push_back( segment );
+
+    current = previous;
+  }
+
+  reverse( critical_path_.begin(), critical_path_.end() );
+}
+
+vector<double> TraceAnalysis::parallelism( size_t buckets ) const
+{
+  vector<double> profile( buckets );
+  if ( buckets == 0 or end_ <= 0 ) {
+    return profile;
+  }
+
+  const double width = end_ / buckets;
+  for ( const auto& slice : progress_ ) {
+    const size_t first = min( buckets - 1, static_cast<size_t>( slice.begin / width ) );
+    const size_t last = min( buckets - 1, static_cast<size_t>( slice.end / width ) );
+    for ( size_t i = first; i <= last; i++ ) {
+      profile[i] += slice.overlap( i * width, ( i + 1 ) * width );
+    }
+  }
+
+  for ( auto& p : profile ) {
+    p /= width;
+  }
+  return profile;
+}
+
+vector<pair<string, double>> TraceAnalysis::top_procedures( size_t count ) const
+{
+  map<string, double> totals;
+  for ( const auto& segment : critical_path_ ) {
+    for ( const auto& apply : nodes_.at( segment.node ).applies ) {
+      const double time = apply.interval.overlap( segment.interval.begin, segment.interval.end );
+      if ( time > 0 ) {
+        totals[apply.procedure] += time;
+      }
+    }
+  }
+  return largest( totals, count );
+}
+
+vector<pair<string, double>> TraceAnalysis::top_transfers( size_t count ) const
+{
+  map<string, double> totals;
+  for ( const auto& segment : critical_path_ ) {
+    if ( segment.transfer > 0 ) {
+      totals[nodes_.at( segment.node ).handle] += segment.transfer;
+    }
+  }
+  return largest( totals, count );
+}
+
+void TraceAnalysis::report( ostream& out, size_t top, size_t buckets ) const
+{
+  if ( critical_path_.empty() ) {
+    out << "No finished relations in the trace.\n";
+    return;
+  }
+
+  double queued = 0, transfer = 0, executed = 0;
+  for ( const auto& segment : critical_path_ ) {
+    queued += segment.queued;
+    transfer += segment.transfer;
+    executed += segment.executed;
+  }
+  const double length = critical_path_.back().interval.end - critical_path_.front().interval.begin;
+
+  double busy = 0;
+  for ( const auto& slice : progress_ ) {
+    busy += slice.end - slice.begin;
+  }
+
+  out << std::format( "Makespan: {:.3f} ms on {} threads, average parallelism {:.2f}\n",
+                      end_ / 1000,
+                      threads_,
+                      end_ > 0 ? busy / end_ : 0 );
+  out << std::format(
+    "Critical path: {} steps over {:.3f} ms ({:.1f}% of makespan), starting at {:.3f} ms\n",
+    critical_path_.size(),
+    length / 1000,
+    end_ > 0 ? 100 * length / end_ : 0,
+    critical_path_.front().interval.begin / 1000 );
+  out << std::format( "  queued {:.3f} ms, transfer {:.3f} ms, executed {:.3f} ms\n\n",
+                      queued / 1000,
+                      transfer / 1000,
+                      executed / 1000 );
+
+  out << std::format( "{:>12} {:>12} {:>12} {:>12} {:>12}  {}\n",
+                      "start (ms)",
+                      "total (ms)",
+                      "queued",
+                      "transfer",
+                      "executed",
+                      "step" );
+  for ( const auto& segment : critical_path_ ) {
+    const auto& node = nodes_.at( segment.node );
+    out << std::format( "{:12.3f} {:12.3f} {:12.3f} {:12.3f} {:12.3f}  {}{}\n",
+                        segment.interval.begin / 1000,
+                        ( segment.interval.end - segment.interval.begin ) / 1000,
+                        segment.queued / 1000,
+                        segment.transfer / 1000,
+                        segment.executed / 1000,
+                        node.data ? "load " : "",
+                        node.handle );
+  }
+
+  out << "\nParallelism over time:\n";
+  const auto profile = parallelism( buckets );
+  const double width = end_ / max<size_t>( buckets, 1 );
+  for ( size_t i = 0; i < profile.size(); i++ ) {
+    const size_t bar = lround( 40 * profile[i] / max<size_t>( threads_, 1 ) );
+    out << std::format( "{:12.3f} ms {:6.2f}  {}\n", i * width / 1000, profile[i], string( bar, '#' ) );
+  }
+
+  out << "\nTop procedures on the critical path:\n";
+  for ( const auto& [procedure, time] : top_procedures( top ) ) {
+    out << std::format( "{:12.3f} ms  {}\n", time / 1000, procedure );
+  }
+
+  out << "\nTop transfers on the critical path:\n";
+  for ( const auto& [handle, time] : top_transfers( top ) ) {
+    out << std::format( "{:12.3f} ms  {}\n", time / 1000, handle );
+  }
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * Post-mortem analysis of a trace written by Tracer::write_json. Rebuilds the executed graph from the Blocked edges
+ * recorded by the dependency graph, then walks back from the last relation to finish through whichever dependency
+ * finished last to find the critical path. Each step of the path is split into time spent executing on this node,
+ * waiting on data or on a remote node (transfer), and sitting runnable or blocked on something else (queued).
+ */
+class TraceAnalysis
+{
+public:
+  struct Interval
+  {
+    double begin {};
+    double end {};
+
+    double overlap( double from, double to ) const;
+  };
+
+  struct Apply
+  {
+    Interval interval {};
+    std::string procedure {};
+  };
+
+  // A relation, or a piece of data that relations waited on
+  struct Node
+  {
+    std::string handle {};
+    bool data {};
+    std::optional<double> start {};
+    std::optional<double> finish {};
+    // When a relation first blocked on this
+    std::optional<double> requested {};
+    std::vector<uint64_t> dependencies {};
+    std::vector<Interval> progress {};
+    std::vector<Apply> applies {};
+    std::optional<double> sent {};
+    std::optional<double> received {};
+  };
+
+  struct Segment
+  {
+    uint64_t node {};
+    Interval interval {};
+    double queued {};
+    double transfer {};
+    double executed {};
+  };
+
+private:
+  // A progress or apply slice whose end has not been read yet
+  struct Open
+  {
+    uint64_t node {};
+    bool apply {};
+    std::string procedure {};
+    double begin {};
+  };
+
+  std::unordered_map<uint64_t, Node> nodes_ {};
+  std::vector<Interval> progress_ {};
+  std::vector<Segment> critical_path_ {};
+  double end_ {};
+  size_t threads_ {};
+
+  void add_event( const std::string& line, std::unordered_map<size_t, std::vector<Open>>& open );
+  void find_critical_path();
+
+public:
+  explicit TraceAnalysis( std::istream& trace );
+
+  const Node& node( uint64_t id ) const { return nodes_.at( id ); }
+  size_t threads() const { return threads_; }
+  // Time of the last event, in microseconds from the start of the trace
+  double makespan() const { return end_; }
+
+  // Earliest segment first
+  const std::vector<Segment>& critical_path() const { return critical_path_; }
+
+  // Average number of threads progressing a relation within each of `buckets` equal slices of the makespan
+  std::vector<double> parallelism( size_t buckets ) const;
+
+  // Time on the critical path by procedure applied, and by data or remote relation waited on; largest first
+  std::vector<std::pair<std::string, double>> top_procedures( size_t count ) const;
+  std::vector<std::pair<std::string, double>> top_transfers( size_t count ) const;
+
+  void report( std::ostream& out, size_t top = 10, size_t buckets = 20 ) const;
+};
@@ -0,0 +1,142 @@
+#include <bit>
+#include <stdexcept>
+
+#include "handle_filter.hh"
+#include "overload.hh"
+
+using namespace std;
+
+namespace {
+// Salts keeping the kinds apart: a relation shares its leading words with the handle it refers to.
+constexpr uint64_t NAMED_SALT = 0x9e3779b97f4a7c15;
+constexpr uint64_t TREE_SALT = 0xc2b2ae3d27d4eb4f;
+constexpr uint64_t RELATION_SALT = 0x165667b19e3779f9;
+
+pair<uint64_t, uint64_t> key( const u8x32& content, uint64_t salt, bool include_metadata )
+{
+  const u64x4 words = (u64x4)content;
+  // Trees of different kinds but equal contents are the same data (cf. handle::any_tree_equal)
+  const uint64_t metadata = include_metadata ? words[3] : 0;
+  return { words[0] ^ salt ^ metadata, ( words[1] ^ words[2] ) | 1 };
+}
+}
+
+HandleFilter::HandleFilter( size_t expected_entries )
+  : words_count_( bit_ceil( max( expected_entries * BITS_PER_ENTRY, MIN_BITS ) ) / 64 )
+  , words_( make_unique<atomic<uint64_t>[]>( words_count_ ) )
+{}
+
+HandleFilter::HandleFilter( const HandleFilter& other )
+  : words_count_( other.words_count_ )
+  , words_( words_count_ ? make_unique<atomic<uint64_t>[]>( words_count_ ) : nullptr )
+{
+  for ( size_t i = 0; i < words_count_; i++ ) {
+    words_[i].store( other.words_[i].load( memory_order_relaxed ), memory_order_relaxed );
+  }
+}
+
+HandleFilter& HandleFilter::operator=( const HandleFilter& other )
+{
+  if ( this != &other ) {
+    *this = HandleFilter( other );
+  }
+  return *this;
+}
+
+void HandleFilter::insert( pair<uint64_t, uint64_t> key )
+{
+  if ( empty() ) {
+    throw runtime_error( "HandleFilter: insert into an empty filter" );
+  }
+
+  const uint64_t mask = words_count_ * 64 - 1;
+  for ( size_t i = 0; i < HASHES; i++ ) {
+    const uint64_t bit = ( key.first + i * key.second ) & mask;
+    words_[bit / 64].fetch_or( uint64_t( 1 ) << ( bit % 64 ), memory_order_relaxed );
+  }
+}
+
+bool HandleFilter::may_contain( pair<uint64_t, uint64_t> key ) const
+{
+  if ( empty() ) {
+    return false;
+  }
+
+  const uint64_t mask = words_count_ * 64 - 1;
+  for ( size_t i = 0; i < HASHES; i++ ) {
+    const uint64_t bit = ( key.first + i * key.second ) & mask;
+    if ( not( words_[bit / 64].load( memory_order_relaxed ) & ( uint64_t( 1 ) << ( bit % 64 ) ) ) ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void HandleFilter::insert( Handle<Named> handle )
+{
+  insert( key( handle.content, NAMED_SALT, true ) );
+}
+
+void HandleFilter::insert( Handle<AnyTree> handle )
+{
+  insert( key( handle.content, TREE_SALT, false ) );
+}
+
+void HandleFilter::insert( Handle<Relation> handle )
+{
+  insert( key( handle.content, RELATION_SALT, true ) );
+}
+
+void HandleFilter::insert( Handle<AnyDataType> handle )
+{
+  handle.visit<void>( overload {
+    []( Handle<Literal> ) {},
+    [&]( Handle<Named> h ) { insert( h ); },
+    [&]( Handle<Relation> h ) { insert( h ); },
+    [&]( auto h ) { insert( Handle<AnyTree>( h ) ); },
+  } );
+}
+
+bool HandleFilter::may_contain( Handle<Named> handle ) const
+{
+  return may_contain( key( handle.content, NAMED_SALT, true ) );
+}
+
+bool HandleFilter::may_contain( Handle<AnyTree> handle ) const
+{
+  return may_contain( key( handle.content, TREE_SALT, false ) );
+}
+
+bool HandleFilter::may_contain( Handle<Relation> handle ) const
+{
+  return may_contain( key( handle.content, RELATION_SALT, true ) );
+}
+
+void HandleFilter::serialize( Serializer& serializer ) const
+{
+  serializer.integer( words_count_ );
+  for ( size_t i = 0; i < words_count_; i++ ) {
+    serializer.integer( words_[i].load( memory_order_relaxed ) );
+  }
+}
+
+HandleFilter HandleFilter::parse( Parser& parser )
+{
+  size_t words_count {};
+  parser.integer( words_count );
+  const bool valid_size = words_count == 0 or has_single_bit( words_count );
+  if ( parser.error() or not valid_size or words_count * sizeof( uint64_t ) > parser.input().size() ) {
+    parser.set_error();
+    return {};
+  }
+
+  HandleFilter filter;
+  filter.words_count_ = words_count;
+  filter.words_ = words_count ? make_unique<atomic<uint64_t>[]>( words_count ) : nullptr;
+  for ( size_t i = 0; i < words_count; i++ ) {
+    uint64_t word {};
+    parser.integer( word );
+    filter.words_[i].store( word, memory_order_relaxed );
+  }
+  return filter;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "handle.hh"
+#include "parser.hh"
+
+/**
+ * A Bloom filter over data handles, used to summarize the contents of a repository for peers. Handles are already
+ * cryptographic hashes, so their words are used as the filter's hash functions directly. Insertions are lock-free
+ * and may race with lookups and copies.
+ */
+class HandleFilter
+{
+public:
+  static constexpr size_t BITS_PER_ENTRY = 10;
+  static constexpr size_t HASHES = 7;
+  static constexpr size_t MIN_BITS = 1 << 16;
+
+private:
+  size_t words_count_ {};
+  std::unique_ptr<std::atomic<uint64_t>[]> words_ {};
+
+  void insert( std::pair<uint64_t, uint64_t> key );
+  bool may_contain( std::pair<uint64_t, uint64_t> key ) const;
+
+public:
+  // An empty filter, which contains nothing and cannot be inserted into
+  HandleFilter() {}
+  // A filter sized for about 1% false positives with expected_entries entries
+  explicit HandleFilter( size_t expected_entries );
+
+  HandleFilter( const HandleFilter& other );
+  HandleFilter& operator=( const HandleFilter& other );
+  HandleFilter( HandleFilter&& other ) = default;
+  HandleFilter& operator=( HandleFilter&& other ) = default;
+
+  void insert( Handle<Named> handle );
+  void insert( Handle<AnyTree> handle );
+  void insert( Handle<Relation> handle );
+  void insert( Handle<AnyDataType> handle );
+
+  // False positives are possible; false negatives are not.
+  bool may_contain( Handle<Named> handle ) const;
+  bool may_contain( Handle<AnyTree> handle ) const;
+  bool may_contain( Handle<Relation> handle ) const;
+
+  bool empty() const { return words_count_ == 0; }
+  // The number of entries the filter holds at its intended false-positive rate
+  size_t capacity() const { return words_count_ * 64 / BITS_PER_ENTRY; }
+  size_t serialized_length() const { return sizeof( size_t ) + words_count_ * sizeof( uint64_t ); }
+  void serialize( Serializer& serializer ) const;
+  static HandleFilter parse( Parser& parser );
+};
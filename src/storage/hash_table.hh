@@ -5,13 +5,17 @@
 #include <atomic>
 #include <functional>
 #include <optional>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
 enum class SlotStatus : uint8_t
 {
   Empty,
   Claimed,
-  Occupied
+  Occupied,
+  // Claimed by an insert that found its handle already inserted concurrently; skipped like a Claimed slot
+  Abandoned
 };
 
 template<FixType T, class V, class Hash = std::hash<Handle<T>>, class KeyEqual = std::equal_to<Handle<T>>>
@@ -25,6 +29,8 @@ class FixTable
   };
 
   std::vector<tEntry> data_;
+  // Occupied slots
+  std::atomic<size_t> size_ { 0 };
 
   std::optional<size_t> get_idx( const Handle<T> h ) const
   {
@@ -79,15 +85,58 @@ class FixTable
     }
   }
 
+  // Whether h is already in a slot between idx, where its probe sequence starts, and slot, which this insert has
+  // claimed. Slots still claimed by concurrent inserts are waited on, so that of two inserts of the same handle
+  // exactly one succeeds; each only waits on slots before its own, so they cannot wait on each other.
+  bool inserted_before( const Handle<T> h, size_t idx, const size_t slot ) const
+  {
+    KeyEqual eq;
+    for ( ; idx != slot; idx = idx + 1 == data_.size() ? 0 : idx + 1 ) {
+      auto occupied = data_.at( idx ).occupied.load( std::memory_order_acquire );
+      while ( occupied == static_cast<uint8_t>( SlotStatus::Claimed ) ) {
+        std::this_thread::yield();
+        occupied = data_.at( idx ).occupied.load( std::memory_order_acquire );
+      }
+      if ( occupied == static_cast<uint8_t>( SlotStatus::Occupied ) and eq( data_.at( idx ).h, h ) ) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Publishes a claimed slot holding h, unless h was inserted concurrently. Returns whether it was published. An
+  // abandoned slot is consumed permanently: it is never reclaimed, so the value stored in it is released here.
+  bool publish( const Handle<T> h, const size_t start, const size_t slot )
+  {
+    const auto status = inserted_before( h, start, slot ) ? SlotStatus::Abandoned : SlotStatus::Occupied;
+    if constexpr ( std::is_move_assignable_v<V> ) {
+      if ( status == SlotStatus::Abandoned ) {
+        data_.at( slot ).v = {};
+      }
+    }
+    uint8_t expected = static_cast<uint8_t>( SlotStatus::Claimed );
+    if ( !data_.at( slot ).occupied.compare_exchange_strong(
+           expected, static_cast<uint8_t>( status ), std::memory_order_acq_rel ) ) {
+      throw std::runtime_error( "Unexpected occupied status " + std::to_string( expected ) );
+    }
+    if ( status == SlotStatus::Abandoned ) {
+      return false;
+    }
+    size_.fetch_add( 1, std::memory_order_relaxed );
+    return true;
+  }
+
 public:
   FixTable( size_t s )
     : data_( s )
   {}
 
-  void insert( const Handle<T> h, V v )
+  // Returns whether h was newly inserted
+  bool insert( const Handle<T> h, V v )
   {
     Hash hash;
-    auto idx = hash( h ) % data_.size();
+    const auto start = hash( h ) % data_.size();
+    auto idx = start;
 
     while ( true ) {
       auto occupied = data_.at( idx ).occupied.load( std::memory_order_acquire );
@@ -96,21 +145,13 @@ public:
         auto empty_slot = find_first_unoccupied( idx );
         data_.at( empty_slot ).h = h;
         data_.at( empty_slot ).v = v;
-
-        uint8_t expected = static_cast<uint8_t>( SlotStatus::Claimed );
-        if ( data_.at( empty_slot )
-               .occupied.compare_exchange_strong(
-                 expected, static_cast<uint8_t>( SlotStatus::Occupied ), std::memory_order_acq_rel ) ) {
-          return;
-        } else {
-          throw std::runtime_error( "Unexpected occupied status " + std::to_string( expected ) );
-        }
+        return publish( h, start, empty_slot );
       }
 
       if ( occupied == static_cast<uint8_t>( SlotStatus::Occupied ) ) {
         KeyEqual eq;
         if ( eq( data_.at( idx ).h, h ) ) {
-          return;
+          return false;
         }
       }
 
@@ -124,7 +165,8 @@ public:
   void insert_no_value( const Handle<T> h )
   {
     Hash hash;
-    auto idx = hash( h ) % data_.size();
+    const auto start = hash( h ) % data_.size();
+    auto idx = start;
 
     while ( true ) {
       auto occupied = data_.at( idx ).occupied.load( std::memory_order_acquire );
@@ -132,15 +174,8 @@ public:
       if ( occupied == static_cast<uint8_t>( SlotStatus::Empty ) ) {
         auto empty_slot = find_first_unoccupied( idx );
         data_.at( empty_slot ).h = h;
-
-        uint8_t expected = static_cast<uint8_t>( SlotStatus::Claimed );
-        if ( data_.at( empty_slot )
-               .occupied.compare_exchange_strong(
-                 expected, static_cast<uint8_t>( SlotStatus::Occupied ), std::memory_order_acq_rel ) ) {
-          return;
-        } else {
-          throw std::runtime_error( "Unexpected occupied status" );
-        }
+        publish( h, start, empty_slot );
+        return;
       }
 
       if ( occupied == static_cast<uint8_t>( SlotStatus::Occupied ) ) {
@@ -159,6 +194,9 @@ public:
 
   bool contains( const Handle<T> h ) const { return get_idx( h ).has_value(); }
 
+  size_t size() const { return size_.load( std::memory_order_relaxed ); }
+  size_t capacity() const { return data_.size(); }
+
   std::optional<V> get( const Handle<T> h ) const
   {
     return get_idx( h ).transform( [&]( auto idx ) { return data_.at( idx ).v; } );
@@ -166,6 +204,17 @@ public:
 
   V& get_ref( const Handle<T> h ) { return data_.at( get_idx( h ).value() ).v; }
 
+  // Calls f on the handle of every occupied slot; entries inserted concurrently may or may not be visited
+  template<typename F>
+  void for_each( F f ) const
+  {
+    for ( const auto& entry : data_ ) {
+      if ( entry.occupied.load( std::memory_order_acquire ) == static_cast<uint8_t>( SlotStatus::Occupied ) ) {
+        f( entry.h );
+      }
+    }
+  }
+
   std::optional<Handle<T>> get_handle( const Handle<T> h ) const
   {
     return get_idx( h ).transform( [&]( auto idx ) { return data_.at( idx ).h; } );
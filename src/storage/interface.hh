@@ -1,6 +1,7 @@
 #pragma once
 
 #include "handle.hh"
+#include "handle_filter.hh"
 #include "handle_util.hh"
 #include "object.hh"
 #include "overload.hh"
@@ -9,7 +10,10 @@
 #include <absl/container/flat_hash_set.h>
 #include <functional>
 #include <glog/logging.h>
+#include <optional>
+#include <span>
 #include <unordered_set>
+#include <vector>
 
 /**
  * A basic Runtime environment, capable of loading/storing Fix data and (if parallelism != 0) discovering new Fix
@@ -24,6 +28,7 @@ public:
   struct Info
   {
     uint32_t parallelism;
+    // Bandwidth to this runtime, in bytes per second
     double link_speed;
   };
 
@@ -63,6 +68,18 @@ public:
   // XXX
   virtual void put_force( Handle<Relation>, Handle<Object> ) {};
 
+  /**
+   * Sends the data named by @p handle to this IRuntime and asks it to pass the data on to @p peers, which in turn
+   * share the forwarding, so that data needed by many runtimes leaves the caller only once.
+   *
+   * @return  Whether this IRuntime took the request; if not, the caller should put the data to each runtime.
+   */
+  virtual bool relay( [[maybe_unused]] Handle<AnyDataType> handle,
+                      [[maybe_unused]] const std::vector<std::shared_ptr<IRuntime>>& peers )
+  {
+    return false;
+  }
+
   /**
    * These functions automatically compute the canonical name of data before storing them.  Implementors may
    * choose to override them to create local names; however, they should ensure there will be no confusion between
@@ -154,6 +171,8 @@ public:
 
   // Return the list of data presening in .fix repository
   virtual std::unordered_set<Handle<AnyDataType>> data() const { return {}; };
+  // Return a summary of data(), kept up to date without rescanning the .fix repository
+  virtual HandleFilter data_filter() const { return {}; }
   // Return the list of forward dependencies
   virtual absl::flat_hash_set<Handle<Dependee>> get_forward_dependencies( Handle<Relation> ) { return {}; }
 };
@@ -162,4 +181,24 @@ class MultiWorkerRuntime : public IRuntime
 {
 public:
   virtual void add_worker( std::shared_ptr<IRuntime> ) = 0;
+
+  // Store a batch of results at once, e.g. received together from a remote
+  virtual void put_results( std::span<const std::pair<Handle<Relation>, Handle<Object>>> results )
+  {
+    for ( const auto& [name, data] : results ) {
+      put( name, data );
+    }
+  }
+
+  // Get a batch of relations at once, e.g. received together from a remote: returns the results already known, in
+  // the order of names, and starts relating the rest
+  virtual std::vector<std::optional<Handle<Object>>> get_relations( std::span<const Handle<Relation>> names )
+  {
+    std::vector<std::optional<Handle<Object>>> results;
+    results.reserve( names.size() );
+    for ( const auto name : names ) {
+      results.push_back( get( name ) );
+    }
+    return results;
+  }
 };
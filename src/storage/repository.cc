@@ -16,15 +16,67 @@ Repository::Repository( std::filesystem::path directory )
   : repo_( find( directory ) )
 {
   VLOG( 1 ) << "using repository " << repo_;
+  refresh();
+}
 
-  for ( auto h : data() ) {
+bool Repository::refresh()
+{
+  const auto existing = data();
+  size_t blobs = 0;
+  absl::flat_hash_set<Handle<AnyTree>, AbslHash, handle::any_tree_equal> trees;
+  size_t relations = 0;
+  for ( auto h : existing ) {
     h.visit<void>( overload {
       []( Handle<Literal> ) {},
-      [&]( Handle<Named> n ) { blobs_.insert( n, true ); },
+      [&]( Handle<Named> n ) {
+        blobs_.insert( n, true );
+        blobs++;
+      },
       [&]( Handle<AnyTree> t ) {
-        trees_.insert( t, filesystem::file_size( repo_ / "data" / base16::encode( handle::fix( t ).content ) ) );
+        if ( not trees_.contains( t ) ) {
+          trees_.insert( t, filesystem::file_size( repo_ / "data" / base16::encode( handle::fix( t ).content ) ) );
+        }
+        trees.insert( t );
       },
-      [&]( Handle<Relation> r ) { relations_.insert( r, true ); } } );
+      [&]( Handle<Relation> r ) {
+        relations_.insert( r, true );
+        relations++;
+      } } );
+  }
+
+  unique_lock lock( filter_mutex_ );
+  rebuild_filter();
+
+  // everything on disk is in the tables now, so any extra entries are gone from disk
+  return blobs_.size() == blobs and trees_.size() == trees.size() and relations_.size() == relations;
+}
+
+void Repository::rebuild_filter()
+{
+  filter_ = HandleFilter( 2 * ( blobs_.size() + trees_.size() + relations_.size() ) );
+  blobs_.for_each( [&]( Handle<Named> h ) { filter_.insert( h ); } );
+  trees_.for_each( [&]( Handle<AnyTree> h ) { filter_.insert( h ); } );
+  relations_.for_each( [&]( Handle<Relation> h ) { filter_.insert( h ); } );
+}
+
+template<typename T>
+void Repository::summarize( Handle<T> handle )
+{
+  const auto entries = [&] { return blobs_.size() + trees_.size() + relations_.size(); };
+  {
+    shared_lock lock( filter_mutex_ );
+    if ( entries() <= filter_.capacity() ) {
+      filter_.insert( handle );
+      return;
+    }
+  }
+
+  // the handle is already in its table, so a rebuild includes it
+  unique_lock lock( filter_mutex_ );
+  if ( entries() > filter_.capacity() ) {
+    rebuild_filter();
+  } else {
+    filter_.insert( handle );
   }
 }
 
@@ -200,6 +252,7 @@ void Repository::put( Handle<Named> name, BlobData data )
     if ( fs::exists( path ) )
       return;
     blobs_.insert( name, true );
+    summarize( name );
     data->to_file( path );
   } catch ( std::filesystem::filesystem_error& ) {
     throw RepositoryCorrupt( repo_ );
@@ -216,6 +269,7 @@ void Repository::put( Handle<AnyTree> name, TreeData data )
     if ( fs::exists( path ) )
       return;
     trees_.insert( name, true );
+    summarize( name );
     data->to_file( path );
   } catch ( std::filesystem::filesystem_error& ) {
     throw RepositoryCorrupt( repo_ );
@@ -239,6 +293,7 @@ void Repository::put( Handle<Relation> relation, Handle<Object> target )
       return;
     VLOG( 2 ) << "linking to " << target.content;
     relations_.insert( relation, true );
+    summarize( relation );
     fs::create_symlink( "../data/" + base16::encode( target.content ), path );
   } catch ( std::filesystem::filesystem_error& ) {
     throw RepositoryCorrupt( repo_ );
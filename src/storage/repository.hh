@@ -1,6 +1,7 @@
 #pragma once
 #include <absl/container/flat_hash_set.h>
 #include <filesystem>
+#include <shared_mutex>
 #include <unordered_map>
 #include <unordered_set>
 
@@ -18,11 +19,29 @@ class Repository : public IRuntime
   FixTable<AnyTree, size_t, AbslHash, handle::any_tree_equal> trees_ { 1000000 };
   FixTable<Relation, bool, AbslHash> relations_ { 1000000 };
 
+  // A summary of the tables above. Inserting takes the mutex shared; when the tables outgrow the filter, it is
+  // rebuilt at twice their size under the exclusive lock, so its false-positive rate stays near the intended 1%.
+  mutable std::shared_mutex filter_mutex_ {};
+  HandleFilter filter_ {};
+
+  template<typename T>
+  void summarize( Handle<T> handle );
+  void rebuild_filter();
+
 public:
   Repository( std::filesystem::path directory = std::filesystem::current_path() );
   static std::filesystem::path find( std::filesystem::path directory = std::filesystem::current_path() );
+  // Rescans the directory for data other processes have added since. Returns false if entries it knew of have been
+  // removed since, e.g. by `fix gc`: the tables only grow, so it would still claim to contain them, and the caller
+  // should open a new Repository instead.
+  bool refresh();
 
   std::unordered_set<Handle<AnyDataType>> data() const override;
+  HandleFilter data_filter() const override
+  {
+    std::shared_lock lock( filter_mutex_ );
+    return filter_;
+  }
   std::unordered_set<Handle<Relation>> relations() const;
   std::unordered_set<std::string> labels() const;
   std::unordered_map<Handle<Fix>, std::unordered_set<Handle<Fix>>> pins() const;
@@ -14,12 +14,23 @@
 
 using namespace std;
 
+// Static data borrows its memory, e.g. from the parent of a slice, which is counted on its own
+template<typename T>
+static size_t owned_bytes( const T& data )
+{
+  return data->allocation_type() == AllocationType::Static ? 0 : data->span().size_bytes();
+}
+
 Handle<Blob> RuntimeStorage::create( BlobData blob, std::optional<Handle<Blob>> name )
 {
   auto handle = name.or_else( [&] -> decltype( name ) { return handle::create( blob ); } ).value();
   handle.visit<void>( overload {
     [&]( Handle<Literal> ) {},
-    [&]( Handle<Named> name ) { blobs_.insert( name, blob ); },
+    [&]( Handle<Named> name ) {
+      if ( blobs_.insert( name, blob ) ) {
+        resident_bytes_ += owned_bytes( blob );
+      }
+    },
   } );
   return handle;
 }
@@ -27,14 +38,18 @@ Handle<Blob> RuntimeStorage::create( BlobData blob, std::optional<Handle<Blob>>
 Handle<AnyTree> RuntimeStorage::create( TreeData tree, std::optional<Handle<AnyTree>> name )
 {
   auto handle = name.or_else( [&] -> decltype( name ) { return handle::create( tree ); } ).value();
-  trees_.insert( handle, tree );
+  if ( trees_.insert( handle, tree ) ) {
+    resident_bytes_ += owned_bytes( tree );
+  }
   return handle;
 }
 
 Handle<AnyTree> RuntimeStorage::create_tree_shallow( TreeData tree, std::optional<Handle<AnyTree>> name )
 {
   auto handle = name.or_else( [&] -> decltype( name ) { return handle::create( tree ); } ).value();
-  tree_refs_.insert( handle, tree );
+  if ( tree_refs_.insert( handle, tree ) ) {
+    resident_bytes_ += owned_bytes( tree );
+  }
   return handle;
 }
 
@@ -128,7 +143,9 @@ TreeData RuntimeStorage::get_shallow( Handle<AnyTree> handle )
         t = make_shared<OwnedTree>( std::move( newtree.value() ) );
       }
 
-      tree_refs_.insert( handle, t.value() );
+      if ( tree_refs_.insert( handle, t.value() ) ) {
+        resident_bytes_ += owned_bytes( t.value() );
+      }
     }
     return t;
   } );
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <absl/container/flat_hash_set.h>
+#include <array>
+#include <atomic>
 #include <stdio.h>
 #include <string>
 #include <string_view>
@@ -47,9 +49,31 @@ private:
   SharedMutex<PinMap> pins_ {};
   SharedMutex<LabelMap> labels_ {};
 
+  std::atomic<size_t> resident_bytes_ { 0 };
+
 public:
   RuntimeStorage() {}
 
+  struct TableOccupancy
+  {
+    const char* table;
+    size_t size;
+    size_t capacity;
+  };
+
+  // Entries in each table, without blocking concurrent inserts
+  std::array<TableOccupancy, 4> occupancy() const
+  {
+    return { { { "blobs", blobs_.size(), blobs_.capacity() },
+               { "trees", trees_.size(), trees_.capacity() },
+               { "tree_refs", tree_refs_.size(), tree_refs_.capacity() },
+               { "relations", relations_.size(), relations_.capacity() } } };
+  }
+
+  // Bytes of Blob and Tree data held, each piece counted once. Data borrowing memory it does not own, e.g. a slice
+  // of another Blob or Tree, is not counted.
+  size_t resident_bytes() const { return resident_bytes_.load( std::memory_order_relaxed ); }
+
   // Construct a Blob by taking ownership of a memory region
   Handle<Blob> create( BlobData blob, std::optional<Handle<Blob>> name = {} );
 
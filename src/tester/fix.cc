@@ -1,13 +1,24 @@
 #include <cstdlib>
 #include <format>
+#include <fstream>
 #include <functional>
 #include <iostream>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iterator>
 #include <map>
+#include <mutex>
 #include <set>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_set>
 #include <utility>
 extern "C" {
 #include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 }
 
 #include <glog/logging.h>
@@ -15,29 +26,261 @@ extern "C" {
 #include "option-parser.hh"
 
 #include "base16.hh"
+#include "channel.hh"
+#include "exception.hh"
+#include "mutex.hh"
 #include "object.hh"
 #include "overload.hh"
+#include "profiler.hh"
 #include "repository.hh"
 #include "runtimes.hh"
+#include "sampler.hh"
+#include "socket.hh"
 #include "storage_exception.hh"
 #include "tester-utils.hh"
+#include "timer.hh"
+#include "trace.hh"
+#include "trace_analysis.hh"
 
 using namespace std;
 
 extern map<string, pair<function<void( int, char*[] )>, const char*>> commands;
 
 namespace blob {
+/**
+ * Imports a directory tree in the layout flatware reads (see applications/flatware/filesys.h): each entry is a
+ * Tree of its name, its permissions and its content, which is a Blob for a file and a Tree of entries for a
+ * directory. Directories are listed and files hashed and written by a pool of threads; a directory's Tree is made
+ * by whichever thread finishes its last entry, so the import completes bottom-up.
+ */
+class DirectoryImport
+{
+  static constexpr size_t DIRENT_NAME = 0;
+  static constexpr size_t DIRENT_PERMISSIONS = 1;
+  static constexpr size_t DIRENT_CONTENT = 2;
+
+  struct Directory
+  {
+    std::filesystem::path path {};
+    std::string name {};
+    // Null for the root
+    std::shared_ptr<Directory> parent {};
+    size_t index {};
+    std::vector<Handle<Fix>> entries {};
+    std::atomic<size_t> remaining {};
+  };
+
+  Repository& repository_;
+  Channel<std::function<void()>> tasks_ {};
+  std::vector<std::thread> threads_ {};
+  // Data some thread has taken on writing, so identical files are written once
+  SharedMutex<std::unordered_set<Handle<Fix>>> claimed_ {};
+
+  std::mutex mutex_ {};
+  std::condition_variable done_ {};
+  std::optional<Handle<Fix>> root_ {};
+  std::exception_ptr error_ {};
+
+public:
+  std::atomic<size_t> files { 0 };
+  // Files whose content the repository already held
+  std::atomic<size_t> present { 0 };
+
+private:
+  // Writes data unless the repository or another thread already has it. Returns whether the repository held it.
+  template<typename T, typename Data>
+  bool store( Handle<Fix> key, Handle<T> handle, Data data )
+  {
+    if ( repository_.contains( handle ) ) {
+      return true;
+    }
+    if ( claimed_.write()->insert( key ).second ) {
+      repository_.put( handle, data );
+    }
+    return false;
+  }
+
+  // The handle of data, and whether the repository already held it
+  pair<Handle<Fix>, bool> blob( BlobData data )
+  {
+    auto handle = handle::create( data );
+    bool held = false;
+    handle.visit<void>( overload {
+      [&]( Handle<Named> name ) { held = store( name, name, data ); },
+      []( Handle<Literal> ) {},
+    } );
+    return { handle::fix( handle ), held };
+  }
+
+  Handle<Fix> dirent( string_view name, string_view permissions, Handle<Fix> content )
+  {
+    auto entry = OwnedMutTree::allocate( 3 );
+    entry[DIRENT_NAME]
+      = blob( make_shared<OwnedBlob>( span { name.data(), name.size() }, AllocationType::Static ) ).first;
+    entry[DIRENT_PERMISSIONS]
+      = blob( make_shared<OwnedBlob>( span { permissions.data(), permissions.size() }, AllocationType::Static ) )
+          .first;
+    entry[DIRENT_CONTENT] = content;
+    return tree( std::move( entry ) );
+  }
+
+  Handle<Fix> tree( OwnedMutTree&& entries )
+  {
+    TreeData data = make_shared<OwnedTree>( std::move( entries ) );
+    const auto handle = handle::create( data );
+    store( handle::fix( handle ), handle, data );
+    return handle::fix( handle );
+  }
+
+  void visit( shared_ptr<Directory> directory )
+  {
+    // Sorted, so the same tree always gets the same name
+    vector<std::filesystem::directory_entry> entries;
+    for ( const auto& entry : std::filesystem::directory_iterator( directory->path ) ) {
+      if ( entry.is_directory() and not entry.is_symlink() ) {
+        entries.push_back( entry );
+      } else if ( entry.is_regular_file() and not entry.is_symlink() ) {
+        entries.push_back( entry );
+      } else {
+        cerr << "Warning: skipping " << entry.path() << ", which is neither a file nor a directory.\n";
+      }
+    }
+    sort( entries.begin(), entries.end() );
+
+    directory->entries.resize( entries.size() );
+    directory->remaining = entries.size();
+    if ( entries.empty() ) {
+      complete( directory );
+      return;
+    }
+
+    for ( size_t i = 0; i < entries.size(); i++ ) {
+      const auto path = entries[i].path();
+      if ( entries[i].is_directory() ) {
+        auto child = make_shared<Directory>();
+        child->path = path;
+        child->name = path.filename().string();
+        child->parent = directory;
+        child->index = i;
+        tasks_.move_push( [this, child] { visit( child ); } );
+      } else {
+        tasks_.move_push( [this, directory, i, path] { add_file( directory, i, path ); } );
+      }
+    }
+  }
+
+  void add_file( shared_ptr<Directory> directory, size_t index, const std::filesystem::path& path )
+  {
+    // Mapped rather than read; an empty file cannot be mapped
+    auto data = std::filesystem::file_size( path ) == 0
+                  ? make_shared<OwnedBlob>( span<const char> {}, AllocationType::Static )
+                  : make_shared<OwnedBlob>( path );
+    const auto [content, held] = blob( data );
+    files++;
+    if ( held ) {
+      present++;
+    }
+
+    const auto permissions = std::filesystem::status( path ).permissions();
+    const bool executable = ( permissions & std::filesystem::perms::owner_exec ) != std::filesystem::perms::none;
+    finish( directory, index, dirent( path.filename().string(), executable ? "100755" : "100644", content ) );
+  }
+
+  void finish( shared_ptr<Directory> directory, size_t index, Handle<Fix> entry )
+  {
+    directory->entries[index] = entry;
+    if ( directory->remaining.fetch_sub( 1, memory_order_acq_rel ) == 1 ) {
+      complete( directory );
+    }
+  }
+
+  void complete( shared_ptr<Directory> directory )
+  {
+    auto entries = OwnedMutTree::allocate( directory->entries.size() );
+    for ( size_t i = 0; i < directory->entries.size(); i++ ) {
+      entries[i] = directory->entries[i];
+    }
+    const auto entry = dirent( directory->name, "040000", tree( std::move( entries ) ) );
+
+    if ( directory->parent ) {
+      finish( directory->parent, directory->index, entry );
+    } else {
+      unique_lock lock( mutex_ );
+      root_ = entry;
+      done_.notify_all();
+    }
+  }
+
+  void work()
+  {
+    while ( true ) {
+      std::function<void()> task;
+      try {
+        tasks_ >> task;
+      } catch ( const ChannelClosed& ) {
+        return;
+      }
+
+      try {
+        task();
+      } catch ( ... ) {
+        unique_lock lock( mutex_ );
+        if ( not error_ ) {
+          error_ = current_exception();
+        }
+        done_.notify_all();
+      }
+    }
+  }
+
+public:
+  explicit DirectoryImport( Repository& repository )
+    : repository_( repository )
+  {}
+
+  // The entry of the directory at path, named "." as flatware expects of the root
+  Handle<Fix> run( const std::filesystem::path& path, size_t threads = std::thread::hardware_concurrency() )
+  {
+    auto root = make_shared<Directory>();
+    root->path = path;
+    root->name = ".";
+    tasks_.move_push( [this, root] { visit( root ); } );
+
+    for ( size_t i = 0; i < max<size_t>( threads, 1 ); i++ ) {
+      threads_.emplace_back( [this] { work(); } );
+    }
+    {
+      unique_lock lock( mutex_ );
+      done_.wait( lock, [&] { return root_.has_value() or error_; } );
+    }
+    tasks_.close();
+    for ( auto& thread : threads_ ) {
+      thread.join();
+    }
+
+    if ( error_ ) {
+      rethrow_exception( error_ );
+    }
+    return *root_;
+  }
+};
+
 void add( int argc, char* argv[] )
 {
   OptionParser parser( "add-blob", commands["add-blob"].second );
   const char* filename = NULL;
   std::optional<const char*> label;
+  bool recursive = false;
   parser.AddArgument(
     "filename", OptionParser::ArgumentCount::One, [&]( const char* argument ) { filename = argument; } );
   parser.AddOption(
     'l', "label", "label", "Assign a human-readable name to this Blob.", [&]( const char* argument ) {
       label = argument;
     } );
+  parser.AddOption( 'r',
+                    "recursive",
+                    "Add a directory and everything in it, as the Tree flatware reads a file system from.",
+                    [&] { recursive = true; } );
   parser.Parse( argc, argv );
   if ( !filename )
     exit( EXIT_FAILURE );
@@ -49,6 +292,33 @@ void add( int argc, char* argv[] )
 
   Repository storage;
 
+  if ( std::filesystem::is_directory( filename ) ) {
+    if ( not recursive ) {
+      cerr << "Error: \"" << filename << "\" is a directory (use -r to add it).\n";
+      exit( EXIT_FAILURE );
+    }
+
+    try {
+      DirectoryImport import( storage );
+      Handle<Fix> handle = import.run( filename );
+      if ( label )
+        storage.label( *label, handle );
+      cout << handle.content << endl;
+      cerr << "Added " << import.files << " files, " << import.present << " of them already in the repository.\n";
+    } catch ( const std::filesystem::filesystem_error& e ) {
+      cerr << "Error: unable to add " << std::filesystem::path( filename ) << ":\n\t" << e.what() << "\n";
+      exit( EXIT_FAILURE );
+    } catch ( const unix_error& e ) {
+      // e.g. a file that could not be opened or mapped
+      cerr << "Error: unable to add " << std::filesystem::path( filename ) << ":\n\t" << e.what() << "\n";
+      exit( EXIT_FAILURE );
+    } catch ( const RepositoryCorrupt& e ) {
+      cerr << "Error: " << e.what() << "\n";
+      exit( EXIT_FAILURE );
+    }
+    return;
+  }
+
   try {
     Handle<Fix> handle = storage.create( std::make_shared<OwnedBlob>( filename ) );
     if ( label )
@@ -57,6 +327,9 @@ void add( int argc, char* argv[] )
   } catch ( std::filesystem::filesystem_error& e ) {
     cerr << "Error: unable to open file " << std::filesystem::path( filename ) << ":\n\t" << e.what() << "\n";
     exit( EXIT_FAILURE );
+  } catch ( const unix_error& e ) {
+    cerr << "Error: unable to open file " << std::filesystem::path( filename ) << ":\n\t" << e.what() << "\n";
+    exit( EXIT_FAILURE );
   }
 }
 
@@ -399,24 +672,421 @@ void label( int argc, char* argv[] )
   storage.label( new_label, handle );
 }
 
+namespace daemon_ {
+// `fix daemon` listens on a socket in the repository, so only those who can write to it can use it
+Address address( const std::filesystem::path& repo )
+{
+  const string path = ( repo / "daemon.sock" ).string();
+  sockaddr_un address {};
+  address.sun_family = AF_UNIX;
+  if ( path.size() >= sizeof( address.sun_path ) ) {
+    throw runtime_error( "path of the daemon socket is too long: " + path );
+  }
+  path.copy( address.sun_path, sizeof( address.sun_path ) - 1 );
+  return { reinterpret_cast<const sockaddr*>( &address ), offsetof( sockaddr_un, sun_path ) + path.size() + 1 };
+}
+
+optional<LocalStreamSocket> connect( const std::filesystem::path& repo )
+{
+  if ( not std::filesystem::exists( repo / "daemon.sock" ) ) {
+    return {};
+  }
+
+  try {
+    LocalStreamSocket socket;
+    socket.connect( address( repo ) );
+    return socket;
+  } catch ( const exception& ) {
+    // Left behind by a daemon that has exited
+    return {};
+  }
+}
+
+string read_all( FileDescriptor& fd )
+{
+  string contents;
+  char buffer[65536];
+  while ( not fd.eof() ) {
+    contents.append( buffer, fd.read( buffer ) );
+  }
+  return contents;
+}
+
+void write_all( FileDescriptor& fd, string_view data )
+{
+  while ( not data.empty() ) {
+    data.remove_prefix( fd.write( data ) );
+  }
+}
+
+// Changes whenever data or relations are added to the repository, by the daemon or anyone else
+pair<std::filesystem::file_time_type, std::filesystem::file_time_type> version( const std::filesystem::path& repo )
+{
+  return { std::filesystem::last_write_time( repo / "data" ),
+           std::filesystem::last_write_time( repo / "relations" ) };
+}
+
+// Sends the entries of `fix eval` to a running daemon and prints its reply. Files are named relative to this
+// directory, which the daemon does not share. Returns the exit status.
+int forward_eval( LocalStreamSocket& daemon, span<char*> args )
+{
+  string request;
+  for ( const string_view arg : args ) {
+    if ( arg.starts_with( "file:" ) ) {
+      request += "file:" + std::filesystem::absolute( arg.substr( 5 ) ).string();
+    } else {
+      request += arg;
+    }
+    request.push_back( '\0' );
+  }
+  write_all( daemon, request );
+  daemon.shutdown( SHUT_WR );
+
+  // A status byte, and what `fix eval` would have printed
+  const string reply = read_all( daemon );
+  if ( reply.empty() ) {
+    cerr << "Error: the daemon closed the connection.\n";
+    return EXIT_FAILURE;
+  }
+  ( reply[0] == '0' ? cout : cerr ) << string_view( reply ).substr( 1 );
+  return reply[0] == '0' ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+string serve_eval( ReadWriteRT& rt, const string& request )
+{
+  // forward_eval terminates every entry, so anything after the last terminator is a truncated request
+  vector<char*> entries;
+  for ( size_t begin = 0; begin < request.size(); ) {
+    const size_t end = request.find( '\0', begin );
+    if ( end == string::npos ) {
+      return "1Error: the last entry is not terminated.\n";
+    }
+    entries.push_back( const_cast<char*>( request.data() + begin ) );
+    begin = end + 1;
+  }
+  if ( entries.empty() ) {
+    return "1Error: no entries to evaluate.\n";
+  }
+
+  try {
+    span<char*> args = entries;
+    auto handle = handle::extract<Object>( parse_args( rt.get_rt(), args ) );
+    if ( !handle.has_value() ) {
+      return "1Handle is not an Object";
+    }
+    ostringstream out;
+    out << "0" << rt.execute( Handle<Eval>( *handle ) ).content << endl;
+    return out.str();
+  } catch ( const exception& e ) {
+    return "1Error: " + string( e.what() ) + "\n";
+  }
+}
+
+void run( int argc, char* argv[] )
+{
+  OptionParser parser( "daemon", commands["daemon"].second );
+  parser.Parse( argc, argv );
+
+  const auto repo = Repository::find();
+  if ( connect( repo ) ) {
+    cerr << "Error: a daemon is already serving " << repo << ".\n";
+    exit( EXIT_FAILURE );
+  }
+  std::filesystem::remove( repo / "daemon.sock" );
+
+  auto rt = ReadWriteRT::init();
+  LocalStreamSocket server;
+  server.bind( address( repo ) );
+  server.listen();
+  cout << "Serving " << repo << "." << endl;
+
+  // Each connection gets its own thread, so a client that stalls only holds up itself. The evaluations still run
+  // one at a time, as the Relater runs one top-level job at a time.
+  mutex eval_mutex;
+  auto seen = version( repo );
+  const auto serve = [&]( LocalStreamSocket connection ) {
+    try {
+      connection.set_timeout( chrono::seconds( 10 ) );
+      const string request = read_all( connection );
+
+      string reply;
+      {
+        unique_lock lock( eval_mutex );
+        // Taken before refreshing, so whatever others add from here on is picked up by the next request
+        const auto current = version( repo );
+        if ( current != seen and not rt->get_rt().get_repository().refresh() ) {
+          // Something was deleted, e.g. by `fix gc`, which the runtime cannot forget
+          LOG( INFO ) << "Data was removed from " << repo << ", restarting the runtime";
+          rt = ReadWriteRT::init();
+        }
+        seen = current;
+        reply = serve_eval( *rt, request );
+      }
+
+      write_all( connection, reply );
+    } catch ( const exception& e ) {
+      LOG( WARNING ) << "Could not serve fix eval: " << e.what();
+    }
+  };
+
+  while ( true ) {
+    try {
+      thread( serve, server.accept() ).detach();
+    } catch ( const exception& e ) {
+      // e.g. interrupted by a signal, or out of descriptors until some connections finish
+      LOG( WARNING ) << "Could not accept a connection: " << e.what();
+      this_thread::sleep_for( chrono::milliseconds( 10 ) );
+    }
+  }
+}
+}
+
+namespace batch {
+struct Job
+{
+  std::vector<Handle<Object>> expressions {};
+  // The line each expression was read from
+  std::vector<size_t> lines {};
+};
+
+// One expression per line, in the syntax of `fix eval`; blank lines and lines starting with # are skipped
+Job parse( IRuntime& rt, istream& input )
+{
+  Job job;
+  string line;
+  for ( size_t number = 1; getline( input, line ); number++ ) {
+    istringstream words( line );
+    vector<string> entries { istream_iterator<string>( words ), istream_iterator<string>() };
+    if ( entries.empty() or entries.front().starts_with( "#" ) ) {
+      continue;
+    }
+
+    vector<char*> pointers;
+    for ( auto& entry : entries ) {
+      pointers.push_back( entry.data() );
+    }
+    span<char*> args = pointers;
+    try {
+      auto handle = handle::extract<Object>( parse_args( rt, args ) );
+      if ( !handle.has_value() or !args.empty() ) {
+        throw runtime_error( "not a single Object" );
+      }
+      job.expressions.push_back( *handle );
+      job.lines.push_back( number );
+    } catch ( const exception& e ) {
+      throw runtime_error( "line " + to_string( number ) + ": " + e.what() );
+    }
+  }
+  return job;
+}
+
+// Evaluates the whole batch as one job, so the runtime schedules all of it at once, and prints each result as
+// "<line>\t<handle>" as soon as it is known
+void run( ReadOnlyRT& rt, const Job& job )
+{
+  if ( job.expressions.empty() ) {
+    return;
+  }
+
+  // Owned by the callback too, since a runtime thread may still be in it after it is replaced
+  struct Results
+  {
+    std::mutex mutex {};
+    unordered_map<Handle<Relation>, vector<size_t>> pending {};
+    vector<size_t> lines {};
+
+    void print( const vector<size_t>& indices, Handle<Value> result )
+    {
+      for ( const auto i : indices ) {
+        cout << lines[i] << "\t" << result.content << "\n";
+      }
+      cout << flush;
+    }
+  };
+  auto results = make_shared<Results>();
+  results->lines = job.lines;
+  for ( size_t i = 0; i < job.expressions.size(); i++ ) {
+    results->pending[Handle<Eval>( job.expressions[i] )].push_back( i );
+  }
+
+  rt.get_rt().on_result( [results]( Handle<Relation> name, Handle<Object> result ) {
+    unique_lock lock( results->mutex );
+    if ( auto entry = results->pending.find( name ); entry != results->pending.end() ) {
+      results->print( entry->second, result.unwrap<Value>() );
+      results->pending.erase( entry );
+    }
+  } );
+
+  auto tree = OwnedMutTree::allocate( job.expressions.size() );
+  for ( size_t i = 0; i < job.expressions.size(); i++ ) {
+    tree[i] = job.expressions[i];
+  }
+  auto all = rt.get_rt().create( make_shared<OwnedTree>( std::move( tree ) ) ).visit<Handle<ObjectTree>>( overload {
+    []( Handle<ValueTree> t ) { return Handle<ObjectTree>( t ); },
+    []( Handle<ObjectTree> t ) { return t; },
+    []( Handle<ExpressionTree> ) -> Handle<ObjectTree> { throw runtime_error( "Unreachable" ); },
+  } );
+  const auto values = handle::extract<ValueTree>( rt.execute( Handle<Eval>( Handle<Object>( all ) ) ) ).value();
+  rt.get_rt().on_result( {} );
+
+  // Results the runtime already knew, which it never had to relate
+  const auto data = rt.get_rt().get( values ).value();
+  unique_lock lock( results->mutex );
+  for ( const auto& [name, indices] : results->pending ) {
+    results->print( indices, handle::extract<Value>( data->at( indices.front() ) ).value() );
+  }
+  results->pending.clear();
+}
+}
+
 void eval( int argc, char* argv[] )
 {
-  if ( argc == 0 or string( argv[1] ) == "--help" ) {
+  if ( argc <= 1 or string( argv[1] ) == "--help" ) {
     parser_usage_message();
+    cerr << "Options (before the first entry):\n";
+    cerr << "   --profile            print a per-procedure execution profile to stderr\n";
+    cerr << "   --profile-counters   also profile instructions and LLC misses with perf_event_open\n";
+    cerr << "   --sample             sample guest functions on SIGPROF and print them to stderr\n";
+    cerr << "   --perf-map           write guest function symbols to /tmp/perf-<pid>.map\n";
+    cerr << "   --trace=FILE         write a timeline of task events to FILE as Chrome trace-event JSON\n";
+    cerr << "   --local              evaluate in this process even if `fix daemon` is running\n";
+    cerr << "   --batch=FILE         evaluate one expression per line of FILE (- for stdin) together, printing\n";
+    cerr << "                        \"<line>\\t<result>\" for each as it completes\n";
+    cerr << "   --save               with --batch, write every result to the repository in one pass at the end\n";
     exit( EXIT_FAILURE );
   }
 
-  auto rt = ReadWriteRT::init();
-  span<char*> args = { argv + 1, static_cast<size_t>( argc ) - 1 };
-  auto handle = parse_args( rt->get_rt(), args );
+  int first = 1;
+  bool profile = false;
+  bool sample = false;
+  optional<string> trace_path;
+  // Profiling and tracing observe this process, so they keep the evaluation in it
+  bool local = false;
+  optional<string> batch_path;
+  bool save = false;
+  for ( ; first < argc; first++ ) {
+    if ( string( argv[first] ) == "--profile" ) {
+      global_profiler().enable();
+      profile = true;
+      local = true;
+    } else if ( string( argv[first] ) == "--profile-counters" ) {
+      global_profiler().enable( true );
+      profile = true;
+      local = true;
+    } else if ( string( argv[first] ) == "--sample" ) {
+      sample = true;
+      local = true;
+    } else if ( string( argv[first] ) == "--perf-map" ) {
+      guest_symbols::enable_perf_map();
+      local = true;
+    } else if ( string_view( argv[first] ).starts_with( "--trace=" ) ) {
+      trace_path = string( argv[first] ).substr( strlen( "--trace=" ) );
+      global_tracer().enable();
+      local = true;
+    } else if ( string( argv[first] ) == "--local" ) {
+      local = true;
+    } else if ( string_view( argv[first] ).starts_with( "--batch=" ) ) {
+      batch_path = string( argv[first] ).substr( strlen( "--batch=" ) );
+      local = true;
+    } else if ( string( argv[first] ) == "--save" ) {
+      save = true;
+    } else {
+      break;
+    }
+  }
+
+  if ( save and not batch_path ) {
+    cerr << "Error: --save only applies to --batch (a single fix eval always saves its result).\n";
+    exit( EXIT_FAILURE );
+  }
+
+  span<char*> args = { argv + first, static_cast<size_t>( argc - first ) };
+  if ( not local ) {
+    if ( auto daemon = daemon_::connect( Repository::find() ) ) {
+      exit( daemon_::forward_eval( *daemon, args ) );
+    }
+  }
+
+  if ( batch_path ) {
+    shared_ptr<ReadOnlyRT> rt = save ? ReadWriteRT::init() : ReadOnlyRT::init();
+    ifstream file;
+    if ( *batch_path != "-" ) {
+      file.open( *batch_path );
+      if ( !file ) {
+        cerr << "Error: could not open " << *batch_path << "\n";
+        exit( EXIT_FAILURE );
+      }
+    }
+    const auto job = batch::parse( rt->get_rt(), *batch_path == "-" ? cin : file );
+
+    if ( sample ) {
+      global_sampler().start();
+    }
+    batch::run( *rt, job );
+  } else {
+    auto rt = ReadWriteRT::init();
+    auto handle = parse_args( rt->get_rt(), args );
+
+    if ( !handle::extract<Object>( handle ).has_value() ) {
+      cerr << "Handle is not an Object";
+      exit( EXIT_FAILURE );
+    }
+
+    if ( sample ) {
+      global_sampler().start();
+    }
+
+    auto res = rt->execute( Handle<Eval>( handle::extract<Object>( handle ).value() ) );
+    cout << res.content << endl;
+  }
+
+  if ( profile ) {
+    global_profiler().summary( cerr );
+  }
+#ifdef TIME_FIXPOINT
+  global_timer_summary( cerr );
+#endif
+  if ( trace_path ) {
+    global_tracer().disable();
+    ofstream trace_file( *trace_path );
+    global_tracer().write_json( trace_file );
+  }
+  if ( sample ) {
+    global_sampler().stop();
+    global_sampler().summary( cerr );
+  }
+}
+
+void analyze( int argc, char* argv[] )
+{
+  OptionParser parser( "analyze", commands["analyze"].second );
+  const char* trace_path = NULL;
+  size_t top = 10;
+  size_t buckets = 20;
+  parser.AddOption( 'n',
+                    "top",
+                    "count",
+                    "Number of procedures and transfers to list (default 10).",
+                    [&]( const char* argument ) { top = stoul( argument ); } );
+  parser.AddOption( 'b',
+                    "buckets",
+                    "count",
+                    "Number of slices in the parallelism profile (default 20).",
+                    [&]( const char* argument ) { buckets = stoul( argument ); } );
+  parser.AddArgument(
+    "trace", OptionParser::ArgumentCount::One, [&]( const char* argument ) { trace_path = argument; } );
+  parser.Parse( argc, argv );
+  if ( !trace_path )
+    exit( EXIT_FAILURE );
 
-  if ( !handle::extract<Object>( handle ).has_value() ) {
-    cerr << "Handle is not an Object";
+  ifstream trace_file( trace_path );
+  if ( !trace_file ) {
+    cerr << "Error: could not open " << trace_path << "\n";
     exit( EXIT_FAILURE );
   }
 
-  auto res = rt->execute( Handle<Eval>( handle::extract<Object>( handle ).value() ) );
-  cout << res.content << endl;
+  TraceAnalysis analysis( trace_file );
+  analysis.report( cout, top, buckets );
 }
 
 void init( int, char*[] )
@@ -505,12 +1175,14 @@ void ref_( int argc, char* argv[] )
 }
 
 map<string, pair<function<void( int, char*[] )>, const char*>> commands = {
-  { "add", { blob::add, "Add a file to the Fix repository as a Blob." } },
+  { "add", { blob::add, "Add a file (or with -r, a directory) to the Fix repository." } },
   { "add-blob", { blob::add, "Add a file to the Fix repository as a Blob." } },
+  { "analyze", { analyze, "Find the critical path of a trace written by `fix eval --trace`." } },
   { "cat-blob", { blob::cat, "Print out a Blob." } },
   { "cat-tree", { tree::cat, "Output the contents of a Tree." } },
   { "create-blob", { blob::create, "Create a new Blob." } },
   { "create-tree", { tree::create, "Construct a new Tree." } },
+  { "daemon", { daemon_::run, "Keep a runtime warm for `fix eval` in this repository to forward to." } },
   { "decode", { decode, "Decode a Handle." } },
   { "gc", { gc, "Garbage-collect any data not referenced by a label." } },
   { "help", { help, "Print a list of sub-commands." } },
@@ -1,14 +1,23 @@
+#include <csignal>
+#include <fstream>
 #include <iostream>
 #include <stdexcept>
 extern "C" {
 #include <sys/resource.h>
 }
 #include <memory>
+#include <sstream>
+#include <thread>
 
+#include "eventloop.hh"
 #include "mmap.hh"
 #include "option-parser.hh"
+#include "profiler.hh"
 #include "runtimes.hh"
+#include "sampler.hh"
 #include "scheduler.hh"
+#include "trace.hh"
+#include "web_server.hh"
 
 using namespace std;
 
@@ -47,6 +56,12 @@ int main( int argc, char* argv[] )
   optional<const char*> local;
   optional<const char*> peerfile;
   optional<string> sche_opt;
+  size_t network_threads = 1;
+  bool profile = false;
+  bool sample = false;
+  optional<string> trace_path;
+  optional<uint16_t> metrics_port;
+  uint64_t rate_limit = 0;
   parser.AddArgument(
     "listening-port", OptionParser::ArgumentCount::One, [&]( const char* argument ) { port = stoi( argument ); } );
   parser.AddOption( 'a',
@@ -66,8 +81,77 @@ int main( int argc, char* argv[] )
         throw runtime_error( "Invalid scheduler: " + sche_opt.value() );
       }
     } );
+  parser.AddOption( 'n',
+                    "network-threads",
+                    "threads",
+                    "Number of threads serving network connections (default 1).",
+                    [&]( const char* argument ) { network_threads = stoul( argument ); } );
+  parser.AddOption( 'P', "profile", "Record a per-procedure execution profile, printed on SIGUSR1.", [&] {
+    global_profiler().enable();
+    profile = true;
+  } );
+  parser.AddOption( 'C',
+                    "profile-counters",
+                    "Like --profile, but also record instructions and LLC misses with perf_event_open.",
+                    [&] {
+                      global_profiler().enable( true );
+                      profile = true;
+                    } );
+  parser.AddOption( 'S', "sample", "Sample guest functions on SIGPROF, printed on SIGUSR1.", [&] { sample = true; } );
+  parser.AddOption( 'T',
+                    "trace",
+                    "file",
+                    "Record a timeline of task events, written to <file> as Chrome trace-event JSON on SIGUSR1.",
+                    [&]( const char* argument ) {
+                      trace_path = argument;
+                      global_tracer().enable();
+                    } );
+  parser.AddOption( 'M', "perf-map", "Write guest function symbols to /tmp/perf-<pid>.map.", [&] {
+    guest_symbols::enable_perf_map();
+  } );
+  parser.AddOption( 'm',
+                    "metrics-port",
+                    "port",
+                    "Serve runtime metrics in the Prometheus text format at /metrics on <port>.",
+                    [&]( const char* argument ) { metrics_port = stoi( argument ); } );
+  parser.AddOption( 'r',
+                    "rate-limit",
+                    "mbps",
+                    "Send at most <mbps> megabits per second to each peer, to emulate a slower network.",
+                    [&]( const char* argument ) { rate_limit = stoull( argument ) * 1000 * 1000 / 8; } );
   parser.Parse( argc, argv );
 
+  if ( sample ) {
+    global_sampler().start();
+  }
+
+  if ( profile or sample or trace_path ) {
+    // Block SIGUSR1 before any other thread starts, and wait for it on a dedicated thread, so the report is not
+    // written from a signal handler.
+    sigset_t signals;
+    sigemptyset( &signals );
+    sigaddset( &signals, SIGUSR1 );
+    pthread_sigmask( SIG_BLOCK, &signals, nullptr );
+    thread( [signals, profile, sample, trace_path] {
+      int received;
+      while ( sigwait( &signals, &received ) == 0 ) {
+        if ( profile ) {
+          global_profiler().summary( cerr );
+        }
+        if ( sample ) {
+          global_sampler().summary( cerr );
+        }
+        if ( trace_path ) {
+          // Recording carries on afterwards, so each signal writes the latest events
+          global_tracer().disable();
+          ofstream trace_file( *trace_path );
+          global_tracer().write_json( trace_file );
+          global_tracer().enable();
+        }
+      }
+    } ).detach();
+  }
+
   Address listen_address( "0.0.0.0", port );
   vector<Address> peer_address;
 
@@ -106,9 +190,35 @@ int main( int argc, char* argv[] )
     }
   }
 
-  auto server = Server::init( listen_address, scheduler, peer_address );
+  Remote::limit_rate( rate_limit );
+  auto server = Server::init( listen_address, scheduler, peer_address, network_threads );
   cout << "Server initialized" << endl;
 
+  if ( metrics_port ) {
+    // Scrapes are served on a thread of their own, so they never wait behind the network threads
+    thread( [server, port = *metrics_port] {
+      EventLoop events;
+      WebServer web_server( events, port, [&]( const HTTPRequest& request, HTTPResponse& response ) {
+        response.http_version = "HTTP/1.1";
+        if ( request.request_target == "/metrics" ) {
+          ostringstream body;
+          server->write_metrics( body );
+          response.status_code = "200";
+          response.reason_phrase = "OK";
+          response.headers.content_type = "text/plain; version=0.0.4";
+          response.body = body.str();
+        } else {
+          response.status_code = "404";
+          response.reason_phrase = "Not Found";
+          response.headers.content_type = "text/plain";
+          response.body = "Not found\n";
+        }
+        response.headers.content_length = response.body.size();
+      } );
+      while ( events.wait_next_event( -1 ) != EventLoop::Result::Exit ) {}
+    } ).detach();
+  }
+
   server->join();
 
   return 0;
@@ -60,11 +60,7 @@ Handle<Fix> make_blob( IRuntime& rt, T t ) requires std::is_integral_v<T>
   return make_blob( rt, s );
 }
 
-/**
- * Adds the args to RuntimeStorage, loading files and creating objects as necessary.
- * The contents of @p open_files must outlive this RuntimeStorage instance.
- */
-Handle<Fix> parse_args( IRuntime& rt, std::span<char*>& args )
+static Handle<Fix> parse_entry( IRuntime& rt, std::span<char*>& args )
 {
   if ( args.empty() ) {
     throw runtime_error( "not enough args" );
@@ -83,7 +79,7 @@ Handle<Fix> parse_args( IRuntime& rt, std::span<char*>& args )
     bool prev_consumed = consumed;
 
     consumed = true;
-    auto name = parse_args( rt, args );
+    auto name = parse_entry( rt, args );
 
     consumed = prev_consumed;
 
@@ -165,7 +161,7 @@ Handle<Fix> parse_args( IRuntime& rt, std::span<char*>& args )
 
     OwnedMutTree the_tree = OwnedMutTree::allocate( tree_size );
     for ( uint32_t i = 0; i < tree_size; ++i ) {
-      the_tree[i] = parse_args( rt, args );
+      the_tree[i] = parse_entry( rt, args );
     }
     return make_tree( rt, std::move( the_tree ) ).visit<Handle<Fix>>( []( auto h ) { return h; } );
   }
@@ -179,7 +175,7 @@ Handle<Fix> parse_args( IRuntime& rt, std::span<char*>& args )
 
     consumed = true;
 
-    auto h = parse_args( rt, args );
+    auto h = parse_entry( rt, args );
     auto tree_name = handle::extract<ExpressionTree>( h )
                        .transform( []( auto t ) -> Handle<AnyTree> { return t; } )
                        .or_else( [&]() -> optional<Handle<AnyTree>> { return handle::extract<ObjectTree>( h ); } )
@@ -198,7 +194,7 @@ Handle<Fix> parse_args( IRuntime& rt, std::span<char*>& args )
       throw runtime_error( "encode not refering a thunk" );
     }
 
-    auto h = parse_args( rt, args );
+    auto h = parse_entry( rt, args );
     auto thunk_name = handle::extract<Application>( h ).value();
     return Handle<Strict>( thunk_name );
   }
@@ -206,6 +202,17 @@ Handle<Fix> parse_args( IRuntime& rt, std::span<char*>& args )
   throw runtime_error( "unknown object syntax: \"" + string( str ) + "\"" );
 }
 
+/**
+ * Adds the args to RuntimeStorage, loading files and creating objects as necessary.
+ * The contents of @p open_files must outlive this RuntimeStorage instance.
+ */
+Handle<Fix> parse_args( IRuntime& rt, std::span<char*>& args )
+{
+  // A parse that threw part of the way through may have left this set
+  consumed = false;
+  return parse_entry( rt, args );
+}
+
 template<integral T>
 T to_int( const string_view str )
 {
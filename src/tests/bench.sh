@@ -0,0 +1,45 @@
+#!/usr/bin/env bash
+
+# Runs every workload at several scales, in one process and on a loopback cluster, and writes the results to the
+# given file as a JSON array. Run from the build directory.
+set -e
+
+out=${1:-bench.json}
+nodes=${BENCH_NODES:-3}
+port=12400
+results=()
+
+run()
+{
+  echo "fixpoint-bench $*" >&2
+  results+=("$(src/tests/fixpoint-bench --port $port "$@")")
+  # A fresh range of ports for each cluster, so none is still held by the last one
+  port=$((port + 16))
+}
+
+for n in 0 $nodes
+do
+  for files in 16 64 256
+  do
+    run count-words --nodes $n --files $files --file-size 65536
+  done
+  for fan_out in 16 256 4096
+  do
+    run mapreduce --nodes $n --fan-out $fan_out
+  done
+  for degree in 4 64
+  do
+    for keys in 1024 65536
+    do
+      run bptree-get --nodes $n --degree $degree --keys $keys --repetitions 100
+    done
+  done
+  for fib in 10 15 20
+  do
+    run fib --nodes $n --fib $fib
+  done
+  run self-host --nodes $n --repetitions 3
+done
+
+( IFS=,; echo "[${results[*]}]" ) > "$out"
+echo "Wrote $out" >&2
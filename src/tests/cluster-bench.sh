@@ -0,0 +1,33 @@
+#!/usr/bin/env bash
+
+# Runs mapreduce and bptree-get on a loopback cluster with each scheduler, on unlimited links and on slower
+# emulated ones, and writes the results to the given file as a JSON array. Run from the build directory.
+set -e
+
+out=${1:-cluster-bench.json}
+nodes=${BENCH_NODES:-3}
+port=13400
+results=()
+
+run()
+{
+  echo "fixpoint-bench $*" >&2
+  results+=("$(src/tests/fixpoint-bench --nodes $nodes --port $port "$@")")
+  # A fresh range of ports for each cluster, so none is still held by the last one
+  port=$((port + 16))
+}
+
+for scheduler in onepass hint random
+do
+  for rate in 0 1000 100
+  do
+    for fan_out in 256 4096
+    do
+      run mapreduce --scheduler $scheduler --rate-limit $rate --fan-out $fan_out
+    done
+    run bptree-get --scheduler $scheduler --rate-limit $rate --degree 64 --keys 65536 --repetitions 100
+  done
+done
+
+( IFS=,; echo "[${results[*]}]" ) > "$out"
+echo "Wrote $out" >&2
@@ -0,0 +1,642 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <deque>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <random>
+#include <thread>
+
+extern "C" {
+#include <sys/resource.h>
+#include <sys/wait.h>
+}
+
+#include "bptree-helper.hh"
+#include "option-parser.hh"
+#include "relater.hh"
+#include "runtimes.hh"
+#include "scheduler.hh"
+#include "test.hh"
+
+using namespace std;
+
+namespace {
+const string mapreduce_wasm = "applications-prefix/src/applications-build/mapreduce/mapreduce.wasm";
+const string curry_wasm = "applications-prefix/src/applications-build/curry/curry.wasm";
+const string count_words_wasm = "applications-prefix/src/applications-build/count-words/count_words.wasm";
+const string merge_counts_wasm = "applications-prefix/src/applications-build/count-words/merge_counts.wasm";
+const string bptree_get_wasm = "applications-prefix/src/applications-build/bptree-get/bptree-get.wasm";
+
+struct Scale
+{
+  size_t files = 16;
+  size_t file_size = 16384;
+  size_t fan_out = 64;
+  size_t degree = 16;
+  size_t keys = 4096;
+  uint32_t n = 15;
+};
+
+struct Workload
+{
+  // The work done by one repetition, from which the throughput is reported
+  string unit {};
+  double units {};
+  vector<pair<string, size_t>> params {};
+
+  function<Handle<Relation>( size_t repetition )> job {};
+  // Throws if the result of a repetition is wrong
+  function<void( Handle<Value> )> check {};
+};
+
+// Each repetition runs under a slightly different memory limit, which procedures pass on to the applications they
+// create. Every relation of a repetition is then new to the runtime, and none is answered from an earlier one.
+Handle<ValueTree> repetition_limits( IRuntime& rt, uint64_t memory, size_t repetition )
+{
+  return limits( rt, memory + ( repetition << 16 ), 1024, 1 );
+}
+
+Handle<AnyTree> make_tree( IRuntime& rt, const vector<Handle<Fix>>& entries )
+{
+  auto tree = OwnedMutTree::allocate( entries.size() );
+  for ( size_t i = 0; i < entries.size(); i++ ) {
+    tree[i] = entries[i];
+  }
+  return rt.create( make_shared<OwnedTree>( move( tree ) ) );
+}
+
+uint64_t literal_value( Handle<Value> result )
+{
+  uint64_t value = 0;
+  const auto literal = result.try_into<Blob>().and_then( []( auto h ) { return h.template try_into<Literal>(); } );
+  if ( !literal ) {
+    throw runtime_error( "expected a literal result" );
+  }
+  memcpy( &value, literal->view().data(), min( sizeof( value ), literal->view().size() ) );
+  return value;
+}
+
+Workload count_words( Relater& rt, const Scale& scale )
+{
+  static const array<string_view, 16> vocabulary = { "the",  "quick", "brown", "fox",   "jumps", "over",
+                                                     "lazy", "dog",   "it",    "was",   "best",  "of",
+                                                     "times", "worst", "age",  "wisdom" };
+  const string_view goal = "the";
+
+  auto mapreduce_elf = compile( rt, file( rt, mapreduce_wasm ) );
+  auto count_elf = compile( rt, file( rt, count_words_wasm ) );
+  auto merge_elf = compile( rt, file( rt, merge_counts_wasm ) );
+
+  // The same corpus on every run, so results are comparable between commits
+  mt19937 gen( 0 );
+  uniform_int_distribution<size_t> word( 0, vocabulary.size() - 1 );
+  vector<Handle<Fix>> documents;
+  uint64_t expected = 0;
+  for ( size_t i = 0; i < scale.files; i++ ) {
+    string text;
+    while ( text.size() < scale.file_size ) {
+      text += vocabulary[word( gen )];
+      text += ' ';
+    }
+    text.resize( scale.file_size );
+    for ( size_t pos = text.find( goal ); pos != string::npos; pos = text.find( goal, pos + 1 ) ) {
+      expected++;
+    }
+    documents.push_back(
+      handle::upcast( make_tree( rt, { handle::fix( blob( rt, goal ) ), handle::fix( blob( rt, text ) ) } ) ) );
+  }
+  auto corpus = handle::upcast( make_tree( rt, documents ) );
+
+  return { "bytes",
+           double( scale.files * scale.file_size ),
+           { { "files", scale.files }, { "file_size", scale.file_size } },
+           [&rt, mapreduce_elf, count_elf, merge_elf, corpus]( size_t repetition ) -> Handle<Relation> {
+             auto limits = repetition_limits( rt, 1024 * 1024 * 1024, repetition );
+             return Handle<Eval>( Handle<Thunk>( handle::upcast(
+               tree( rt, limits, mapreduce_elf, count_elf, merge_elf, corpus, limits, limits ) ) ) );
+           },
+           [expected]( Handle<Value> result ) {
+             const uint64_t count = literal_value( result );
+             if ( count != expected ) {
+               throw runtime_error( "count-words: got " + to_string( count ) + ", expected "
+                                    + to_string( expected ) );
+             }
+           } };
+}
+
+Workload mapreduce( Relater& rt, const Scale& scale )
+{
+  auto mapreduce_elf = compile( rt, file( rt, mapreduce_wasm ) );
+  auto curry_elf = compile( rt, file( rt, curry_wasm ) );
+  auto sum_elf = compile( rt, file( rt, "testing/wasm-examples/add-simple.wasm" ) );
+
+  vector<Handle<Fix>> elements;
+  for ( size_t i = 0; i < scale.fan_out; i++ ) {
+    elements.push_back( Handle<Literal>( uint32_t( i ) ) );
+  }
+  auto original = handle::upcast( make_tree( rt, elements ) );
+
+  // Each element has 0x100 added to it, and the results are summed
+  const uint32_t expected = scale.fan_out * ( scale.fan_out - 1 ) / 2 + scale.fan_out * 0x100;
+
+  return { "elements",
+           double( scale.fan_out ),
+           { { "fan_out", scale.fan_out } },
+           [&rt, mapreduce_elf, curry_elf, sum_elf, original]( size_t repetition ) -> Handle<Relation> {
+             auto limits = repetition_limits( rt, 1024 * 1024, repetition );
+             auto curried = Handle<Strict>(
+               Handle<Thunk>( handle::upcast( tree( rt, limits, curry_elf, sum_elf, 2_literal32 ) ) ) );
+             auto add100
+               = Handle<Strict>( Handle<Thunk>( handle::upcast( tree( rt, limits, curried, 0x100_literal32 ) ) ) );
+             return Handle<Eval>( Handle<Thunk>(
+               handle::upcast( tree( rt, limits, mapreduce_elf, add100, sum_elf, original, limits, limits ) ) ) );
+           },
+           [expected]( Handle<Value> result ) {
+             const auto sum = uint32_t( literal_value( result ) );
+             if ( sum != expected ) {
+               throw runtime_error( "mapreduce: got " + to_string( sum ) + ", expected " + to_string( expected ) );
+             }
+           } };
+}
+
+Workload bptree_get( Relater& rt, const Scale& scale )
+{
+  BPTree bptree( scale.degree );
+  for ( size_t key = 0; key < scale.keys; key++ ) {
+    bptree.insert( key, to_string( key ) );
+  }
+  auto bptree_fix = bptree::to_storage( rt.get_storage(), bptree );
+  auto bptree_elf = compile( rt, file( rt, bptree_get_wasm ) );
+  auto root = Handle<Strict>( Handle<Selection>(
+    Handle<ObjectTree>( tree( rt, bptree_fix, Handle<Literal>( (uint64_t)0 ) ).unwrap<ValueTree>() ) ) );
+
+  size_t depth = 0;
+  for ( size_t reach = 1; reach < scale.keys; reach *= scale.degree ) {
+    depth++;
+  }
+
+  // Repetition i looks up the same key on every run
+  const auto key = [count = scale.keys]( size_t repetition ) {
+    mt19937 gen( repetition );
+    return uniform_int_distribution<int>( 0, count - 1 )( gen );
+  };
+
+  // Results arrive in the order the jobs were made
+  auto keys = make_shared<deque<int>>();
+  return { "lookups",
+           1,
+           { { "degree", scale.degree }, { "keys", scale.keys }, { "depth", depth } },
+           [&rt, bptree_fix, bptree_elf, root, key, keys]( size_t repetition ) -> Handle<Relation> {
+             keys->push_back( key( repetition ) );
+             auto combination = tree( rt,
+                                      repetition_limits( rt, 1024 * 1024, repetition ),
+                                      bptree_elf,
+                                      root,
+                                      bptree_fix,
+                                      Handle<Literal>( keys->back() ) );
+             return Handle<Eval>( Handle<Application>( handle::upcast( combination ) ) );
+           },
+           [&rt, keys]( Handle<Value> result ) {
+             const int expected = keys->front();
+             keys->pop_front();
+             const auto value = result.try_into<Blob>().transform( [&]( auto h ) {
+               return h.template visit<string>( overload {
+                 []( Handle<Literal> l ) { return string( l.view() ); },
+                 [&]( Handle<Named> n ) { return string( string_view( rt.get( n ).value()->span() ) ); },
+               } );
+             } );
+             if ( value != to_string( expected ) ) {
+               throw runtime_error( "bptree-get: wrong value for key " + to_string( expected ) );
+             }
+           } };
+}
+
+Workload fib( Relater& rt, const Scale& scale )
+{
+  auto addblob_elf = compile( rt, file( rt, "testing/wasm-examples/addblob.wasm" ) );
+  auto fib_elf = compile( rt, file( rt, "testing/wasm-examples/fib.wasm" ) );
+
+  uint32_t expected = 1;
+  for ( uint32_t previous = 1, i = 1; i < scale.n; i++ ) {
+    expected = exchange( previous, expected ) + expected;
+  }
+
+  return { "runs",
+           1,
+           { { "n", scale.n } },
+           [&rt, addblob_elf, fib_elf, n = scale.n]( size_t repetition ) -> Handle<Relation> {
+             auto combination = tree(
+               rt, repetition_limits( rt, 1024 * 1024, repetition ), fib_elf, Handle<Literal>( n ), addblob_elf );
+             return Handle<Eval>( Handle<Application>( handle::upcast( combination ) ) );
+           },
+           [expected]( Handle<Value> result ) {
+             const auto value = uint32_t( literal_value( result ) );
+             if ( value != expected ) {
+               throw runtime_error( "fib: got " + to_string( value ) + ", expected " + to_string( expected ) );
+             }
+           } };
+}
+
+// Compiles the compiler toolchain with itself, as test-self-host does
+Workload self_host( Relater& rt, const Scale& )
+{
+  static const array<string, 5> tasks = { "wasm-to-c-fix", "c-to-elf-fix", "link-elfs-fix", "compile", "map" };
+  auto compiler = handle::extract<Identification>( make_identification( rt.labeled( "compile-encode" ) ) ).value();
+  vector<Handle<Fix>> wasms;
+  for ( const auto& task : tasks ) {
+    wasms.push_back( Handle<Strict>(
+      handle::extract<Identification>( make_identification( rt.labeled( task + "-wasm" ) ) ).value() ) );
+  }
+
+  return { "programs",
+           double( tasks.size() ),
+           {},
+           [&rt, compiler, wasms]( size_t repetition ) -> Handle<Relation> {
+             auto limits = repetition_limits( rt, 1024 * 1024 * 1024, repetition );
+             vector<Handle<Fix>> compiles;
+             for ( const auto& wasm : wasms ) {
+               auto combination = tree( rt, limits, Handle<Strict>( compiler ), wasm );
+               compiles.push_back( Handle<Application>( handle::upcast( combination ) ) );
+             }
+             return Handle<Eval>( make_tree( rt, compiles ).try_into<ObjectTree>().value() );
+           },
+           // Each program compiles to the runnable the toolchain was built with
+           [&rt]( Handle<Value> result ) {
+             const auto elfs
+               = result.try_into<ValueTree>().transform( [&]( auto h ) { return rt.get( h ).value(); } );
+             if ( !elfs or elfs.value()->size() != tasks.size() ) {
+               throw runtime_error( "self-host: expected a tree of " + to_string( tasks.size() ) + " programs" );
+             }
+             for ( size_t i = 0; i < tasks.size(); i++ ) {
+               if ( elfs.value()->at( i ) != rt.labeled( tasks[i] + "-runnable-tag" ) ) {
+                 throw runtime_error( "self-host: " + tasks[i] + " compiled to a different runnable" );
+               }
+             }
+           } };
+}
+
+const map<string, function<Workload( Relater&, const Scale& )>> workloads = {
+  { "count-words", count_words }, { "mapreduce", mapreduce }, { "bptree-get", bptree_get },
+  { "fib", fib },                 { "self-host", self_host },
+};
+
+const map<string, function<shared_ptr<Scheduler>()>> schedulers = {
+  { "onepass", [] { return make_shared<OnePassScheduler>(); } },
+  { "hint", [] { return make_shared<HintScheduler>(); } },
+  { "random", [] { return make_shared<RandomScheduler>(); } },
+};
+
+// What one node has done so far: the procedures it applied, and the bytes it sent to its peers by opcode
+struct NodeStats
+{
+  uint64_t applications {};
+  array<uint64_t, Remote::Traffic::OPCODES> bytes {};
+
+  NodeStats& operator-=( const NodeStats& other )
+  {
+    applications -= other.applications;
+    for ( size_t i = 0; i < bytes.size(); i++ ) {
+      bytes[i] -= other.bytes[i];
+    }
+    return *this;
+  }
+};
+
+NodeStats node_stats( Relater& rt, NetworkWorker& network )
+{
+  NodeStats stats { .applications = rt.applications() };
+  for ( const auto& [_, remote] : network.peers() ) {
+    for ( size_t i = 0; i < stats.bytes.size(); i++ ) {
+      stats.bytes[i] += remote->sent().bytes[i].load( memory_order_relaxed );
+    }
+  }
+  return stats;
+}
+
+// Servers forked onto consecutive loopback ports; each connects to the ones before it, as fixpoint-server does
+// with a peer file. The servers are killed when this goes out of scope.
+class Cluster
+{
+  struct Node
+  {
+    pid_t pid;
+    // Each server writes a line of its NodeStats here when sent SIGUSR2
+    FILE* stats;
+  };
+
+  vector<Node> servers_ {};
+
+  [[noreturn]] static void serve( const vector<Address>& peers, size_t index, const string& scheduler, int stats )
+  {
+    // Blocked before the server starts any thread, so only the thread below takes it
+    sigset_t signals;
+    sigemptyset( &signals );
+    sigaddset( &signals, SIGUSR2 );
+    pthread_sigmask( SIG_BLOCK, &signals, nullptr );
+
+    auto server = Server::init( peers[index], schedulers.at( scheduler )(), peers );
+    thread( [server, signals, out = fdopen( stats, "w" )] {
+      int received;
+      while ( sigwait( &signals, &received ) == 0 ) {
+        const auto snapshot = node_stats( server->get_rt(), server->get_network() );
+        fprintf( out, "%lu", snapshot.applications );
+        for ( const auto bytes : snapshot.bytes ) {
+          fprintf( out, " %lu", bytes );
+        }
+        fprintf( out, "\n" );
+        fflush( out );
+      }
+    } ).detach();
+    server->join();
+    _exit( 0 );
+  }
+
+public:
+  Cluster( size_t nodes, uint16_t port, const string& scheduler )
+  {
+    for ( size_t i = 0; i < nodes; i++ ) {
+      int stats[2];
+      if ( pipe( stats ) < 0 ) {
+        throw runtime_error( "pipe failed" );
+      }
+      const pid_t pid = fork();
+      if ( pid < 0 ) {
+        throw runtime_error( "fork failed" );
+      }
+      if ( pid == 0 ) {
+        close( stats[0] );
+        vector<Address> peers;
+        for ( size_t j = 0; j < nodes; j++ ) {
+          peers.push_back( i == j ? Address( "0.0.0.0", port + j ) : Address( "127.0.0.1", port + j ) );
+        }
+        serve( peers, i, scheduler, stats[1] );
+      }
+      close( stats[1] );
+      servers_.push_back( { pid, fdopen( stats[0], "r" ) } );
+      // Let each server listen before the next one connects to it
+      this_thread::sleep_for( 500ms );
+    }
+  }
+
+  // What each server has done so far, in the order of their ports
+  vector<NodeStats> stats()
+  {
+    vector<NodeStats> result;
+    for ( const auto& server : servers_ ) {
+      kill( server.pid, SIGUSR2 );
+      NodeStats& node = result.emplace_back();
+      bool complete = fscanf( server.stats, "%lu", &node.applications ) == 1;
+      for ( auto& bytes : node.bytes ) {
+        complete = complete and fscanf( server.stats, "%lu", &bytes ) == 1;
+      }
+      if ( not complete ) {
+        throw runtime_error( "could not read the statistics of a server" );
+      }
+    }
+    return result;
+  }
+
+  ~Cluster()
+  {
+    for ( const auto& server : servers_ ) {
+      kill( server.pid, SIGTERM );
+    }
+    for ( const auto& server : servers_ ) {
+      waitpid( server.pid, nullptr, 0 );
+      fclose( server.stats );
+    }
+  }
+
+  Cluster( const Cluster& ) = delete;
+  Cluster& operator=( const Cluster& ) = delete;
+};
+
+double percentile( const vector<double>& sorted, double p )
+{
+  const size_t rank = ceil( p / 100 * sorted.size() );
+  return sorted.at( max<size_t>( rank, 1 ) - 1 );
+}
+
+long peak_rss_kib( int who )
+{
+  rusage usage;
+  getrusage( who, &usage );
+  return usage.ru_maxrss;
+}
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc <= 0 ) {
+    abort();
+  }
+
+  OptionParser parser( "fixpoint-bench", "Time a bundled application end to end and print the results as JSON" );
+  string name;
+  Scale scale;
+  size_t nodes = 0;
+  uint16_t port = 12400;
+  string scheduler = "hint";
+  uint64_t rate_limit = 0;
+  size_t warmup = 1;
+  size_t repetitions = 10;
+  parser.AddArgument( "workload", OptionParser::ArgumentCount::One, [&]( const char* argument ) {
+    name = argument;
+    if ( !workloads.contains( name ) ) {
+      throw runtime_error( "Invalid workload: " + name );
+    }
+  } );
+  parser.AddOption( 'N',
+                    "nodes",
+                    "nodes",
+                    "Run on a cluster of <nodes> servers on loopback rather than in this process (default 0).",
+                    [&]( const char* argument ) { nodes = stoul( argument ); } );
+  parser.AddOption( 'p',
+                    "port",
+                    "port",
+                    "First port of the loopback cluster (default 12400).",
+                    [&]( const char* argument ) { port = stoi( argument ); } );
+  parser.AddOption( 's',
+                    "scheduler",
+                    "scheduler",
+                    "Scheduler of the cluster's servers [onepass, hint, random] (default hint).",
+                    [&]( const char* argument ) {
+                      scheduler = argument;
+                      if ( !schedulers.contains( scheduler ) ) {
+                        throw runtime_error( "Invalid scheduler: " + scheduler );
+                      }
+                    } );
+  parser.AddOption( 'R',
+                    "rate-limit",
+                    "mbps",
+                    "Limit each link of the cluster to <mbps> megabits per second (default none).",
+                    [&]( const char* argument ) { rate_limit = stoull( argument ); } );
+  parser.AddOption( 'w',
+                    "warmup",
+                    "runs",
+                    "Unmeasured repetitions run first (default 1).",
+                    [&]( const char* argument ) { warmup = stoul( argument ); } );
+  parser.AddOption( 'r', "repetitions", "runs", "Measured repetitions (default 10).", [&]( const char* argument ) {
+    repetitions = stoul( argument );
+  } );
+  parser.AddOption( 'f',
+                    "files",
+                    "files",
+                    "count-words: documents in the corpus (default 16).",
+                    [&]( const char* argument ) { scale.files = stoul( argument ); } );
+  parser.AddOption( 'b',
+                    "file-size",
+                    "bytes",
+                    "count-words: bytes per document (default 16384).",
+                    [&]( const char* argument ) { scale.file_size = stoul( argument ); } );
+  parser.AddOption( 'o',
+                    "fan-out",
+                    "elements",
+                    "mapreduce: elements mapped (default 64).",
+                    [&]( const char* argument ) { scale.fan_out = stoul( argument ); } );
+  parser.AddOption( 'd',
+                    "degree",
+                    "degree",
+                    "bptree-get: keys per node (default 16).",
+                    [&]( const char* argument ) { scale.degree = stoul( argument ); } );
+  parser.AddOption( 'k',
+                    "keys",
+                    "keys",
+                    "bptree-get: keys in the tree (default 4096).",
+                    [&]( const char* argument ) { scale.keys = stoul( argument ); } );
+  parser.AddOption( 'n', "fib", "n", "fib: the argument (default 15).", [&]( const char* argument ) {
+    scale.n = stoul( argument );
+  } );
+
+  google::InitGoogleLogging( argv[0] );
+  google::InstallFailureSignalHandler();
+
+  parser.Parse( argc, argv );
+
+  // The servers are forked before this process starts any threads
+  optional<Cluster> cluster;
+  shared_ptr<Client> client;
+  shared_ptr<Relater> relater;
+  function<Handle<Value>( Handle<Relation> )> execute;
+  if ( nodes > 0 ) {
+    // Inherited by the servers, and applied to the frontend's own link too
+    Remote::limit_rate( rate_limit * 1000 * 1000 / 8 );
+    cluster.emplace( nodes, port, scheduler );
+    client = Client::init( Address( "127.0.0.1", port ) );
+    execute = [&]( Handle<Relation> job ) { return client->execute( job ); };
+  } else {
+    relater = make_shared<Relater>( thread::hardware_concurrency() );
+    execute = [&]( Handle<Relation> job ) { return relater->execute( job ); };
+  }
+  Relater& rt = client ? client->get_rt() : *relater;
+
+  const auto workload = workloads.at( name )( rt, scale );
+
+  // The servers' statistics and the frontend's, in that order
+  const auto cluster_stats = [&] {
+    auto stats = cluster->stats();
+    stats.push_back( node_stats( client->get_rt(), client->get_network() ) );
+    return stats;
+  };
+
+  vector<double> latencies;
+  vector<NodeStats> before;
+  chrono::steady_clock::time_point measured;
+  for ( size_t i = 0; i < warmup + repetitions; i++ ) {
+    if ( i == warmup ) {
+      measured = chrono::steady_clock::now();
+      if ( cluster ) {
+        before = cluster_stats();
+      }
+    }
+    const auto job = workload.job( i );
+    const auto start = chrono::steady_clock::now();
+    const auto result = execute( job );
+    const auto end = chrono::steady_clock::now();
+    if ( workload.check ) {
+      workload.check( result );
+    }
+    if ( i >= warmup ) {
+      latencies.push_back( chrono::duration<double, milli>( end - start ).count() );
+    }
+  }
+
+  const double makespan = chrono::duration<double, milli>( chrono::steady_clock::now() - measured ).count();
+  vector<NodeStats> placement;
+  if ( cluster and !latencies.empty() ) {
+    placement = cluster_stats();
+    for ( size_t i = 0; i < placement.size(); i++ ) {
+      placement[i] -= before.at( i );
+    }
+  }
+
+  const long frontend_rss = peak_rss_kib( RUSAGE_SELF );
+  client.reset();
+  cluster.reset();
+
+  double total = 0;
+  for ( const auto latency : latencies ) {
+    total += latency;
+  }
+  sort( latencies.begin(), latencies.end() );
+
+  cout << "{\"workload\":\"" << name << "\",\"nodes\":" << nodes;
+  if ( nodes > 0 ) {
+    cout << ",\"scheduler\":\"" << scheduler << "\",\"rate_limit_mbps\":" << rate_limit;
+  }
+  cout << ",\"params\":{";
+  for ( size_t i = 0; i < workload.params.size(); i++ ) {
+    cout << ( i ? "," : "" ) << "\"" << workload.params[i].first << "\":" << workload.params[i].second;
+  }
+  cout << "},\"repetitions\":" << latencies.size();
+  if ( !latencies.empty() ) {
+    cout << ",\"throughput\":{\"" << workload.unit
+         << "_per_second\":" << workload.units * latencies.size() / ( total / 1000 ) << "}";
+    cout << ",\"latency_ms\":{\"min\":" << latencies.front() << ",\"p50\":" << percentile( latencies, 50 )
+         << ",\"p90\":" << percentile( latencies, 90 ) << ",\"p99\":" << percentile( latencies, 99 )
+         << ",\"max\":" << latencies.back() << "}";
+    // From the first measured repetition to the result of the last, which run one after another
+    cout << ",\"makespan_ms\":" << makespan;
+  }
+  if ( !placement.empty() ) {
+    // Procedures applied by each server, and bytes sent by the servers and the frontend together
+    uint64_t most = 0;
+    uint64_t total_applications = 0;
+    cout << ",\"applications\":[";
+    for ( size_t i = 0; i + 1 < placement.size(); i++ ) {
+      cout << ( i ? "," : "" ) << placement[i].applications;
+      most = max( most, placement[i].applications );
+      total_applications += placement[i].applications;
+    }
+    // The busiest server against an even spread; 1 is perfectly balanced
+    cout << "],\"imbalance\":" << ( total_applications ? double( most ) * nodes / total_applications : 1 );
+
+    array<uint64_t, Remote::Traffic::OPCODES> bytes {};
+    for ( const auto& node : placement ) {
+      for ( size_t i = 0; i < bytes.size(); i++ ) {
+        bytes[i] += node.bytes[i];
+      }
+    }
+    cout << ",\"bytes_by_opcode\":{";
+    bool first = true;
+    for ( size_t i = 0; i < bytes.size(); i++ ) {
+      if ( bytes[i] ) {
+        cout << ( first ? "" : "," ) << "\"" << Message::OPCODE_NAMES[i] << "\":" << bytes[i];
+        first = false;
+      }
+    }
+    cout << "}";
+  }
+  cout << ",\"peak_rss_kib\":{\"frontend\":" << frontend_rss;
+  if ( nodes > 0 ) {
+    // The largest of the servers, which have all been reaped by now
+    cout << ",\"server\":" << peak_rss_kib( RUSAGE_CHILDREN );
+  }
+  cout << "}}" << endl;
+
+  return 0;
+}
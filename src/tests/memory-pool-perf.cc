@@ -0,0 +1,72 @@
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <sys/mman.h>
+#include <thread>
+#include <vector>
+
+#include "resource_limits.hh"
+#include "wasm-rt.h"
+
+#define THREADS 64
+#define INSTANCES 2000
+#define PAGES 16
+
+using namespace std;
+
+// What wasm_rt_allocate_memory did before guard regions were pooled: reserve, commit and release per instance.
+static void unpooled_instance()
+{
+  void* addr = mmap( NULL, 0x200000000ul, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0 );
+  if ( addr == MAP_FAILED ) {
+    perror( "mmap" );
+    abort();
+  }
+  mprotect( addr, PAGES * WASM_RT_PAGE_SIZE, PROT_READ | PROT_WRITE );
+  for ( size_t i = 0; i < PAGES; i++ ) {
+    static_cast<uint8_t*>( addr )[i * WASM_RT_PAGE_SIZE] = 1;
+  }
+  munmap( addr, 0x200000000ul );
+}
+
+static void pooled_instance()
+{
+  wasm_rt_memory_t memory;
+  wasm_rt_allocate_memory( &memory, PAGES, 65536, false );
+  for ( size_t i = 0; i < PAGES; i++ ) {
+    memory.data[i * WASM_RT_PAGE_SIZE] = 1;
+  }
+  wasm_rt_free_memory( &memory );
+}
+
+template<void ( *F )()>
+static void run( const char* name, size_t threads )
+{
+  auto start = chrono::steady_clock::now();
+
+  vector<thread> workers;
+  for ( size_t i = 0; i < threads; i++ ) {
+    workers.emplace_back( [] {
+      resource_limits::available_bytes = UINT64_MAX;
+      for ( size_t j = 0; j < INSTANCES; j++ ) {
+        F();
+      }
+    } );
+  }
+  for ( auto& worker : workers ) {
+    worker.join();
+  }
+
+  auto elapsed = chrono::duration<double>( chrono::steady_clock::now() - start ).count();
+  cout << name << " threads=" << threads << " instances/s=" << threads * INSTANCES / elapsed << endl;
+}
+
+int main( void )
+{
+  for ( size_t threads = 1; threads <= THREADS; threads *= 4 ) {
+    run<unpooled_instance>( "unpooled", threads );
+    run<pooled_instance>( "pooled", threads );
+  }
+
+  return 0;
+}
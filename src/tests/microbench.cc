@@ -0,0 +1,411 @@
+#include <algorithm>
+#include <barrier>
+#include <chrono>
+#include <format>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <thread>
+
+#include <pthread.h>
+#include <sched.h>
+
+#include "channel.hh"
+#include "dependency_graph.hh"
+#include "elfloader.hh"
+#include "evaluator.hh"
+#include "fixpointapi.hh"
+#include "handle_util.hh"
+#include "hash_table.hh"
+#include "option-parser.hh"
+#include "relater.hh"
+#include "resource_limits.hh"
+#include "runtimestorage.hh"
+#include "test.hh"
+
+using namespace std;
+
+namespace {
+size_t warmup = 2;
+size_t repeats = 10;
+string filter;
+const size_t cpus = thread::hardware_concurrency();
+
+// Keeps the compiler from discarding a result that is otherwise unused
+template<typename T>
+void keep( const T& value )
+{
+  asm volatile( "" : : "g"( &value ) : "memory" );
+}
+
+void pin( size_t cpu )
+{
+  cpu_set_t set;
+  CPU_ZERO( &set );
+  CPU_SET( cpu % cpus, &set );
+  pthread_setaffinity_np( pthread_self(), sizeof( set ), &set );
+}
+
+/**
+ * Times `ops` operations split evenly over `threads` threads, each pinned to its own CPU.
+ * `work( thread, begin, end )` performs operations [begin, end), and `prepare` runs untimed before every round.
+ * After `warmup` untimed rounds, prints the median and the best of `repeats` timed rounds, in nanoseconds per
+ * operation.
+ */
+void measure(
+  const string& name,
+  size_t threads,
+  size_t ops,
+  const function<void( size_t, size_t, size_t )>& work,
+  const function<void()>& prepare = [] {} )
+{
+  if ( name.find( filter ) == string::npos ) {
+    return;
+  }
+
+  vector<double> rounds;
+  for ( size_t round = 0; round < warmup + repeats; round++ ) {
+    prepare();
+
+    // Threads are started and pinned before the clock starts, and the clock stops when the last one is done
+    barrier sync( threads + 1 );
+    vector<thread> workers;
+    for ( size_t i = 0; i < threads; i++ ) {
+      workers.emplace_back( [&, i] {
+        pin( i );
+        sync.arrive_and_wait();
+        work( i, ops * i / threads, ops * ( i + 1 ) / threads );
+        sync.arrive_and_wait();
+      } );
+    }
+    sync.arrive_and_wait();
+    const auto start = chrono::steady_clock::now();
+    sync.arrive_and_wait();
+    const auto end = chrono::steady_clock::now();
+    for ( auto& worker : workers ) {
+      worker.join();
+    }
+
+    if ( round >= warmup ) {
+      rounds.push_back( chrono::duration<double, nano>( end - start ).count() / ops );
+    }
+  }
+
+  sort( rounds.begin(), rounds.end() );
+  const double median = rounds[rounds.size() / 2];
+  cout << std::format(
+    "{:<48} {:>7} {:>12.1f} {:>12.1f} {:>10.3f}\n", name, threads, median, rounds.front(), 1000 / median );
+}
+
+vector<size_t> thread_counts()
+{
+  vector<size_t> counts { 1 };
+  if ( cpus >= 4 ) {
+    counts.push_back( 4 );
+  }
+  if ( cpus > 4 ) {
+    counts.push_back( cpus );
+  }
+  return counts;
+}
+
+vector<Handle<Named>> random_names( size_t count, uint64_t seed )
+{
+  mt19937_64 gen( seed );
+  vector<Handle<Named>> names;
+  for ( size_t i = 0; i < count; i++ ) {
+    u64x4 hash { gen(), gen(), gen(), gen() };
+    names.push_back( Handle<Named>( (u8x32)hash, 1024 ) );
+  }
+  return names;
+}
+
+void bench_create()
+{
+  for ( const size_t size : { 16, 1024, 1 << 20 } ) {
+    auto blob = OwnedMutBlob::allocate( size );
+    memset( blob.data(), 'x', size );
+    const BlobData data = make_shared<OwnedBlob>( move( blob ) );
+    const size_t ops = max<size_t>( 64, ( 64 << 20 ) / size );
+    measure( std::format( "handle::create blob {}B", size ), 1, ops, [&]( size_t, size_t begin, size_t end ) {
+      for ( size_t i = begin; i < end; i++ ) {
+        keep( handle::create( data ) );
+      }
+    } );
+  }
+
+  for ( const size_t size : { 4, 4096 } ) {
+    auto tree = OwnedMutTree::allocate( size );
+    for ( size_t i = 0; i < size; i++ ) {
+      tree[i] = Handle<Literal>( uint64_t( i ) );
+    }
+    const TreeData data = make_shared<OwnedTree>( move( tree ) );
+    const size_t ops = ( 16 << 20 ) / size;
+    const auto create = [&]( size_t, size_t begin, size_t end ) {
+      for ( size_t i = begin; i < end; i++ ) {
+        keep( handle::create( data ) );
+      }
+    };
+    measure( std::format( "handle::create tree {} entries", size ), 1, ops, create );
+  }
+}
+
+void bench_fix_table()
+{
+  using Table = FixTable<Named, size_t, AbslHash>;
+  const size_t capacity = 1 << 20;
+  const size_t ops = 1 << 20;
+  const auto names = random_names( capacity, 0 );
+  const auto absent = random_names( ops, 1 );
+
+  for ( const double load : { 0.25, 0.5, 0.75, 0.9 } ) {
+    const size_t resident = capacity * load;
+    const string at = std::format( "at {:.0f}% load", load * 100 );
+    unique_ptr<Table> table;
+    const auto fill = [&] {
+      table = make_unique<Table>( capacity );
+      for ( size_t i = 0; i < resident; i++ ) {
+        table->insert( names[i], i );
+      }
+    };
+
+    for ( const size_t threads : thread_counts() ) {
+      // One more percent of the capacity, so the load factor barely moves
+      const auto insert = [&]( size_t, size_t begin, size_t end ) {
+        for ( size_t i = begin; i < end; i++ ) {
+          table->insert( names[resident + i], i );
+        }
+      };
+      measure( "FixTable insert " + at, threads, capacity / 100, insert, fill );
+    }
+
+    fill();
+    for ( const size_t threads : thread_counts() ) {
+      measure( "FixTable get " + at, threads, ops, [&]( size_t, size_t begin, size_t end ) {
+        for ( size_t i = begin; i < end; i++ ) {
+          keep( table->get( names[i * 7919 % resident] ) );
+        }
+      } );
+      measure( "FixTable miss " + at, threads, ops, [&]( size_t, size_t begin, size_t end ) {
+        for ( size_t i = begin; i < end; i++ ) {
+          keep( table->get( absent[i] ) );
+        }
+      } );
+    }
+  }
+}
+
+void bench_dependency_graph()
+{
+  const size_t ops = 1 << 18;
+  vector<DependencyGraph::Task> tasks;
+  for ( size_t i = 0; i < 2 * ops; i++ ) {
+    tasks.push_back( Handle<Eval>( Handle<Object>( Handle<Literal>( uint64_t( i ) ) ) ) );
+  }
+
+  // The graph is only ever used under the Relater's lock, so from one thread
+  unique_ptr<DependencyGraph> graph;
+  const auto reset = [&] { graph = make_unique<DependencyGraph>(); };
+
+  const auto start_finish = [&]( size_t, size_t begin, size_t end ) {
+    absl::flat_hash_set<DependencyGraph::Task> unblocked;
+    for ( size_t i = begin; i < end; i++ ) {
+      graph->start( tasks[i] );
+      graph->finish( tasks[i], unblocked );
+    }
+  };
+  measure( "DependencyGraph start+finish", 1, ops, start_finish, reset );
+
+  // A task blocks on another, which finishes and resumes it
+  const auto block_resume = [&]( size_t, size_t begin, size_t end ) {
+    absl::flat_hash_set<DependencyGraph::Task> unblocked;
+    for ( size_t i = begin; i < end; i++ ) {
+      const auto parent = tasks[2 * i];
+      const auto child = tasks[2 * i + 1];
+      graph->start( parent );
+      graph->add_dependency( parent, child );
+      graph->start( child );
+      graph->finish( child, unblocked );
+      graph->start( parent );
+      graph->finish( parent, unblocked );
+      unblocked.clear();
+    }
+  };
+  measure( "DependencyGraph block+resume", 1, ops, block_resume, reset );
+}
+
+void bench_channel()
+{
+  const size_t ops = 1 << 20;
+  unique_ptr<Channel<size_t>> channel;
+  const auto empty = [&] { channel = make_unique<Channel<size_t>>(); };
+  const auto full = [&] {
+    empty();
+    for ( size_t i = 0; i < ops; i++ ) {
+      channel->push( i );
+    }
+  };
+  const auto push = [&]( size_t, size_t begin, size_t end ) {
+    for ( size_t i = begin; i < end; i++ ) {
+      channel->push( i );
+    }
+  };
+  const auto pop = [&]( size_t, size_t begin, size_t end ) {
+    for ( size_t i = begin; i < end; i++ ) {
+      keep( channel->pop() );
+    }
+  };
+
+  for ( const size_t threads : thread_counts() ) {
+    measure( "Channel push", threads, ops, push, empty );
+    measure( "Channel pop", threads, ops, pop, full );
+  }
+}
+
+/**
+ * Answers every application from relations already in storage, so FixEvaluator::force is timed on the path taken
+ * by a relation that has been computed before.
+ */
+class CachedRuntime : public FixRuntime
+{
+  RuntimeStorage& storage_;
+
+  [[noreturn]] static void unused() { throw runtime_error( "not used by the benchmark" ); }
+
+public:
+  explicit CachedRuntime( RuntimeStorage& storage )
+    : storage_( storage )
+  {}
+
+  static Handle<Relation> relation( Handle<ObjectTree> combination )
+  {
+    return Handle<Think>( Handle<Thunk>( Handle<Application>( Handle<ExpressionTree>( combination ) ) ) );
+  }
+
+  Result<AnyTree> load( Handle<AnyTree> value ) override { return storage_.get_handle( value ); }
+  Result<Object> apply( Handle<ObjectTree> combination ) override
+  {
+    return storage_.get( relation( combination ) );
+  }
+
+  Result<Blob> load( Handle<Blob> ) override { unused(); }
+  Result<AnyTree> load( Handle<AnyTreeRef> ) override { unused(); }
+  Result<AnyTree> loadShallow( Handle<AnyTree> ) override { unused(); }
+  Handle<AnyTreeRef> ref( Handle<AnyTree> ) override { unused(); }
+  Result<Object> select( Handle<ObjectTree> ) override { unused(); }
+  Result<Object> force( Handle<Thunk> ) override { unused(); }
+  Result<Value> evalStrict( Handle<Object> ) override { unused(); }
+  Result<ValueTree> mapEval( Handle<ObjectTree> ) override { unused(); }
+  Result<ObjectTree> mapReduce( Handle<ExpressionTree> ) override { unused(); }
+  Result<ValueTree> mapLift( Handle<ValueTree> ) override { unused(); }
+  Result<ObjectTree> mapEvalShallow( Handle<ObjectTree> ) override { unused(); }
+};
+
+void bench_force()
+{
+  const size_t relations = 4096;
+  RuntimeStorage storage;
+  CachedRuntime runtime( storage );
+  FixEvaluator evaluator( runtime );
+
+  vector<Handle<Thunk>> thunks;
+  for ( size_t i = 0; i < relations; i++ ) {
+    auto combination
+      = storage.construct_tree<ValueTree>( Handle<Literal>( "procedure" ), Handle<Literal>( uint64_t( i ) ) );
+    const auto relation = CachedRuntime::relation( Handle<ObjectTree>( combination ) );
+    storage.create( Handle<Literal>( uint64_t( i ) ), relation );
+    thunks.push_back( Handle<Application>( Handle<ExpressionTree>( combination ) ) );
+  }
+
+  for ( const size_t threads : thread_counts() ) {
+    measure( "FixEvaluator::force cached application", threads, 1 << 20, [&]( size_t, size_t begin, size_t end ) {
+      for ( size_t i = begin; i < end; i++ ) {
+        keep( evaluator.force( thunks[i % relations] ) );
+      }
+    } );
+  }
+}
+
+// The ELF named by a Runnable tag
+BlobData procedure_elf( Relater& rt, Handle<Value> tag )
+{
+  auto tree = rt.get( handle::extract<ValueTree>( tag ).value() ).value();
+  return rt.get( handle::extract<Named>( tree->at( 1 ) ).value() ).value();
+}
+
+void bench_programs()
+{
+  const string link = "link_program compile-encode";
+  const string execute = "Program::execute null procedure";
+  if ( link.find( filter ) == string::npos and execute.find( filter ) == string::npos ) {
+    return;
+  }
+
+  Relater rt;
+  if ( !rt.contains( "compile-encode" ) ) {
+    cerr << "Skipping " << link << " and " << execute << ": no compile-encode in the repository.\n";
+    return;
+  }
+
+  const auto compiler = procedure_elf( rt, handle::extract<Value>( rt.labeled( "compile-encode" ) ).value() );
+  measure( link, 1, 16, [&]( size_t, size_t begin, size_t end ) {
+    for ( size_t i = begin; i < end; i++ ) {
+      keep( link_program( compiler->span() ) );
+    }
+  } );
+
+  const auto null_wasm = file( rt, "testing/wasm-examples/null.wasm" );
+  const auto null_tag = rt.execute( Handle<Eval>( Handle<Object>( compile( rt, null_wasm ).unwrap<Thunk>() ) ) );
+  const auto program = link_program( procedure_elf( rt, null_tag )->span() );
+  const auto encode
+    = Handle<ObjectTree>( tree( rt, limits( rt, 1024 * 1024, 1024, 1 ), null_tag ).unwrap<ValueTree>() );
+  for ( const size_t threads : thread_counts() ) {
+    measure( execute, threads, 1 << 16, [&]( size_t, size_t begin, size_t end ) {
+      fixpoint::storage = &rt.get_storage();
+      for ( size_t i = begin; i < end; i++ ) {
+        resource_limits::available_bytes = 1024 * 1024;
+        keep( program->execute( encode ) );
+      }
+    } );
+  }
+}
+}
+
+int main( int argc, char* argv[] )
+{
+  if ( argc <= 0 ) {
+    abort();
+  }
+
+  OptionParser parser( "microbench", "Time the core runtime primitives in isolation" );
+  parser.AddOption( 'f',
+                    "filter",
+                    "substring",
+                    "Run only the benchmarks whose name contains <substring>.",
+                    [&]( const char* argument ) { filter = argument; } );
+  parser.AddOption( 'w',
+                    "warmup",
+                    "rounds",
+                    "Untimed rounds before each benchmark (default 2).",
+                    [&]( const char* argument ) { warmup = stoul( argument ); } );
+  parser.AddOption( 'r',
+                    "repeats",
+                    "rounds",
+                    "Timed rounds of each benchmark (default 10).",
+                    [&]( const char* argument ) { repeats = max<size_t>( 1, stoul( argument ) ); } );
+
+  google::InitGoogleLogging( argv[0] );
+
+  parser.Parse( argc, argv );
+
+  cout << std::format(
+    "{:<48} {:>7} {:>12} {:>12} {:>10}\n", "benchmark", "threads", "median ns", "best ns", "Mops/s" );
+  bench_create();
+  bench_fix_table();
+  bench_dependency_graph();
+  bench_channel();
+  bench_force();
+  bench_programs();
+
+  return 0;
+}
@@ -0,0 +1,166 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "eventloop.hh"
+#include "exception.hh"
+
+using namespace std;
+
+// Many threads notify a loop blocked in wait_next_event( -1 ), each waiting to see its notification handled; a lost
+// wakeup leaves one of them waiting forever.
+static void notify_while_waiting()
+{
+  EventLoop events;
+  atomic<uint64_t> requested = 0;
+  atomic<uint64_t> handled = 0;
+  atomic<bool> done = false;
+
+  events.add_rule(
+    "handle", [&] { handled = requested.load(); }, [&] { return handled < requested; } );
+
+  thread loop( [&] {
+    while ( not done ) {
+      events.wait_next_event( -1 );
+    }
+  } );
+
+  vector<thread> notifiers;
+  for ( size_t i = 0; i < 4; i++ ) {
+    notifiers.emplace_back( [&] {
+      for ( size_t j = 0; j < 50000; j++ ) {
+        const auto target = ++requested;
+        events.notify();
+        // mostly notify while the loop is busy handling earlier notifications
+        if ( j % 64 ) {
+          continue;
+        }
+        const auto deadline = chrono::steady_clock::now() + chrono::seconds( 10 );
+        while ( handled < target ) {
+          CHECK( chrono::steady_clock::now() < deadline ) << "notification lost";
+        }
+      }
+    } );
+  }
+  for ( auto& notifier : notifiers ) {
+    notifier.join();
+  }
+
+  done = true;
+  events.notify();
+  loop.join();
+}
+
+// Rules sharing an fd and direction are all served, and a Rearm::Explicit rule only re-arms the fds it names.
+static void shared_and_explicit_rules()
+{
+  int fds[2];
+  CheckSystemCall( "pipe", ::pipe( fds ) );
+  FileDescriptor reader( fds[0] ), writer( fds[1] );
+  reader.set_blocking( false );
+  writer.set_blocking( false );
+
+  EventLoop events;
+  size_t reads = 0;
+  bool peek = true;
+  events.add_rule( "read", reader, Direction::In, [&] {
+    char buffer[16];
+    reads += reader.read( buffer );
+  } );
+  events.add_rule(
+    "peek", reader, Direction::In, [&] { peek = false; }, [&] { return peek; } );
+
+  writer.write( "x" );
+  CHECK( events.wait_next_event( 1000 ) == EventLoop::Result::Success );
+  CHECK_EQ( reads, 1u );
+  CHECK( not peek );
+
+  bool write = false;
+  bool enable = false;
+  size_t writes = 0;
+  events.add_rule(
+    "write",
+    writer,
+    Direction::Out,
+    [&] {
+      writes += writer.write( "y" );
+      write = false;
+    },
+    [&] { return write; } );
+  events.add_rule(
+    "enable",
+    [&] {
+      enable = false;
+      write = true;
+    },
+    [&] { return enable; },
+    Rearm::Explicit );
+
+  // the new rules are evaluated at the next wait, when the write rule is not interested
+  writer.write( "x" );
+  CHECK( events.wait_next_event( 1000 ) == EventLoop::Result::Success );
+  CHECK_EQ( reads, 2u );
+
+  // ... and it is not re-evaluated after the enable rule runs, until its fd is named
+  enable = true;
+  CHECK( events.wait_next_event( 0 ) == EventLoop::Result::Success );
+  CHECK( write );
+  CHECK_EQ( writes, 0u );
+
+  events.interest_changed( writer );
+  CHECK( events.wait_next_event( 1000 ) == EventLoop::Result::Success );
+  CHECK_EQ( writes, 1u );
+}
+
+// Reading the timers of a loop idle in wait_next_event( -1 ) sees the rules it ran before going idle
+static void timers_while_idle()
+{
+  EventLoop events;
+  atomic<bool> requested = false;
+  atomic<bool> handled = false;
+  atomic<bool> done = false;
+
+  events.add_rule(
+    "once",
+    [&] {
+      requested = false;
+      handled = true;
+    },
+    [&] { return requested.load(); } );
+
+  thread loop( [&] {
+    while ( not done ) {
+      events.wait_next_event( -1 );
+    }
+  } );
+
+  requested = true;
+  events.notify();
+  while ( not handled ) {
+    this_thread::yield();
+  }
+
+  bool found = false;
+  for ( const auto& category : events.cumulative_timers() ) {
+    if ( category.name == "once" ) {
+      CHECK_EQ( category.timer.count, 1u );
+      found = true;
+    }
+  }
+  CHECK( found );
+
+  done = true;
+  events.notify();
+  loop.join();
+}
+
+void test( void )
+{
+  shared_and_explicit_rules();
+  timers_while_idle();
+  notify_while_waiting();
+}
@@ -0,0 +1,142 @@
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "fixpointapi.hh"
+#include "handle.hh"
+#include "runtimestorage.hh"
+
+using namespace std;
+
+const std::string de_bello_gallico
+  = "Gallia est omnis divisa in partes tres, quarum unam incolunt Belgae, aliam Aquitani, tertiam qui ipsorum "
+    "lingua Celtae, nostra Galli appellantur. Hi omnes lingua, institutis, legibus inter se differunt.";
+
+static Handle<Fix> fix( u8x32 content )
+{
+  return Handle<Fix>::forge( content );
+}
+
+static Handle<AnyTree> tree( Handle<Fix> handle )
+{
+  return handle::extract<ExpressionTree>( handle )
+    .transform( []( auto h ) -> Handle<AnyTree> { return h; } )
+    .or_else( [&]() -> optional<Handle<AnyTree>> { return handle::extract<ObjectTree>( handle ); } )
+    .or_else( [&]() -> optional<Handle<AnyTree>> { return handle::extract<ValueTree>( handle ); } )
+    .value();
+}
+
+// A slice has the contents and handle of the same bytes created on their own, and points into its parent
+static void blob_slice()
+{
+  RuntimeStorage storage;
+  RuntimeStorage reference;
+  fixpoint::storage = &storage;
+
+  auto parent = storage.create( de_bello_gallico ).unwrap<Named>();
+  auto parent_data = storage.get( parent );
+
+  const uint32_t offset = 16;
+  const uint32_t length = 64;
+  auto slice = fix( fixpoint::create_blob_slice( Handle<Blob>( parent ).into<Fix>().content, offset, length ) );
+  CHECK_EQ( slice, reference.create( de_bello_gallico.substr( offset, length ) ).into<Fix>() );
+
+  auto named = handle::extract<Named>( slice );
+  CHECK( named.has_value() );
+  CHECK_EQ( fixpoint::get_length( slice.content ), length );
+
+  auto data = storage.get( *named );
+  CHECK_EQ( string_view( data->span().data(), data->size() ), de_bello_gallico.substr( offset, length ) );
+  CHECK_EQ( data->span().data(), parent_data->span().data() + offset );
+
+  // Short slices are Literals, whether of a Named or of a Literal
+  auto literal = fix( fixpoint::create_blob_slice( Handle<Blob>( parent ).into<Fix>().content, offset, 8 ) );
+  CHECK( handle::extract<Literal>( literal ).has_value() );
+  CHECK_EQ( literal, reference.create( de_bello_gallico.substr( offset, 8 ) ).into<Fix>() );
+
+  auto short_parent = reference.create( de_bello_gallico.substr( 0, 16 ) );
+  auto short_slice = fix( fixpoint::create_blob_slice( short_parent.into<Fix>().content, 6, 4 ) );
+  CHECK_EQ( short_slice, reference.create( de_bello_gallico.substr( 6, 4 ) ).into<Fix>() );
+}
+
+// Each entry is the selection thunk create_selection_thunk makes for its index
+static void selection_thunks()
+{
+  RuntimeStorage storage;
+  fixpoint::storage = &storage;
+
+  auto parent = storage.construct_tree<ValueTree>(
+    "zero"_literal, storage.create( de_bello_gallico ).unwrap<Named>(), "two"_literal, "three"_literal );
+  const auto content = Handle<AnyTree>( parent ).visit<Handle<Fix>>( []( auto h ) { return h; } ).content;
+
+  auto selections = tree( fix( fixpoint::create_selection_thunks( content, 1, 3 ) ) );
+  CHECK( selections.visit<bool>( []( auto h ) { return std::is_same_v<decltype( h ), Handle<ObjectTree>>; } ) );
+  auto entries = storage.get( selections );
+  CHECK_EQ( entries->size(), 2 );
+  for ( uint32_t i = 1; i < 3; i++ ) {
+    CHECK_EQ( entries->at( i - 1 ), fix( fixpoint::create_selection_thunk( content, i ) ) );
+  }
+
+  auto empty = tree( fix( fixpoint::create_selection_thunks( content, 2, 2 ) ) );
+  CHECK_EQ( storage.get( empty )->size(), 0 );
+}
+
+// Each entry is the strict encode create_strict_encode makes of the thunk in its place
+static void strict_encodes()
+{
+  RuntimeStorage storage;
+  RuntimeStorage reference;
+  fixpoint::storage = &storage;
+
+  auto parent = storage.construct_tree<ValueTree>( "zero"_literal, "one"_literal, "two"_literal );
+  const auto content = Handle<AnyTree>( parent ).visit<Handle<Fix>>( []( auto h ) { return h; } ).content;
+  auto thunks = fix( fixpoint::create_selection_thunks( content, 0, 3 ) );
+
+  auto encodes = tree( fix( fixpoint::create_strict_encodes( thunks.content ) ) );
+  auto entries = storage.get( encodes );
+  auto expected = storage.get( tree( thunks ) );
+  CHECK_EQ( entries->size(), expected->size() );
+
+  vector<Handle<Fix>> encoded;
+  for ( size_t i = 0; i < expected->size(); i++ ) {
+    encoded.push_back( fix( fixpoint::create_strict_encode( expected->at( i ).content ) ) );
+    CHECK_EQ( entries->at( i ), encoded.back() );
+    CHECK( handle::extract<Strict>( entries->at( i ) ).has_value() );
+  }
+  CHECK_EQ( encodes, reference.create( encoded ) );
+}
+
+// A subtree has the handle of the same entries created on their own, and points into its parent
+static void subtree()
+{
+  RuntimeStorage storage;
+  RuntimeStorage reference;
+  fixpoint::storage = &storage;
+
+  auto parent = storage.construct_tree<ValueTree>(
+    "zero"_literal, storage.create( de_bello_gallico ).unwrap<Named>(), "two"_literal, "three"_literal );
+  auto parent_data = storage.get( parent );
+  const auto content = Handle<AnyTree>( parent ).visit<Handle<Fix>>( []( auto h ) { return h; } ).content;
+
+  auto sub = fix( fixpoint::create_subtree( content, 1, 3 ) );
+  CHECK_EQ( fixpoint::get_length( sub.content ), 2 );
+  CHECK_EQ( tree( sub ), reference.create( parent_data->span().subspan( 1, 2 ) ) );
+
+  auto data = storage.get( tree( sub ) );
+  CHECK_EQ( data->at( 0 ), parent_data->at( 1 ) );
+  CHECK_EQ( data->at( 1 ), parent_data->at( 2 ) );
+  CHECK_EQ( data->span().data(), parent_data->span().data() + 1 );
+
+  auto whole = fix( fixpoint::create_subtree( content, 0, 4 ) );
+  CHECK_EQ( tree( whole ), Handle<AnyTree>( parent ) );
+}
+
+void test( void )
+{
+  blob_slice();
+  selection_thunks();
+  strict_encodes();
+  subtree();
+}
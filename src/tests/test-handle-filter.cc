@@ -0,0 +1,53 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "handle_filter.hh"
+
+using namespace std;
+
+static Handle<Named> random_named( mt19937_64& rng )
+{
+  u64x4 words { rng(), rng(), rng(), 1024 };
+  return Handle<Named>::forge( (u8x32)words );
+}
+
+void test( void )
+{
+  mt19937_64 rng( 0 );
+
+  HandleFilter filter( 10000 );
+  CHECK_GE( filter.capacity(), 10000u );
+  vector<Handle<Named>> inserted;
+  for ( size_t i = 0; i < 10000; i++ ) {
+    inserted.push_back( random_named( rng ) );
+    filter.insert( inserted.back() );
+  }
+
+  for ( const auto& handle : inserted ) {
+    CHECK( filter.may_contain( handle ) );
+  }
+
+  size_t false_positives = 0;
+  for ( size_t i = 0; i < 10000; i++ ) {
+    false_positives += filter.may_contain( random_named( rng ) );
+  }
+  CHECK_LT( false_positives, 200u );
+
+  // A relation or tree with the same leading words is a different entry
+  CHECK( not filter.may_contain( Handle<Relation>::forge( inserted.front().content ) ) );
+
+  string serialized( filter.serialized_length(), 0 );
+  Serializer serializer { serialized };
+  filter.serialize( serializer );
+  Parser parser { serialized };
+  auto parsed = HandleFilter::parse( parser );
+  CHECK( not parser.error() );
+  for ( const auto& handle : inserted ) {
+    CHECK( parsed.may_contain( handle ) );
+  }
+
+  CHECK( not HandleFilter().may_contain( inserted.front() ) );
+}
@@ -1,7 +1,11 @@
 #include "handle.hh"
 #include "hash_table.hh"
 #include "runtimestorage.hh"
+#include <atomic>
 #include <glog/logging.h>
+#include <memory>
+#include <thread>
+#include <vector>
 
 using namespace std;
 
@@ -32,6 +36,85 @@ const string de_bello_gallico
     "Rheni, spectant in septentrionem et orientem solem. Aquitania a Garumna flumine ad Pyrenaeos montes et eam "
     "partem Oceani quae est ad Hispaniam pertinet; spectat inter occasum solis et septentriones.";
 
+// Threads racing to insert the same handles: exactly one insert of each succeeds
+static void concurrent_inserts()
+{
+  FixTable<Blob, size_t, AbslHash> table( 4096 );
+  atomic<size_t> inserted = 0;
+
+  vector<thread> threads;
+  for ( size_t i = 0; i < 4; i++ ) {
+    threads.emplace_back( [&, i] {
+      for ( size_t j = 0; j < 1000; j++ ) {
+        if ( table.insert( Handle<Blob>( Handle<Literal>( j ) ), i ) ) {
+          inserted++;
+        }
+      }
+    } );
+  }
+  for ( auto& thread : threads ) {
+    thread.join();
+  }
+
+  CHECK_EQ( inserted.load(), 1000u );
+  CHECK_EQ( table.size(), 1000u );
+  size_t visited = 0;
+  table.for_each( [&]( Handle<Blob> ) { visited++; } );
+  CHECK_EQ( visited, 1000u );
+}
+
+// Yields while being stored, so that inserts racing on a handle overlap even on a single core
+struct SlowValue
+{
+  shared_ptr<size_t> value {};
+
+  SlowValue() = default;
+  SlowValue( shared_ptr<size_t> v )
+    : value( move( v ) )
+  {}
+  SlowValue( const SlowValue& ) = default;
+  SlowValue& operator=( const SlowValue& other )
+  {
+    this_thread::yield();
+    value = other.value;
+    return *this;
+  }
+};
+
+// Of two inserts racing on the same handle, the loser's value is released rather than kept in an abandoned slot
+static void abandoned_values()
+{
+  FixTable<Blob, SlowValue, AbslHash> table( 4096 );
+  vector<vector<weak_ptr<size_t>>> offered( 2 );
+  atomic<size_t> ready = 0;
+
+  vector<thread> threads;
+  for ( size_t i = 0; i < offered.size(); i++ ) {
+    threads.emplace_back( [&, i] {
+      ready++;
+      while ( ready.load() < offered.size() ) {
+        this_thread::yield();
+      }
+      for ( size_t j = 0; j < 1000; j++ ) {
+        auto value = make_shared<size_t>( i );
+        offered[i].push_back( value );
+        table.insert( Handle<Blob>( Handle<Literal>( j ) ), SlowValue( move( value ) ) );
+      }
+    } );
+  }
+  for ( auto& thread : threads ) {
+    thread.join();
+  }
+
+  for ( size_t j = 0; j < 1000; j++ ) {
+    auto kept = table.get( Handle<Blob>( Handle<Literal>( j ) ) ).value().value;
+    for ( const auto& values : offered ) {
+      auto value = values[j].lock();
+      CHECK( !value or value == kept );
+    }
+  }
+}
+
 void test( void )
 {
   FixTable<Blob, string, AbslHash> test_table( 10 );
@@ -48,4 +131,14 @@ void test( void )
 
   test_table.insert( Handle<Blob>( Handle<Literal>( "one" ) ), de_bello_gallico );
   CHECK_EQ( test_table.get( Handle<Blob>( Handle<Literal>( "one" ) ) ).value(), aeneid );
+
+  size_t visited = 0;
+  test_table.for_each( [&]( Handle<Blob> h ) {
+    CHECK( test_table.contains( h ) );
+    visited++;
+  } );
+  CHECK_EQ( visited, 2u );
+
+  concurrent_inserts();
+  abandoned_values();
 }
@@ -0,0 +1,167 @@
+#include <chrono>
+#include <csignal>
+#include <memory>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include "handle.hh"
+#include "handle_util.hh"
+#include "interface.hh"
+#include "network.hh"
+#include "runtimestorage.hh"
+
+using namespace std;
+
+static constexpr size_t PEERS = 4;
+static constexpr uint16_t PORT = 12410;
+
+const std::string contents( 65536, 'r' );
+
+static BlobData relayed_blob()
+{
+  return make_shared<OwnedBlob>( span<const char>( contents ), AllocationType::Static );
+}
+
+// Answers every relation with whether it held the relayed blob when asked
+class RelayRuntime : public MultiWorkerRuntime
+{
+  RuntimeStorage storage_ {};
+  Handle<Named> blob_;
+
+public:
+  RelayRuntime()
+    : blob_( handle::create( relayed_blob() ).unwrap<Named>() )
+  {}
+
+  Handle<Named> blob() const { return blob_; }
+
+  optional<BlobData> get( Handle<Named> name ) override { return storage_.get( name ); };
+  optional<TreeData> get( Handle<AnyTree> name ) override { return storage_.get( name ); };
+  optional<Handle<Object>> get( Handle<Relation> name ) override
+  {
+    if ( storage_.contains( name ) ) {
+      return storage_.get( name );
+    }
+    return Handle<Object>( storage_.contains( blob_ ) ? 1_literal64 : 0_literal64 );
+  };
+  optional<Handle<AnyTree>> get_handle( Handle<AnyTree> name ) override { return storage_.get_handle( name ); };
+  virtual std::optional<TreeData> get_shallow( Handle<AnyTree> name ) override
+  {
+    return storage_.get_shallow( name );
+  };
+
+  void put( Handle<Named> name, BlobData data ) override { storage_.create( data, name ); }
+  void put( Handle<AnyTree> name, TreeData data ) override { storage_.create( data, name ); }
+  void put_shallow( Handle<AnyTree> name, TreeData data ) override { storage_.create_tree_shallow( data, name ); }
+  void put( Handle<Relation> name, Handle<Object> data ) override { storage_.create( data, name ); }
+
+  bool contains( Handle<Named> handle ) override { return storage_.contains( handle ); }
+  bool contains( Handle<AnyTree> handle ) override { return storage_.contains( handle ); }
+  bool contains_shallow( Handle<AnyTree> handle ) override { return storage_.contains_shallow( handle ); }
+  bool contains( Handle<Relation> handle ) override { return storage_.contains( handle ); }
+
+  virtual void add_worker( std::shared_ptr<IRuntime> ) override {}
+};
+
+static Address peer_address( size_t i )
+{
+  return Address( "127.0.0.1", PORT + i );
+}
+
+static Handle<Relation> job_for( size_t i )
+{
+  return Handle<Eval>( Handle<Object>( Handle<Literal>( uint64_t( i ) ) ) );
+}
+
+// Each peer connects to the ones before it, so they can all forward to one another
+[[noreturn]] static void peer( size_t index )
+{
+  RelayRuntime rt;
+  NetworkWorker nw( rt );
+  nw.start();
+  nw.start_server( peer_address( index ) );
+  for ( size_t i = 0; i < index; i++ ) {
+    nw.connect( peer_address( i ) );
+    nw.get_remote( peer_address( i ) );
+  }
+
+  while ( true ) {
+    pause();
+  }
+}
+
+// Relays the blob to the first peer for the others, then runs a job on each. The jobs on the peers the blob was
+// relayed to are held back until they report holding it; each job has to come back, and find the blob there.
+static bool origin()
+{
+  RelayRuntime rt;
+  rt.put( rt.blob(), relayed_blob() );
+
+  NetworkWorker nw( rt );
+  nw.start();
+  vector<shared_ptr<IRuntime>> remotes;
+  for ( size_t i = 0; i < PEERS; i++ ) {
+    nw.connect( peer_address( i ) );
+    remotes.push_back( nw.get_remote( peer_address( i ) ) );
+  }
+
+  // Let the last peers learn each other's node ids
+  sleep( 1 );
+
+  const vector<shared_ptr<IRuntime>> peers( remotes.begin() + 1, remotes.end() );
+  if ( not remotes.front()->relay( rt.blob(), peers ) ) {
+    LOG( ERROR ) << "Could not relay";
+    nw.stop();
+    return false;
+  }
+
+  for ( size_t i = 0; i < PEERS; i++ ) {
+    remotes[i]->get( job_for( i ) );
+  }
+
+  bool ok = true;
+  const auto deadline = chrono::steady_clock::now() + chrono::seconds( 10 );
+  for ( size_t i = 0; i < PEERS; i++ ) {
+    while ( not rt.contains( job_for( i ) ) and chrono::steady_clock::now() < deadline ) {
+      this_thread::sleep_for( chrono::milliseconds( 10 ) );
+    }
+    if ( not rt.contains( job_for( i ) ) ) {
+      LOG( ERROR ) << "No result from peer " << i;
+      ok = false;
+    } else if ( rt.get( job_for( i ) ) != Handle<Object>( 1_literal64 ) ) {
+      LOG( ERROR ) << "Peer " << i << " ran its job without the blob";
+      ok = false;
+    }
+  }
+
+  nw.stop();
+  return ok;
+}
+
+void test( void )
+{
+  // Forked before anything asks for this process's node id, so each node gets its own
+  vector<pid_t> pids;
+  for ( size_t i = 0; i < PEERS; i++ ) {
+    const pid_t pid = fork();
+    CHECK( pid >= 0 );
+    if ( pid == 0 ) {
+      peer( i );
+    }
+    pids.push_back( pid );
+    // Let each peer listen before the next one connects to it
+    usleep( 200000 );
+  }
+
+  const bool ok = origin();
+
+  for ( const auto pid : pids ) {
+    kill( pid, SIGKILL );
+    waitpid( pid, nullptr, 0 );
+  }
+  CHECK( ok );
+}
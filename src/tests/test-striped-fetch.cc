@@ -0,0 +1,79 @@
+#include <cstring>
+#include <string>
+
+#include <glog/logging.h>
+
+#include "handle_util.hh"
+#include "striped_fetch.hh"
+
+using namespace std;
+
+static BlobData make_blob( size_t size, char seed )
+{
+  auto blob = OwnedMutBlob::allocate( size );
+  for ( size_t i = 0; i < size; i++ ) {
+    blob[i] = seed + i * 31;
+  }
+  return make_shared<OwnedBlob>( std::move( blob ) );
+}
+
+static string_view range( const BlobData& blob, const StripedFetches::Stripe& stripe )
+{
+  return { blob->data() + stripe.offset, stripe.length };
+}
+
+void test( void )
+{
+  const auto blob = make_blob( 3 * StripedFetches::THRESHOLD + 123, 'a' );
+  const auto name = handle::extract<Named>( handle::create( blob ) ).value();
+
+  // Small blobs, or a single replica, are fetched whole
+  StripedFetches fetches;
+  CHECK( not fetches.start( handle::extract<Named>( handle::create( make_blob( 1 << 20, 'b' ) ) ).value(),
+                            {},
+                            { 0, 1, 2 } ) );
+  CHECK( not fetches.start( name, {}, { 0 } ) );
+
+  // Stripes cover the blob exactly once, one per replica
+  auto stripes = fetches.start( name, {}, { 4, 5, 6 } ).value();
+  CHECK_EQ( stripes.size(), 3u );
+  uint64_t covered = 0;
+  for ( size_t i = 0; i < stripes.size(); i++ ) {
+    CHECK_EQ( stripes[i].offset, covered );
+    CHECK_EQ( stripes[i].replica, 4 + i );
+    covered += stripes[i].length;
+  }
+  CHECK_EQ( covered, blob->size() );
+
+  // A second request while in flight is absorbed
+  CHECK( fetches.start( name, {}, { 4, 5, 6 } ).value().empty() );
+
+  // Stripes may arrive in any order; the last one completes the fetch
+  CHECK( holds_alternative<monostate>( fetches.receive( name, stripes[2].offset, range( blob, stripes[2] ) ) ) );
+  CHECK( holds_alternative<monostate>( fetches.receive( name, stripes[0].offset, range( blob, stripes[0] ) ) ) );
+  auto outcome = fetches.receive( name, stripes[1].offset, range( blob, stripes[1] ) );
+  CHECK( holds_alternative<StripedFetches::Complete>( outcome ) );
+  const auto& fetched = get<StripedFetches::Complete>( outcome ).blob;
+  CHECK_EQ( fetched->size(), blob->size() );
+  CHECK_EQ( memcmp( fetched->data(), blob->data(), blob->size() ), 0 );
+
+  // Corrupted data is caught by the hash and the fetch falls back to a whole request, once
+  stripes = fetches.start( name, {}, { 4, 5 } ).value();
+  auto corrupted = string( range( blob, stripes[0] ) );
+  corrupted[0] ^= 1;
+  fetches.receive( name, stripes[0].offset, corrupted );
+  CHECK( holds_alternative<StripedFetches::Fallback>(
+    fetches.receive( name, stripes[1].offset, range( blob, stripes[1] ) ) ) );
+  CHECK( not fetches.start( name, {}, { 4, 5 } ) );
+
+  // A replica without the blob, or one that goes away, abandons the fetch
+  stripes = fetches.start( name, {}, { 4, 5 } ).value();
+  CHECK( holds_alternative<StripedFetches::Fallback>( fetches.receive( name, stripes[0].offset, "" ) ) );
+  CHECK( holds_alternative<monostate>( fetches.receive( name, stripes[1].offset, range( blob, stripes[1] ) ) ) );
+  CHECK( not fetches.start( name, {}, { 4, 5 } ) );
+
+  stripes = fetches.start( name, {}, { 4, 5 } ).value();
+  CHECK_EQ( fetches.abandon( 7 ).size(), 0u );
+  CHECK_EQ( fetches.abandon( 5 ).size(), 1u );
+  CHECK( not fetches.start( name, {}, { 4, 5 } ) );
+}
@@ -0,0 +1,133 @@
+#include <format>
+#include <sstream>
+
+#include <glog/logging.h>
+
+#include "dependency_graph.hh"
+#include "handle.hh"
+#include "trace.hh"
+#include "trace_analysis.hh"
+
+using namespace std;
+
+static string event( const char* name, const char* phase, double ts, size_t tid, uint64_t id, string args )
+{
+  return std::format( "{{\"name\":\"{}\",\"cat\":\"task\",\"ph\":\"{}\",\"ts\":{:.3f},\"pid\":0,\"tid\":{},"
+                      "\"id\":\"{:#x}\",\"args\":{{\"handle\":\"{:x}\"{}}}}},\n",
+                      name,
+                      phase,
+                      ts,
+                      tid,
+                      id,
+                      id,
+                      args );
+}
+
+// Relation 0xa runs on thread 0, then blocks on relation 0xb and on data 0xd. Relation 0xb applies procedure P on
+// thread 1 and finishes at 40; 0xa resumes and finishes at 60.
+static string job( double loaded )
+{
+  string trace = "{\"traceEvents\":[\n";
+  trace += event( "relation", "b", 0, 0, 0xa, "" );
+  trace += event( "progress", "B", 0, 0, 0xa, "" );
+  trace += event( "relation", "b", 0, 1, 0xc, "" );
+  trace += event( "progress", "B", 0, 1, 0xc, "" );
+  trace += event( "progress", "E", 5, 1, 0xc, "" );
+  trace += event( "relation", "e", 5, 1, 0xc, "" );
+  trace += event( "blocked", "n", 10, 0, 0xa, ",\"on\":\"0xb\"" );
+  trace += event( "blocked", "n", 10, 0, 0xa, ",\"on\":\"0xd\"" );
+  trace += event( "progress", "E", 10, 0, 0xa, "" );
+  trace += event( "relation", "b", 12, 1, 0xb, "" );
+  trace += event( "progress", "B", 12, 1, 0xb, "" );
+  trace += event( "apply", "B", 15, 1, 0xf, ",\"procedure\":\"P\"" );
+  trace += event( "apply", "E", 35, 1, 0xf, "" );
+  trace += event( "progress", "E", 40, 1, 0xb, "" );
+  trace += event( "relation", "e", 40, 1, 0xb, "" );
+  trace += event( "loaded", "i", loaded, 2, 0xd, "" );
+  trace += event( "relation", "b", 41, 0, 0xa, "" );
+  trace += event( "progress", "B", 45, 0, 0xa, "" );
+  trace += event( "progress", "E", 60, 0, 0xa, "" );
+  trace += event( "relation", "e", 60, 0, 0xa, "" );
+  trace += "]}\n";
+  return trace;
+}
+
+void test( void )
+{
+  {
+    istringstream trace( job( 25 ) );
+    TraceAnalysis analysis( trace );
+    CHECK_EQ( analysis.makespan(), 60 );
+    CHECK_EQ( analysis.threads(), 3u );
+    CHECK_EQ( analysis.node( 0xa ).dependencies.size(), 2u );
+
+    // The relation finishing last gated the final step
+    const auto& path = analysis.critical_path();
+    CHECK_EQ( path.size(), 2u );
+    CHECK_EQ( path[0].node, 0xbu );
+    CHECK_EQ( path[0].interval.begin, 12 );
+    CHECK_EQ( path[0].executed, 28 );
+    CHECK_EQ( path[0].queued, 0 );
+    CHECK_EQ( path[1].node, 0xau );
+    CHECK_EQ( path[1].executed, 15 );
+    CHECK_EQ( path[1].queued, 5 );
+
+    const auto procedures = analysis.top_procedures( 10 );
+    CHECK_EQ( procedures.size(), 1u );
+    CHECK_EQ( procedures[0].first, "P" );
+    CHECK_EQ( procedures[0].second, 20 );
+    CHECK( analysis.top_transfers( 10 ).empty() );
+
+    const auto profile = analysis.parallelism( 2 );
+    CHECK_EQ( profile.size(), 2u );
+    CHECK_LT( abs( profile[0] - 33.0 / 30 ), 1e-9 );
+    CHECK_LT( abs( profile[1] - 25.0 / 30 ), 1e-9 );
+  }
+
+  {
+    // Data arriving after the relation makes the load the critical step
+    istringstream trace( job( 50 ) );
+    TraceAnalysis analysis( trace );
+    const auto& path = analysis.critical_path();
+    CHECK_EQ( path.size(), 2u );
+    CHECK_EQ( path[0].node, 0xdu );
+    CHECK( analysis.node( 0xd ).data );
+    CHECK_EQ( path[0].interval.begin, 10 );
+    CHECK_EQ( path[0].transfer, 40 );
+    CHECK_EQ( path[1].executed, 10 );
+    CHECK_EQ( path[1].queued, 0 );
+
+    const auto transfers = analysis.top_transfers( 10 );
+    CHECK_EQ( transfers.size(), 1u );
+    CHECK_EQ( transfers[0].second, 40 );
+  }
+
+  {
+    // The edges the dependency graph traces are recovered from the written trace
+    Handle otree = Handle<ObjectTree>::nil();
+    Handle application = Handle<Thunk>( Handle<Application>( Handle<ExpressionTree>( otree ) ) );
+    DependencyGraph::Task outer = Handle<Think>( application );
+    DependencyGraph::Task inner = Handle<Eval>( Handle<Object>( "foo"_literal ) );
+
+    global_tracer().enable();
+    DependencyGraph graph;
+    absl::flat_hash_set<DependencyGraph::Task> ready;
+    CHECK( graph.start( outer ) );
+    graph.add_dependency( outer, inner );
+    CHECK( graph.start( inner ) );
+    graph.finish( inner, ready );
+    CHECK( ready.contains( outer ) );
+    CHECK( graph.start( outer ) );
+    graph.finish( outer, ready );
+    global_tracer().disable();
+
+    stringstream trace;
+    global_tracer().write_json( trace );
+    TraceAnalysis analysis( trace );
+    const auto& path = analysis.critical_path();
+    CHECK_EQ( path.size(), 2u );
+    CHECK( analysis.node( path[0].node ).dependencies.empty() );
+    CHECK_EQ( analysis.node( path[1].node ).dependencies.size(), 1u );
+    CHECK_EQ( analysis.node( path[1].node ).dependencies[0], path[0].node );
+  }
+}
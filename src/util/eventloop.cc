@@ -3,18 +3,26 @@
 #include "socket.hh"
 #include "timer.hh"
 
+#include <array>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <sys/eventfd.h>
+#include <unistd.h>
 
 using namespace std;
 
 EventLoop::EventLoop()
   : _rule_categories()
+  , _epoll( CheckSystemCall( "epoll_create1", ::epoll_create1( EPOLL_CLOEXEC ) ) )
+  , _wakeup( CheckSystemCall( "eventfd", ::eventfd( 0, EFD_NONBLOCK | EFD_CLOEXEC ) ) )
 {
   _rule_categories.reserve( 64 );
   // prevent _rule_categories from being reallocated in middle of wait_next_event
   // (if a rule adds a new category)
+
+  epoll_event event { .events = EPOLLIN, .data = { .fd = _wakeup.fd_num() } };
+  CheckSystemCall( "epoll_ctl", ::epoll_ctl( _epoll.fd_num(), EPOLL_CTL_ADD, _wakeup.fd_num(), &event ) );
 }
 
 unsigned int EventLoop::FDRule::service_count() const
@@ -34,11 +42,13 @@ size_t EventLoop::add_category( const string& name )
 
 EventLoop::BasicRule::BasicRule( const size_t s_category_id,
                                  const InterestT& s_interest,
-                                 const CallbackT& s_callback )
+                                 const CallbackT& s_callback,
+                                 const Rearm s_rearm )
   : category_id( s_category_id )
   , interest( s_interest )
   , callback( s_callback )
   , cancel_requested( false )
+  , rearm( s_rearm )
 {}
 
 EventLoop::FDRule::FDRule( BasicRule&& base,
@@ -65,23 +75,43 @@ EventLoop::RuleHandle EventLoop::add_rule( const size_t category_id,
     throw out_of_range( "bad category_id" );
   }
 
-  _fd_rules.emplace_back( make_shared<FDRule>(
-    BasicRule { category_id, interest, callback }, fd.duplicate(), direction, cancel, recover ) );
+  auto rule = make_shared<FDRule>(
+    BasicRule { category_id, interest, callback }, fd.duplicate(), direction, cancel, recover );
 
-  return _fd_rules.back();
+  auto& registration = _registrations[fd.fd_num()];
+  // the fd number was closed and reused before its rules were removed; the kernel has already dropped it from epoll
+  std::erase_if( registration.rules, [&]( FDRule* other ) {
+    if ( not other->fd.closed() ) {
+      return false;
+    }
+    _armed_rules -= other->armed;
+    other->armed = false;
+    other->cancel_requested = true;
+    _sweep_needed = true;
+    return true;
+  } );
+  registration.rules.push_back( rule.get() );
+
+  // start unarmed: errors are still reported, and interest is evaluated by the next wait_next_event
+  update_registration( fd.fd_num(), registration );
+  mark_dirty( fd.fd_num() );
+
+  _fd_rules.emplace_back( move( rule ) );
+  return { _fd_rules.back(), this };
 }
 
 EventLoop::RuleHandle EventLoop::add_rule( const size_t category_id,
                                            const CallbackT& callback,
-                                           const InterestT& interest )
+                                           const InterestT& interest,
+                                           const Rearm rearm )
 {
   if ( category_id >= _rule_categories.size() ) {
     throw out_of_range( "bad category_id" );
   }
 
-  _non_fd_rules.emplace_back( make_shared<BasicRule>( category_id, interest, callback ) );
+  _non_fd_rules.emplace_back( make_shared<BasicRule>( category_id, interest, callback, rearm ) );
 
-  return _non_fd_rules.back();
+  return { _non_fd_rules.back(), this };
 }
 
 void EventLoop::RuleHandle::cancel()
@@ -89,162 +119,332 @@ void EventLoop::RuleHandle::cancel()
   const shared_ptr<BasicRule> rule_shared_ptr = rule_weak_ptr_.lock();
   if ( rule_shared_ptr ) {
     rule_shared_ptr->cancel_requested = true;
+    // the rule is still alive, so its loop is too
+    loop_->_sweep_needed = true;
   }
 }
 
-EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
+void EventLoop::update_registration( const int fd_num, Registration& registration )
 {
-  // first, handle the non-file-descriptor-related rules
-  {
-    for ( auto it = _non_fd_rules.begin(); it != _non_fd_rules.end(); ) {
-      auto& this_rule = **it;
-      bool rule_fired = false;
+  uint32_t events = 0;
+  for ( const FDRule* rule : registration.rules ) {
+    events |= rule->armed ? static_cast<uint32_t>( rule->direction ) : 0;
+  }
 
-      if ( this_rule.cancel_requested ) {
-        it = _non_fd_rules.erase( it );
-        continue;
-      }
+  epoll_event event { .events = events, .data = { .fd = fd_num } };
+  if ( ::epoll_ctl( _epoll.fd_num(), EPOLL_CTL_MOD, fd_num, &event ) == -1 ) {
+    if ( errno != ENOENT ) {
+      throw unix_error( "epoll_ctl" );
+    }
+    CheckSystemCall( "epoll_ctl", ::epoll_ctl( _epoll.fd_num(), EPOLL_CTL_ADD, fd_num, &event ) );
+  }
+  registration.events = events;
+}
 
-      uint16_t iterations = 0;
-      while ( this_rule.interest() ) {
-        if ( ++iterations >= 32768 ) {
-          throw runtime_error( "EventLoop: busy wait detected: rule \""
-                               + _rule_categories.at( this_rule.category_id ).name + "\" is still interested after "
-                               + to_string( iterations ) + " iterations" );
-        }
+void EventLoop::arm( FDRule& rule, const bool interested )
+{
+  if ( rule.armed == interested ) {
+    return;
+  }
+  rule.armed = interested;
+  interested ? _armed_rules++ : _armed_rules--;
 
-        rule_fired = true;
-        MultiTimer<Timer::Category::Nonblock> record_timer {
-          _rule_categories.at( this_rule.category_id ).timer,
-          _rule_categories.at( this_rule.category_id ).timer_cumulative };
-        this_rule.callback();
-      }
+  auto& registration = _registrations.at( rule.fd.fd_num() );
+  const auto direction = static_cast<uint32_t>( rule.direction );
+  if ( static_cast<bool>( registration.events & direction ) != interested ) {
+    update_registration( rule.fd.fd_num(), registration );
+  }
+}
 
-      if ( rule_fired ) {
-        return Result::Success; /* only serve one rule on each iteration */
-      }
+void EventLoop::deregister( FDRule& rule )
+{
+  _armed_rules -= rule.armed;
+  rule.armed = false;
 
-      ++it;
-    }
+  auto it = _registrations.find( rule.fd.fd_num() );
+  if ( it == _registrations.end() or std::erase( it->second.rules, &rule ) == 0 ) {
+    // already removed, or the registration has been taken over by a new fd with the same number
+    return;
+  }
+
+  auto& registration = it->second;
+  if ( not registration.rules.empty() ) {
+    update_registration( rule.fd.fd_num(), registration );
+    return;
+  }
+
+  // fails harmlessly if the fd has already been closed
+  ::epoll_ctl( _epoll.fd_num(), EPOLL_CTL_DEL, rule.fd.fd_num(), nullptr );
+  if ( registration.dirty ) {
+    std::erase( _dirty, rule.fd.fd_num() );
   }
+  _registrations.erase( it );
+}
+
+void EventLoop::mark_dirty( const int fd_num )
+{
+  auto it = _registrations.find( fd_num );
+  if ( it != _registrations.end() and not it->second.dirty ) {
+    it->second.dirty = true;
+    _dirty.push_back( fd_num );
+  }
+}
+
+void EventLoop::notify()
+{
+  if ( not _wakeup_pending.exchange( true ) ) {
+    const uint64_t one = 1;
+    CheckSystemCall( "write", ::write( _wakeup.fd_num(), &one, sizeof( one ) ) );
+  }
+}
+
+void EventLoop::publish_timers()
+{
+  const uint64_t now = Timer::read_tsc();
+  if ( not _publish_requested.load( memory_order_relaxed ) and now - _last_published < PUBLISH_INTERVAL ) {
+    return;
+  }
+  _publish_requested = false;
+  _last_published = now;
+
+  vector<CategoryTotal> totals;
+  totals.reserve( _rule_categories.size() + 1 );
+  for ( const auto& category : _rule_categories ) {
+    totals.push_back( { category.name, category.timer_cumulative } );
+  }
+  totals.push_back( { "Waiting for event", _waiting_cumulative } );
+
+  unique_lock lock( _published_mutex );
+  _published = move( totals );
+  _publications++;
+  _published_cv.notify_all();
+}
 
-  // now the file-descriptor-related rules. poll any "interested" file descriptors
-  vector<pollfd> pollfds {};
-  pollfds.reserve( _fd_rules.size() );
-  bool something_to_poll = false;
+vector<EventLoop::CategoryTotal> EventLoop::cumulative_timers()
+{
+  unique_lock lock( _published_mutex );
+  const auto publications = _publications;
+  lock.unlock();
+
+  _publish_requested = true;
+  notify();
+
+  lock.lock();
+  _published_cv.wait_for( lock, PUBLISH_WAIT, [&] { return _publications != publications; } );
+  return _published;
+}
+
+EventLoop::Result EventLoop::wait_next_event( const int timeout_ms )
+{
+  bool rule_fired = false;
+
+  publish_timers();
 
-  // set up the pollfd for each rule
-  for ( auto it = _fd_rules.begin(); it != _fd_rules.end(); ) { // NOTE: it gets erased or incremented in loop body
+  // first, handle the non-file-descriptor-related rules
+  for ( auto it = _non_fd_rules.begin(); it != _non_fd_rules.end(); ) {
     auto& this_rule = **it;
 
     if ( this_rule.cancel_requested ) {
-      //      this_rule.cancel();
+      it = _non_fd_rules.erase( it );
+      continue;
+    }
+
+    uint16_t iterations = 0;
+    while ( this_rule.interest() ) {
+      if ( ++iterations >= 32768 ) {
+        throw runtime_error( "EventLoop: busy wait detected: rule \""
+                             + _rule_categories.at( this_rule.category_id ).name + "\" is still interested after "
+                             + to_string( iterations ) + " iterations" );
+      }
+
+      rule_fired = true;
+      MultiTimer<Timer::Category::Nonblock> record_timer {
+        _rule_categories.at( this_rule.category_id ).timer,
+        _rule_categories.at( this_rule.category_id ).timer_cumulative };
+      this_rule.callback();
+      _all_dirty |= this_rule.rearm == Rearm::All;
+    }
+
+    ++it;
+  }
+
+  // now the file-descriptor-related rules: re-arm those whose interest may have changed...
+  const auto retire = [&]( FDRule& rule ) {
+    if ( rule.cancel_requested ) {
+      //      rule.cancel();
       //      if rule is cancelled externally, no need to call the cancellation callback
       //      this makes it easier to cancel rules and delete captured objects right away
-      it = _fd_rules.erase( it );
-      continue;
+      deregister( rule );
+      return true;
     }
 
-    if ( this_rule.direction == Direction::In && this_rule.fd.eof() ) {
-      // no more reading on this rule, it's reached eof
-      this_rule.cancel();
-      it = _fd_rules.erase( it );
-      return Result::Success;
+    if ( ( rule.direction == Direction::In && rule.fd.eof() ) or rule.fd.closed() ) {
+      // no more reading on this rule, it's reached eof (or the fd is gone altogether)
+      rule.cancel();
+      rule.cancel_requested = true;
+      deregister( rule );
+      rule_fired = true;
+      return true;
     }
 
-    if ( this_rule.fd.closed() ) {
-      this_rule.cancel();
-      it = _fd_rules.erase( it );
-      return Result::Success;
+    return false;
+  };
+
+  if ( not _all_dirty ) {
+    for ( const int fd_num : exchange( _dirty, {} ) ) {
+      const auto registration = _registrations.find( fd_num );
+      if ( registration == _registrations.end() ) {
+        continue;
+      }
+      registration->second.dirty = false;
+      // copy the rules, since retiring one removes it from the registration
+      for ( FDRule* rule : vector<FDRule*>( registration->second.rules ) ) {
+        if ( retire( *rule ) ) {
+          _sweep_needed = true;
+        } else {
+          arm( *rule, rule->interest() );
+        }
+      }
     }
+  }
 
-    if ( this_rule.interest() ) {
-      pollfds.push_back( { this_rule.fd.fd_num(), static_cast<short>( this_rule.direction ), 0 } );
-      something_to_poll = true;
-    } else {
-      pollfds.push_back( { this_rule.fd.fd_num(), 0, 0 } ); // placeholder --- we still want errors
+  // ... and when needed, go through all of them to drop the finished ones (and re-arm the rest)
+  if ( _all_dirty or _sweep_needed ) {
+    // NOTE: it gets erased or incremented in loop body
+    for ( auto it = _fd_rules.begin(); it != _fd_rules.end(); ) {
+      auto& this_rule = **it;
+      if ( retire( this_rule ) ) {
+        it = _fd_rules.erase( it );
+        continue;
+      }
+      if ( _all_dirty ) {
+        arm( this_rule, this_rule.interest() );
+      }
+      ++it;
     }
-    ++it;
+    for ( const int fd_num : _dirty ) {
+      _registrations.at( fd_num ).dirty = false;
+    }
+    _dirty.clear();
+    _all_dirty = false;
+    _sweep_needed = false;
   }
 
-  // quit if there is nothing left to poll
-  if ( not something_to_poll ) {
+  // quit if there is nothing left to wait for
+  if ( _armed_rules == 0 and not rule_fired and _non_fd_rules.empty() ) {
     return Result::Exit;
   }
 
-  // call poll -- wait until one of the fds satisfies one of the rules (writeable/readable)
+  // call epoll_wait -- wait until one of the fds satisfies one of the rules (writeable/readable), or until notified.
+  // If a rule already fired, only collect the fds that are ready now, so that its effects are seen promptly.
+  array<epoll_event, 64> ready_events;
+  int ready_count = 0;
   {
     MultiTimer<Timer::Category::WaitingForEvent> record_timer { _waiting, _waiting_cumulative };
-    if ( 0 == CheckSystemCall( "poll", ::poll( pollfds.data(), pollfds.size(), timeout_ms ) ) ) {
-      return Result::Timeout;
+    ready_count
+      = ::epoll_wait( _epoll.fd_num(), ready_events.data(), ready_events.size(), rule_fired ? 0 : timeout_ms );
+    if ( ready_count == -1 ) {
+      if ( errno != EINTR ) {
+        throw unix_error( "epoll_wait" );
+      }
+      ready_count = 0;
     }
   }
 
-  // go through the poll results
-  for ( auto [it, idx] = make_pair( _fd_rules.begin(), size_t( 0 ) ); it != _fd_rules.end(); ++idx ) {
-    const auto& this_pollfd = pollfds.at( idx );
-    auto& this_rule = **it;
+  if ( ready_count == 0 ) {
+    if ( rule_fired ) {
+      return Result::Success;
+    }
+    // an interest may depend on the time (e.g. a rate limit), so re-evaluate them all after a timeout
+    _all_dirty = true;
+    return Result::Timeout;
+  }
 
-    const auto poll_error = static_cast<bool>( this_pollfd.revents & ( POLLERR | POLLNVAL ) );
-    if ( poll_error ) {
-      /* recoverable error? */
-      if ( not static_cast<bool>( this_pollfd.revents & POLLNVAL ) ) {
-        if ( this_rule.recover() ) {
-          ++it;
-          continue;
-        }
+  // go through the ready registrations; rules are only erased above, so the pointers stay valid throughout
+  for ( const auto& event : span( ready_events.data(), ready_count ) ) {
+    if ( event.data.fd == _wakeup.fd_num() ) {
+      // Drain the eventfd before clearing the flag: a notify() in between then either sees the flag still set (and
+      // its change is seen by the non-fd rules of the next call), or writes again and wakes the next call.
+      uint64_t count;
+      while ( ::read( _wakeup.fd_num(), &count, sizeof( count ) ) != -1 ) {}
+      if ( errno != EAGAIN and errno != EINTR ) {
+        throw unix_error( "read" );
       }
+      _wakeup_pending = false;
+      continue;
+    }
+
+    const auto registration = _registrations.find( event.data.fd );
+    if ( registration == _registrations.end() ) {
+      continue;
+    }
+    // copy the rules, since callbacks may add rules; rules are only erased above, so the pointers stay valid
+    const vector<FDRule*> rules = registration->second.rules;
+    // whatever happens to them, the interest of this fd's rules is re-evaluated before the next wait
+    mark_dirty( event.data.fd );
 
-      /* see if fd is a socket */
-      int socket_error = 0;
-      socklen_t optlen = sizeof( socket_error );
-      const int ret = getsockopt( this_rule.fd.fd_num(), SOL_SOCKET, SO_ERROR, &socket_error, &optlen );
-      if ( ret == -1 and errno == ENOTSOCK ) {
-        cerr << "error on polled file descriptor for rule \"" << _rule_categories.at( this_rule.category_id ).name
-             << "\"\n";
-      } else if ( ret == -1 ) {
-        throw unix_error( "getsockopt" );
-      } else if ( optlen != sizeof( socket_error ) ) {
-        throw runtime_error( "unexpected length from getsockopt: " + to_string( optlen ) );
-      } else if ( socket_error ) {
-        cerr << "error on polled socket for rule \"" << _rule_categories.at( this_rule.category_id ).name
-             << "\": " << strerror( socket_error ) << "\n";
+    for ( FDRule* rule : rules ) {
+      if ( rule->cancel_requested ) {
+        continue;
       }
+      auto& this_rule = *rule;
 
-      this_rule.cancel();
-      it = _fd_rules.erase( it );
-      return Result::Success;
-    }
+      if ( event.events & EPOLLERR ) {
+        /* recoverable error? */
+        if ( this_rule.recover() ) {
+          continue;
+        }
 
-    const auto poll_ready = static_cast<bool>( this_pollfd.revents & this_pollfd.events );
-    const auto poll_hup = static_cast<bool>( this_pollfd.revents & POLLHUP );
-    if ( poll_hup && this_pollfd.events && !poll_ready ) {
-      // if we asked for the status, and the _only_ condition was a hangup, this FD is defunct:
-      //   - if it was POLLIN and nothing is readable, no more will ever be readable
-      //   - if it was POLLOUT, it will not be writable again
-      this_rule.cancel();
-      it = _fd_rules.erase( it );
-      return Result::Success;
-    }
+        /* see if fd is a socket */
+        int socket_error = 0;
+        socklen_t optlen = sizeof( socket_error );
+        const int ret = getsockopt( this_rule.fd.fd_num(), SOL_SOCKET, SO_ERROR, &socket_error, &optlen );
+        if ( ret == -1 and errno == ENOTSOCK ) {
+          cerr << "error on polled file descriptor for rule \"" << _rule_categories.at( this_rule.category_id ).name
+               << "\"\n";
+        } else if ( ret == -1 ) {
+          throw unix_error( "getsockopt" );
+        } else if ( optlen != sizeof( socket_error ) ) {
+          throw runtime_error( "unexpected length from getsockopt: " + to_string( optlen ) );
+        } else if ( socket_error ) {
+          cerr << "error on polled socket for rule \"" << _rule_categories.at( this_rule.category_id ).name
+               << "\": " << strerror( socket_error ) << "\n";
+        }
 
-    if ( poll_ready ) {
-      MultiTimer<Timer::Category::Nonblock> record_timer {
-        _rule_categories.at( this_rule.category_id ).timer,
-        _rule_categories.at( this_rule.category_id ).timer_cumulative };
-      // we only want to call callback if revents includes the event we asked for
-      const auto count_before = this_rule.service_count();
-      this_rule.callback();
+        this_rule.cancel();
+        this_rule.cancel_requested = true;
+        _sweep_needed = true;
+        continue;
+      }
 
-      if ( count_before == this_rule.service_count() and ( not this_rule.fd.closed() ) and this_rule.interest() ) {
-        throw runtime_error( "EventLoop: busy wait detected: rule \""
-                             + _rule_categories.at( this_rule.category_id ).name
-                             + "\" did not read/write fd and is still interested" );
+      const auto direction = static_cast<uint32_t>( this_rule.direction );
+      const auto poll_ready = this_rule.armed and static_cast<bool>( event.events & direction );
+      const auto poll_hup = static_cast<bool>( event.events & EPOLLHUP );
+      if ( poll_hup && this_rule.armed && !poll_ready ) {
+        // if we asked for the status, and the _only_ condition was a hangup, this FD is defunct:
+        //   - if it was EPOLLIN and nothing is readable, no more will ever be readable
+        //   - if it was EPOLLOUT, it will not be writable again
+        this_rule.cancel();
+        this_rule.cancel_requested = true;
+        _sweep_needed = true;
+        continue;
       }
 
-      return Result::Success; /* only serve one rule on each iteration */
-    }
+      if ( poll_ready ) {
+        MultiTimer<Timer::Category::Nonblock> record_timer {
+          _rule_categories.at( this_rule.category_id ).timer,
+          _rule_categories.at( this_rule.category_id ).timer_cumulative };
+        // we only want to call callback if revents includes the event we asked for
+        const auto count_before = this_rule.service_count();
+        this_rule.callback();
 
-    ++it; // if we got here, it means we didn't call _fd_rules.erase()
+        if ( count_before == this_rule.service_count() and ( not this_rule.fd.closed() ) and this_rule.interest() ) {
+          throw runtime_error( "EventLoop: busy wait detected: rule \""
+                               + _rule_categories.at( this_rule.category_id ).name
+                               + "\" did not read/write fd and is still interested" );
+        }
+      }
+    }
   }
 
   return Result::Success;
@@ -1,25 +1,50 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <ostream>
-#include <poll.h>
+#include <string>
 #include <string_view>
+#include <sys/epoll.h>
+#include <unordered_map>
+#include <vector>
 
 #include "file_descriptor.hh"
 #include "summarize.hh"
 #include "timer.hh"
 
 //! Waits for events on file descriptors and executes corresponding callbacks.
+//! \details File descriptors are registered with [epoll(7)](\ref man7::epoll); a registration is only modified when
+//! the interest of one of its rules changes. The interest of an fd's rules is re-evaluated only after a callback on
+//! that fd ran, after EventLoop::interest_changed, or after a non-fd rule that may have changed anything. Rules
+//! without a file descriptor run whenever the loop wakes up, which other threads can force with EventLoop::notify.
 class EventLoop : public Summarizable
 {
 public:
   //! Indicates interest in reading (In) or writing (Out) a polled fd.
   enum class Direction : short
   {
-    In = POLLIN,  //!< Callback will be triggered when Rule::fd is readable.
-    Out = POLLOUT //!< Callback will be triggered when Rule::fd is writable.
+    In = EPOLLIN,  //!< Callback will be triggered when Rule::fd is readable.
+    Out = EPOLLOUT //!< Callback will be triggered when Rule::fd is writable.
+  };
+
+  //! Which fd rules to re-evaluate the interest of after a non-fd rule runs.
+  enum class Rearm
+  {
+    All,     //!< Any of them, since the callback may change what they depend on.
+    Explicit //!< Only those the callback names with EventLoop::interest_changed.
+  };
+
+  //! Cumulative time spent in the rules of one category.
+  struct CategoryTotal
+  {
+    std::string name;
+    Timer::Record timer;
   };
 
 private:
@@ -38,8 +63,12 @@ private:
     InterestT interest;
     CallbackT callback;
     bool cancel_requested;
+    Rearm rearm;
 
-    BasicRule( const size_t s_category_id, const InterestT& s_interest, const CallbackT& s_callback );
+    BasicRule( const size_t s_category_id,
+               const InterestT& s_interest,
+               const CallbackT& s_callback,
+               const Rearm s_rearm = Rearm::All );
   };
 
   struct FDRule : public BasicRule
@@ -48,6 +77,7 @@ private:
     Direction direction; //!< Direction::In for reading from fd, Direction::Out for writing to fd.
     CallbackT cancel;    //!< A callback that is called when the rule is cancelled (e.g. on hangup)
     InterestT recover;   //!< A callback that is called when the fd is ERR. Returns true to keep rule.
+    bool armed = false;  //!< Whether the registration is armed for this rule, i.e. it was last interested.
 
     FDRule( BasicRule&& base,
             FileDescriptor&& s_fd,
@@ -60,12 +90,48 @@ private:
     unsigned int service_count() const;
   };
 
+  //! The rules sharing one epoll registration, and the events it is currently armed for.
+  struct Registration
+  {
+    std::vector<FDRule*> rules {};
+    uint32_t events = 0;
+    bool dirty = false; //!< Listed in _dirty
+  };
+
   std::vector<RuleCategory> _rule_categories;
   std::list<std::shared_ptr<FDRule>> _fd_rules {};
   std::list<std::shared_ptr<BasicRule>> _non_fd_rules {};
   Timer::Record _waiting {};
   Timer::Record _waiting_cumulative {};
 
+  FileDescriptor _epoll;
+  FileDescriptor _wakeup;
+  std::atomic<bool> _wakeup_pending { false };
+  std::unordered_map<int, Registration> _registrations {};
+
+  std::vector<int> _dirty {};   //!< Registrations whose rules' interest may have changed
+  bool _all_dirty = false;      //!< Whether every fd rule's interest may have changed
+  bool _sweep_needed = false;   //!< Whether some fd rule has been cancelled or retired since the last sweep
+  size_t _armed_rules = 0;      //!< Number of fd rules with FDRule::armed set
+
+  //! Ticks between copies of the cumulative timers for other threads to read.
+  static constexpr uint64_t PUBLISH_INTERVAL = uint64_t( 1 ) << 26;
+  //! How long a reader waits for the loop to publish a fresh copy before settling for the last one.
+  static constexpr std::chrono::milliseconds PUBLISH_WAIT { 100 };
+  mutable std::mutex _published_mutex {};
+  std::condition_variable _published_cv {};
+  std::vector<CategoryTotal> _published {};
+  uint64_t _publications {}; //!< Copies published so far, guarded by _published_mutex
+  uint64_t _last_published {};
+  std::atomic<bool> _publish_requested { false };
+
+  void publish_timers();
+
+  void update_registration( const int fd_num, Registration& registration );
+  void arm( FDRule& rule, const bool interested );
+  void deregister( FDRule& rule );
+  void mark_dirty( const int fd_num );
+
 public:
   EventLoop();
 
@@ -74,8 +140,9 @@ public:
   {
     Success, //!< At least one Rule was triggered.
     Timeout, //!< No rules were triggered before timeout.
-    Exit     //!< All rules have been canceled or were uninterested; make no further calls to
-             //!< EventLoop::wait_next_event.
+    Exit     //!< All fd rules have been canceled or were uninterested and no other rules remain; make no further
+             //!< calls to EventLoop::wait_next_event. A loop with a non-fd rule never exits, since another thread
+             //!< may give that rule something to do and notify the loop.
   };
 
   size_t add_category( const std::string& name );
@@ -83,11 +150,13 @@ public:
   class RuleHandle
   {
     std::weak_ptr<BasicRule> rule_weak_ptr_;
+    EventLoop* loop_;
 
   public:
     template<class RuleType>
-    RuleHandle( const std::shared_ptr<RuleType> x )
+    RuleHandle( const std::shared_ptr<RuleType> x, EventLoop* loop )
       : rule_weak_ptr_( x )
+      , loop_( loop )
     {}
 
     void cancel();
@@ -102,17 +171,34 @@ public:
     const CallbackT& cancel = [] {},
     const InterestT& recover = [] { return false; } );
 
+  //! A rule registered with Rearm::Explicit must call EventLoop::interest_changed for each fd whose rules'
+  //! interest its callback may change.
   RuleHandle add_rule(
     const size_t category_id,
     const CallbackT& callback,
-    const InterestT& interest = [] { return true; } );
+    const InterestT& interest = [] { return true; },
+    const Rearm rearm = Rearm::All );
 
-  //! Calls [poll(2)](\ref man2::poll) and then executes callback for each ready fd.
+  //! Has the interest of the rules on fd re-evaluated before the next wait. Call only from the loop's thread.
+  void interest_changed( const FileDescriptor& fd ) { mark_dirty( fd.fd_num() ); }
+
+  //! Runs the interested non-fd rules, calls [epoll_wait(2)](\ref man2::epoll_wait) and then executes callback for
+  //! each ready fd.
   Result wait_next_event( const int timeout_ms );
 
+  //! Wakes up a concurrent or future call to EventLoop::wait_next_event, so that non-fd rules are re-evaluated.
+  //! \details Safe to call from any thread; repeated calls before the loop wakes up cost one atomic exchange.
+  void notify();
+
   void summary( std::ostream& out ) const override;
   void reset_summary() override;
 
+  //! The cumulative timer of each category, and of waiting for events.
+  //! \details Safe to call from any thread. Wakes the loop to publish a fresh copy, even if it is idle in
+  //! wait_next_event( -1 ). If the loop is busy in a rule for longer than PUBLISH_WAIT, returns the last copy,
+  //! which the loop otherwise refreshes every PUBLISH_INTERVAL ticks.
+  std::vector<CategoryTotal> cumulative_timers();
+
   // convenience function to add category and rule at the same time
   template<typename... Targs>
   auto add_rule( const std::string& name, Targs&&... Fargs )
@@ -122,3 +208,4 @@ public:
 };
 
 using Direction = EventLoop::Direction;
+using Rearm = EventLoop::Rearm;
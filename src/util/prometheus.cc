@@ -0,0 +1,53 @@
+#include <charconv>
+
+#include "prometheus.hh"
+
+using namespace std;
+
+namespace {
+void write_label_value( ostream& out, string_view value )
+{
+  for ( const char c : value ) {
+    switch ( c ) {
+      case '\\':
+        out << "\\\\";
+        break;
+      case '"':
+        out << "\\\"";
+        break;
+      case '\n':
+        out << "\\n";
+        break;
+      default:
+        out << c;
+    }
+  }
+}
+}
+
+void PrometheusWriter::write( string_view metric, Type type, string_view help, double value, Labels labels )
+{
+  if ( metric != metric_ ) {
+    metric_ = metric;
+    out_ << "# HELP " << metric << " " << help << "\n";
+    out_ << "# TYPE " << metric << " " << ( type == Type::Counter ? "counter" : "gauge" ) << "\n";
+  }
+
+  out_ << metric;
+  if ( labels.size() ) {
+    out_ << "{";
+    bool first = true;
+    for ( const auto& [name, label] : labels ) {
+      out_ << ( first ? "" : "," ) << name << "=\"";
+      write_label_value( out_, label );
+      out_ << "\"";
+      first = false;
+    }
+    out_ << "}";
+  }
+
+  // Shortest form that reads back exactly, so large counters are not rounded
+  char buffer[32];
+  const auto end = to_chars( buffer, buffer + sizeof( buffer ), value ).ptr;
+  out_ << " " << string_view( buffer, end - buffer ) << "\n";
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <initializer_list>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+
+/**
+ * Writes samples in the Prometheus text exposition format. The samples of one metric must be written one after
+ * another; its HELP and TYPE lines are written before the first of them.
+ */
+class PrometheusWriter
+{
+public:
+  enum class Type
+  {
+    Counter,
+    Gauge
+  };
+
+  using Labels = std::initializer_list<std::pair<std::string_view, std::string_view>>;
+
+private:
+  std::ostream& out_;
+  std::string metric_ {};
+
+public:
+  explicit PrometheusWriter( std::ostream& out )
+    : out_( out )
+  {}
+
+  void write( std::string_view metric, Type type, std::string_view help, double value, Labels labels = {} );
+};
@@ -2,8 +2,11 @@
 
 #include "exception.hh"
 
+#include <array>
 #include <cstddef>
+#include <cstring>
 #include <stdexcept>
+#include <sys/uio.h>
 #include <unistd.h>
 
 using namespace std;
@@ -116,6 +119,21 @@ TCPSocket TCPSocket::accept()
   return TCPSocket( FileDescriptor( CheckSystemCall( "accept", ::accept( fd_num(), nullptr, nullptr ) ) ) );
 }
 
+// mark the socket as listening for incoming connections
+//! \param[in] backlog is the number of waiting connections to queue (see [listen(2)](\ref man2::listen))
+void LocalStreamSocket::listen( const int backlog )
+{
+  CheckSystemCall( "listen", ::listen( fd_num(), backlog ) );
+}
+
+// accept a new incoming connection
+//! \returns a new LocalStreamSocket connected to the peer.
+LocalStreamSocket LocalStreamSocket::accept()
+{
+  register_read();
+  return LocalStreamSocket( FileDescriptor( CheckSystemCall( "accept", ::accept( fd_num(), nullptr, nullptr ) ) ) );
+}
+
 // get socket option
 template<typename option_type>
 socklen_t Socket::getsockopt( const int level, const int option, option_type& option_value ) const
@@ -143,6 +161,15 @@ void Socket::set_reuseaddr()
   setsockopt( SOL_SOCKET, SO_REUSEADDR, int( true ) );
 }
 
+// fail blocking reads and writes that wait too long
+//! \param[in] timeout The longest a single read or write may block
+void Socket::set_timeout( const chrono::microseconds timeout )
+{
+  const timeval value { .tv_sec = timeout.count() / 1000000, .tv_usec = timeout.count() % 1000000 };
+  setsockopt( SOL_SOCKET, SO_RCVTIMEO, value );
+  setsockopt( SOL_SOCKET, SO_SNDTIMEO, value );
+}
+
 void Socket::throw_if_error() const
 {
   int socket_error = 0;
@@ -155,3 +182,90 @@ void Socket::throw_if_error() const
     throw unix_error( "socket error", socket_error );
   }
 }
+
+int Socket::domain() const
+{
+  int value = 0;
+  getsockopt( SOL_SOCKET, SO_DOMAIN, value );
+  return value;
+}
+
+namespace {
+// Descriptors accepted by a single recvmsg; a stream socket stops at the first message carrying any
+constexpr size_t max_fds_per_read = 16;
+}
+
+size_t Socket::recv_with_fds( span<char> buffer, vector<FileDescriptor>& fds )
+{
+  if ( buffer.empty() ) {
+    throw runtime_error( "Socket::recv_with_fds: no space to read" );
+  }
+
+  iovec iov { buffer.data(), buffer.size() };
+  alignas( cmsghdr ) array<char, CMSG_SPACE( sizeof( int ) * max_fds_per_read )> control {};
+  msghdr message {};
+  message.msg_iov = &iov;
+  message.msg_iovlen = 1;
+  message.msg_control = control.data();
+  message.msg_controllen = control.size();
+
+  const ssize_t bytes_read = ::recvmsg( fd_num(), &message, MSG_CMSG_CLOEXEC );
+  if ( bytes_read < 0 ) {
+    if ( errno == EAGAIN or errno == EINPROGRESS ) {
+      return 0;
+    }
+    throw unix_error( "recvmsg" );
+  }
+
+  register_read();
+
+  if ( bytes_read == 0 ) {
+    set_eof();
+  }
+
+  for ( cmsghdr* cmsg = CMSG_FIRSTHDR( &message ); cmsg; cmsg = CMSG_NXTHDR( &message, cmsg ) ) {
+    if ( cmsg->cmsg_level != SOL_SOCKET or cmsg->cmsg_type != SCM_RIGHTS ) {
+      continue;
+    }
+    const size_t count = ( cmsg->cmsg_len - CMSG_LEN( 0 ) ) / sizeof( int );
+    for ( size_t i = 0; i < count; i++ ) {
+      int fd;
+      memcpy( &fd, CMSG_DATA( cmsg ) + i * sizeof( int ), sizeof( int ) );
+      fds.emplace_back( fd );
+    }
+  }
+
+  if ( message.msg_flags & MSG_CTRUNC ) {
+    throw runtime_error( "recvmsg: file descriptors were truncated" );
+  }
+
+  return bytes_read;
+}
+
+size_t Socket::send_with_fd( const vector<string_view>& buffers, const FileDescriptor& fd )
+{
+  vector<iovec> iovecs;
+  iovecs.reserve( buffers.size() );
+  for ( const auto x : buffers ) {
+    iovecs.push_back( { const_cast<char*>( x.data() ), x.size() } );
+  }
+
+  alignas( cmsghdr ) array<char, CMSG_SPACE( sizeof( int ) )> control {};
+  msghdr message {};
+  message.msg_iov = iovecs.data();
+  message.msg_iovlen = iovecs.size();
+  message.msg_control = control.data();
+  message.msg_controllen = control.size();
+
+  cmsghdr* cmsg = CMSG_FIRSTHDR( &message );
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN( sizeof( int ) );
+  const int fd_number = fd.fd_num();
+  memcpy( CMSG_DATA( cmsg ), &fd_number, sizeof( int ) );
+
+  const ssize_t bytes_written = CheckSystemCall( "sendmsg", ::sendmsg( fd_num(), &message, MSG_NOSIGNAL ) );
+  register_write();
+
+  return bytes_written;
+}
@@ -3,6 +3,7 @@
 #include "address.hh"
 #include "file_descriptor.hh"
 
+#include <chrono>
 #include <cstdint>
 #include <functional>
 #include <span>
@@ -50,8 +51,27 @@ public:
   //! Allow local address to be reused sooner via [SO_REUSEADDR](\ref man7::socket)
   void set_reuseaddr();
 
+  //! Fail blocking reads and writes that wait longer than `timeout`, via [SO_RCVTIMEO](\ref man7::socket)
+  void set_timeout( std::chrono::microseconds timeout );
+
   //! Check for errors (will be seen on non-blocking sockets)
   void throw_if_error() const;
+
+  //! The socket's domain, e.g. `AF_INET` or `AF_UNIX`
+  int domain() const;
+
+  //! \name Descriptor passing
+  //! Only meaningful for `AF_UNIX` sockets; see [unix(7)](\ref man7::unix) `SCM_RIGHTS`
+  //!@{
+
+  //! Read into `buffer` with [recvmsg(2)](\ref man2::recvmsg), appending any descriptors received to `fds`
+  //! \returns number of bytes read
+  size_t recv_with_fds( std::span<char> buffer, std::vector<FileDescriptor>& fds );
+
+  //! Write `buffers` with [sendmsg(2)](\ref man2::sendmsg), attaching a duplicate of `fd` to the first byte
+  //! \returns number of bytes written
+  size_t send_with_fd( const std::vector<std::string_view>& buffers, const FileDescriptor& fd );
+  //!@}
 };
 
 //! A wrapper around [TCP sockets](\ref man7::tcp)
@@ -76,3 +96,25 @@ public:
   //! Accept a new incoming connection
   TCPSocket accept();
 };
+
+//! A wrapper around [Unix-domain stream sockets](\ref man7::unix)
+class LocalStreamSocket : public Socket
+{
+private:
+  //! \brief Construct from FileDescriptor (used by accept())
+  explicit LocalStreamSocket( FileDescriptor&& fd )
+    : Socket( std::move( fd ), AF_UNIX, SOCK_STREAM )
+  {}
+
+public:
+  //! Default: construct an unbound, unconnected Unix-domain stream socket
+  LocalStreamSocket()
+    : Socket( AF_UNIX, SOCK_STREAM )
+  {}
+
+  //! Mark a socket as listening for incoming connections
+  void listen( const int backlog = 16 );
+
+  //! Accept a new incoming connection
+  LocalStreamSocket accept();
+};
@@ -4,55 +4,189 @@
 #include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <ostream>
+#include <vector>
 
 using namespace std;
 
 uint64_t Timer::baseline_ = 0;
 
+namespace {
+mutex registry_mutex;
+// The Timer of every thread that has recorded anything, kept after the thread exits
+vector<shared_ptr<Timer>> registry;
+}
+
+Timer& global_timer()
+{
+  static thread_local shared_ptr<Timer> timer;
+  if ( !timer ) {
+    timer = make_shared<Timer>();
+    unique_lock lock( registry_mutex );
+    registry.push_back( timer );
+  }
+  return *timer;
+}
+
+void reset_global_timer()
+{
+  Timer::reset_all();
+}
+
+void global_timer_summary( ostream& out )
+{
+  Timer merged { 0 };
+  {
+    unique_lock lock( registry_mutex );
+    for ( const auto& timer : registry ) {
+      merged.merge( *timer );
+    }
+  }
+  merged.summary( out );
+}
+
+uint64_t Timer::Histogram::percentile( double p ) const
+{
+  uint64_t total = 0;
+  for ( const auto count : buckets ) {
+    total += count;
+  }
+
+  uint64_t seen = 0;
+  for ( size_t i = 0; i < buckets.size(); i++ ) {
+    seen += buckets[i];
+    if ( seen > 0 and seen >= p * total ) {
+      return i == 0 ? 0 : ( i == 64 ? numeric_limits<uint64_t>::max() : ( uint64_t( 1 ) << i ) - 1 );
+    }
+  }
+  return 0;
+}
+
+Timer::Record Timer::record( size_t category ) const
+{
+  Record record;
+  if ( current() ) {
+    const auto& counters = _counters.at( category );
+    record.count = counters.count.load();
+    record.total_ticks = counters.total_ticks.load();
+    record.max_ticks = counters.max_ticks.load();
+    record.min_ticks = counters.min_ticks.load();
+  }
+  return record;
+}
+
+Timer::Histogram Timer::histogram( size_t category ) const
+{
+  Histogram histogram;
+  if ( current() ) {
+    for ( size_t i = 0; i < histogram.buckets.size(); i++ ) {
+      histogram.buckets[i] = _counters.at( category ).buckets[i].load();
+    }
+  }
+  return histogram;
+}
+
+void Timer::merge( const Timer& other )
+{
+  for ( size_t i = 0; i < num_categories; i++ ) {
+    auto record = this->record( i );
+    record.merge( other.record( i ) );
+    auto histogram = this->histogram( i );
+    histogram.merge( other.histogram( i ) );
+
+    auto& counters = _counters[i];
+    counters.count.store( record.count );
+    counters.total_ticks.store( record.total_ticks );
+    counters.max_ticks.store( record.max_ticks );
+    counters.min_ticks.store( record.min_ticks );
+    for ( size_t j = 0; j < histogram.buckets.size(); j++ ) {
+      counters.buckets[j].store( histogram.buckets[j] );
+    }
+  }
+  if ( other.current() ) {
+    _accounted.add( other._accounted.load() );
+  }
+
+  // Time before the last reset_global_timer() is not accounted for
+  const uint64_t beginning = max( other._beginning_timestamp.load(), _global_reset_timestamp.load() );
+  _beginning_timestamp.store( min( _beginning_timestamp.load(), beginning ) );
+  _threads += other._threads;
+}
+
+void Timer::reset()
+{
+  for ( auto& counters : _counters ) {
+    counters.count.store( 0 );
+    counters.total_ticks.store( 0 );
+    counters.max_ticks.store( 0 );
+    counters.min_ticks.store( numeric_limits<uint64_t>::max() );
+    for ( auto& bucket : counters.buckets ) {
+      bucket.store( 0 );
+    }
+  }
+  _accounted.store( 0 );
+  _beginning_timestamp.store( read_tsc() );
+  _generation.store( _global_generation.load(), memory_order_release );
+}
+
+void Timer::reset_all()
+{
+  _global_reset_timestamp = read_tsc();
+  _global_generation++;
+}
+
 void Timer::summary( ostream& out ) const
 {
   const uint64_t now = __rdtsc();
+  const uint64_t beginning = _beginning_timestamp.load();
 
-  const uint64_t elapsed = now - _beginning_timestamp;
+  // Every thread accounts for its own share of the elapsed time
+  const uint64_t elapsed = ( now - beginning ) * max<size_t>( _threads, 1 );
 
   out << "Global timing summary\n---------------------\n\n";
 
   out << "Total time: ";
-  out << now - _beginning_timestamp;
+  out << now - beginning;
+  out << "\n";
+
+  out << "Threads: ";
+  out << _threads;
   out << "\n";
 
   out << "Baseline time mean: ";
   out << Timer::baseline_;
   out << "\n";
 
-  uint64_t accounted = 0;
-
   for ( unsigned int i = 0; i < num_categories; i++ ) {
-    if ( _records.at( i ).count == 0 )
+    const auto record = this->record( i );
+    if ( record.count == 0 )
       continue;
+    const auto histogram = this->histogram( i );
     out << "   " << _category_names.at( i ) << ": ";
     out << string( 32 - strlen( _category_names.at( i ) ), ' ' );
-    out << fixed << setw( 6 ) << setprecision( 1 ) << 100 * _records.at( i ).total_ticks / double( elapsed ) << "%";
-    accounted += _records.at( i ).total_ticks;
+    out << fixed << setw( 6 ) << setprecision( 1 ) << 100 * record.total_ticks / double( elapsed ) << "%";
 
-    if ( _records.at( i ).count > 0 ) {
+    if ( record.count > 0 ) {
       out << "   [mean=";
-      out << fixed << setw( 6 ) << _records.at( i ).total_ticks / _records.at( i ).count - Timer::baseline_;
+      out << fixed << setw( 6 ) << record.total_ticks / record.count - Timer::baseline_;
       out << "] ";
     } else {
       out << "                 ";
     }
 
-    out << "[max= ";
-    out << fixed << setw( 6 ) << _records.at( i ).max_ticks;
+    out << "[p50<= " << fixed << setw( 6 ) << histogram.percentile( 0.5 ) << "]";
+    out << " [p99<= " << fixed << setw( 6 ) << histogram.percentile( 0.99 ) << "]";
+    out << " [max= ";
+    out << fixed << setw( 6 ) << record.max_ticks;
     out << "]";
-    out << " [count=" << fixed << setw( 6 ) << _records.at( i ).count << "]";
+    out << " [count=" << fixed << setw( 6 ) << record.count << "]";
 
     out << "\n";
   }
 
-  const uint64_t unaccounted = elapsed - accounted;
+  const uint64_t unaccounted = elapsed - min( elapsed, _accounted.load() );
   out << "\n   Unaccounted: " << string( 23, ' ' );
   out << 100 * unaccounted / double( elapsed ) << "%\n";
 }
@@ -60,22 +194,22 @@ void Timer::summary( ostream& out ) const
 void Timer::average( ostream& out, int count ) const
 {
   for ( unsigned int i = 0; i < num_categories; i++ ) {
-    if ( _records.at( i ).count == 0 )
+    const auto record = this->record( i );
+    if ( record.count == 0 )
       continue;
     out << "   " << _category_names.at( i ) << ": ";
     out << string( 32 - strlen( _category_names.at( i ) ), ' ' );
 
-    if ( _records.at( i ).count > 0 ) {
+    if ( record.count > 0 ) {
       out << "   [mean=";
-      out << fixed << setw( 6 )
-          << ( _records.at( i ).total_ticks - _records.at( i ).count * Timer::baseline_ ) / count;
+      out << fixed << setw( 6 ) << ( record.total_ticks - record.count * Timer::baseline_ ) / count;
       out << "] ";
     } else {
       out << "                 ";
     }
 
     out << "[total= ";
-    out << fixed << setw( 6 ) << _records.at( i ).total_ticks;
+    out << fixed << setw( 6 ) << record.total_ticks;
     out << "]";
     out << " [count=" << fixed << setw( 6 ) << count << "]";
 
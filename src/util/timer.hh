@@ -1,9 +1,12 @@
 #pragma once
 
 #include <array>
+#include <atomic>
+#include <bit>
 #include <chrono>
+#include <cstdint>
 #include <iomanip>
-#include <optional>
+#include <limits>
 #include <ostream>
 #include <string>
 #include <type_traits>
@@ -11,6 +14,11 @@
 #include <iostream>
 #include <x86intrin.h>
 
+/**
+ * Time spent in each Category, measured with the TSC. Every thread records into its own Timer (see global_timer()),
+ * so recording takes no lock; the Timers of all threads are merged when a summary is requested. Categories may
+ * nest: each is charged its inclusive time, and only the outermost ones count towards the accounted total.
+ */
 class Timer
 {
 public:
@@ -29,6 +37,14 @@ public:
       min_ticks = std::min( min_ticks, ticks );
     }
 
+    void merge( const Record& other )
+    {
+      count += other.count;
+      total_ticks += other.total_ticks;
+      max_ticks = std::max( max_ticks, other.max_ticks );
+      min_ticks = std::min( min_ticks, other.min_ticks );
+    }
+
     void reset()
     {
       count = total_ticks = max_ticks = 0;
@@ -36,6 +52,24 @@ public:
     }
   };
 
+  // Durations bucketed by their power of two, enough for percentiles within a factor of two
+  struct Histogram
+  {
+    std::array<uint64_t, 65> buckets {};
+
+    void log( const uint64_t ticks ) { buckets[std::bit_width( ticks )]++; }
+
+    void merge( const Histogram& other )
+    {
+      for ( size_t i = 0; i < buckets.size(); i++ ) {
+        buckets[i] += other.buckets[i];
+      }
+    }
+
+    // Upper bound of the p-th quantile (0 < p <= 1)
+    uint64_t percentile( double p ) const;
+  };
+
   enum class Category
   {
     Hash,
@@ -68,13 +102,85 @@ public:
 
   static uint64_t baseline_;
 
+  constexpr static size_t max_depth = 16;
+
 private:
-  uint64_t _beginning_timestamp = read_tsc();
-  std::array<Record, num_categories> _records {};
-  std::optional<Category> _current_category {};
-  uint64_t _start_time {};
+  struct Frame
+  {
+    Category category;
+    uint64_t start_time;
+  };
+
+  // A counter only its owning thread writes, which other threads may read while it does: relaxed loads and stores
+  // cost what a plain counter would, where a read-modify-write or a lock would not
+  class Counter
+  {
+    std::atomic<uint64_t> value_;
+
+  public:
+    Counter()
+      : value_( 0 )
+    {}
+    explicit Counter( uint64_t value )
+      : value_( value )
+    {}
+
+    uint64_t load() const { return value_.load( std::memory_order_relaxed ); }
+    void store( uint64_t value ) { value_.store( value, std::memory_order_relaxed ); }
+    void add( uint64_t n ) { store( load() + n ); }
+  };
+
+  struct Counters
+  {
+    Counter count {};
+    Counter total_ticks {};
+    Counter max_ticks {};
+    Counter min_ticks { std::numeric_limits<uint64_t>::max() };
+    std::array<Counter, std::tuple_size_v<decltype( Histogram::buckets )>> buckets {};
+  };
+
+  // Bumped by reset_global_timer(), along with the time of the reset
+  static inline std::atomic<uint64_t> _global_generation { 0 };
+  static inline std::atomic<uint64_t> _global_reset_timestamp { 0 };
+
+  Counter _beginning_timestamp { read_tsc() };
+  std::array<Counters, num_categories> _counters {};
+  // Ticks spent in outermost categories
+  Counter _accounted {};
+  // Number of per-thread Timers merged into this one
+  size_t _threads { 1 };
+  // The reset_global_timer() generation the counters belong to; older counters read as empty
+  std::atomic<uint64_t> _generation { _global_generation.load() };
+
+  std::array<Frame, max_depth> _stack {};
+  size_t _depth {};
+
+  bool current() const
+  {
+    return _generation.load( std::memory_order_acquire ) == _global_generation.load( std::memory_order_relaxed );
+  }
+
+  void log( const size_t category, const uint64_t ticks )
+  {
+    if ( not current() ) {
+      reset();
+    }
+    auto& counters = _counters[category];
+    counters.count.add( 1 );
+    counters.total_ticks.add( ticks );
+    counters.max_ticks.store( std::max( counters.max_ticks.load(), ticks ) );
+    counters.min_ticks.store( std::min( counters.min_ticks.load(), ticks ) );
+    counters.buckets[std::bit_width( ticks )].add( 1 );
+  }
+
+  Record record( size_t category ) const;
+  Histogram histogram( size_t category ) const;
 
 public:
+  explicit Timer( size_t threads = 1 )
+    : _threads( threads )
+  {}
+
   static uint64_t read_tsc()
   {
     uint64_t ret = __rdtsc();
@@ -85,46 +191,57 @@ public:
   template<Category category>
   void start( const uint64_t now = read_tsc() )
   {
-    if ( _current_category.has_value() ) {
-      std::cout << static_cast<size_t>( _current_category.value() ) << std::endl;
+    if ( _depth == max_depth ) {
+      std::cerr << "Timer: categories nested too deeply\n";
       abort();
     }
-    _current_category = category;
-    _start_time = now;
+    _stack[_depth++] = { category, now };
   }
 
   template<Category category>
   void stop( const uint64_t now = read_tsc() )
   {
-    if ( not _current_category.has_value() or _current_category.value() != category ) {
+    if ( _depth == 0 or _stack[_depth - 1].category != category ) {
+      std::cerr << "Timer: stopped " << _category_names[static_cast<size_t>( category )] << " out of order\n";
       abort();
     }
 
-    _records[static_cast<size_t>( category )].log( now - _start_time );
-    _current_category.reset();
+    const uint64_t ticks = now - _stack[--_depth].start_time;
+    log( static_cast<size_t>( category ), ticks );
+    if ( _depth == 0 ) {
+      _accounted.add( ticks );
+    }
   }
 
   template<Category category>
   uint64_t mean()
   {
-    size_t category_idx = static_cast<size_t>( category );
-    return _records.at( category_idx ).total_ticks / _records.at( category_idx ).count;
+    const auto record = this->record( static_cast<size_t>( category ) );
+    return record.total_ticks / record.count;
   }
 
+  // Add the records of another Timer, e.g. that of another thread, which may be recording concurrently
+  void merge( const Timer& other );
+  // Forget the records so far, leaving any categories in progress running. Only for the thread recording into it;
+  // see reset_global_timer() for the others.
+  void reset();
+
+  // Make every Timer read as empty, and clear it when its thread next records; see reset_global_timer()
+  static void reset_all();
+
   void summary( std::ostream& out ) const;
   void average( std::ostream& out, int count ) const;
 };
 
-inline Timer& global_timer()
-{
-  static Timer the_global_timer;
-  return the_global_timer;
-}
+// This thread's Timer, registered to be merged by global_timer_summary()
+Timer& global_timer();
 
-inline void reset_global_timer()
-{
-  global_timer() = Timer {};
-}
+// Reset the Timers of every thread. Each thread clears its own Timer when it next records, and until then its
+// records are left out of summaries.
+void reset_global_timer();
+
+// Summary of the Timers of every thread, merged
+void global_timer_summary( std::ostream& out );
 
 inline void set_time_baseline( uint64_t baseline )
 {
@@ -170,14 +287,6 @@ public:
   GlobalScopeTimer() { global_timer().start<category>(); }
   ~GlobalScopeTimer() { global_timer().stop<category>(); }
 };
-
-template<>
-inline GlobalScopeTimer<Timer::Category::Execution>::GlobalScopeTimer()
-{}
-
-template<>
-inline GlobalScopeTimer<Timer::Category::Execution>::~GlobalScopeTimer()
-{}
 #endif
 
 template<Timer::Category category>
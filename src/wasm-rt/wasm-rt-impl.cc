@@ -154,6 +154,15 @@ static int os_mprotect( void* addr, size_t size )
   return -1;
 }
 
+static int os_decommit( void* addr, size_t size )
+{
+  if ( size == 0 ) {
+    return 0;
+  }
+  BOOL succeeded = VirtualFree( addr, size, MEM_DECOMMIT );
+  return succeeded ? 0 : -1;
+}
+
 static void os_print_last_error( const char* msg )
 {
   DWORD errorMessageID = GetLastError();
@@ -221,6 +230,17 @@ static int os_mprotect( void* addr, size_t size )
   return mprotect( addr, size, PROT_READ | PROT_WRITE );
 }
 
+static int os_decommit( void* addr, size_t size )
+{
+  if ( size == 0 ) {
+    return 0;
+  }
+  if ( madvise( addr, size, MADV_DONTNEED ) != 0 ) {
+    return -1;
+  }
+  return mprotect( addr, size, PROT_NONE );
+}
+
 static void os_print_last_error( const char* msg )
 {
   perror( msg );
@@ -317,6 +337,100 @@ void wasm_rt_free( void )
 #endif
 }
 
+/* Size of the address space reserved for each hardware-checked memory. */
+#define WASM_RT_GUARD_REGION_SIZE 0x200000000ul
+
+/* Number of released guard regions kept per thread for reuse. */
+#define WASM_RT_GUARD_REGION_POOL_CAPACITY 8
+
+/*
+ * Reserving and releasing a guard region per instance takes the process-wide mmap lock for writing twice, which
+ * serializes instance startup across threads. Instead, each thread keeps the regions released by its instances and
+ * hands them to the next instance it allocates. A pooled region has its pages discarded with madvise, so it reads back
+ * as zeros, but keeps its read-write prefix; the next allocation only mprotects the difference in size.
+ */
+namespace {
+struct guard_region
+{
+  uint8_t* addr;
+  uint64_t accessible;
+};
+
+class guard_region_pool
+{
+  guard_region regions_[WASM_RT_GUARD_REGION_POOL_CAPACITY] {};
+  size_t count_ { 0 };
+
+public:
+  bool pop( guard_region& region )
+  {
+    if ( count_ == 0 ) {
+      return false;
+    }
+    region = regions_[--count_];
+    return true;
+  }
+
+  bool push( guard_region region )
+  {
+    if ( count_ == WASM_RT_GUARD_REGION_POOL_CAPACITY ) {
+      return false;
+    }
+    regions_[count_++] = region;
+    return true;
+  }
+
+  ~guard_region_pool()
+  {
+    for ( size_t i = 0; i < count_; i++ ) {
+      os_munmap( regions_[i].addr, WASM_RT_GUARD_REGION_SIZE );
+    }
+  }
+};
+
+thread_local guard_region_pool g_guard_region_pool;
+}
+
+static uint8_t* acquire_guard_region( uint64_t byte_length )
+{
+  guard_region region;
+  if ( !g_guard_region_pool.pop( region ) ) {
+    void* addr = os_mmap( WASM_RT_GUARD_REGION_SIZE );
+    if ( !addr ) {
+      os_print_last_error( "os_mmap failed." );
+      abort();
+    }
+    region = { static_cast<uint8_t*>( addr ), 0 };
+  }
+
+  int ret = 0;
+  if ( region.accessible < byte_length ) {
+    ret = os_mprotect( region.addr + region.accessible, byte_length - region.accessible );
+  } else if ( region.accessible > byte_length ) {
+    ret = os_decommit( region.addr + byte_length, region.accessible - byte_length );
+  }
+  if ( ret != 0 ) {
+    os_print_last_error( "os_mprotect failed." );
+    abort();
+  }
+  return region.addr;
+}
+
+static void release_guard_region( uint8_t* addr, uint64_t accessible )
+{
+#ifdef _WIN32
+  /* Decommitted pages cannot be recommitted without zeroing, so reset the whole region. */
+  if ( os_decommit( addr, accessible ) == 0 && g_guard_region_pool.push( { addr, 0 } ) ) {
+    return;
+  }
+#else
+  if ( madvise( addr, accessible, MADV_DONTNEED ) == 0 && g_guard_region_pool.push( { addr, accessible } ) ) {
+    return;
+  }
+#endif
+  os_munmap( addr, WASM_RT_GUARD_REGION_SIZE );
+}
+
 void wasm_rt_allocate_memory_helper( wasm_rt_memory_t* memory,
                                      uint64_t initial_pages,
                                      uint64_t max_pages,
@@ -338,20 +452,9 @@ void wasm_rt_allocate_memory_helper( wasm_rt_memory_t* memory,
   }
   resource_limits::available_bytes -= byte_length;
   if ( hw_checked ) {
-    /* Reserve 8GiB. */
+    /* Reserve 8GiB, or reuse a region this thread has already reserved. */
     assert( !is64 && "memory64 is not yet compatible with WASM_RT_MEMCHECK_SIGNAL_HANDLER" );
-    void* addr = os_mmap( 0x200000000ul );
-
-    if ( !addr ) {
-      os_print_last_error( "os_mmap failed." );
-      abort();
-    }
-    int ret = os_mprotect( addr, byte_length );
-    if ( ret != 0 ) {
-      os_print_last_error( "os_mprotect failed." );
-      abort();
-    }
-    memory->data = static_cast<uint8_t*>( addr );
+    memory->data = acquire_guard_region( byte_length );
   } else {
     memory->data = static_cast<uint8_t*>( calloc( byte_length, 1 ) );
   }
@@ -430,7 +533,10 @@ uint64_t wasm_rt_grow_memory( wasm_rt_memory_t* memory, uint64_t delta )
 
 void wasm_rt_free_memory_hw_checked( wasm_rt_memory_t* memory )
 {
-  os_munmap( memory->data, memory->size ); // ignore error?
+  if ( memory->data == NULL ) {
+    return;
+  }
+  release_guard_region( memory->data, memory->size );
 }
 
 void wasm_rt_free_memory_sw_checked( wasm_rt_memory_t* memory )
@@ -0,0 +1,4 @@
+;; Returns its own encode; used to time running a procedure.
+(memory 1)
+(func (export "_fixpoint_apply") (param externref) (result externref)
+      local.get 0)